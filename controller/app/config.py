@@ -28,17 +28,70 @@ class Settings(BaseSettings):
         None,
         description="Path to the compiled tof-reader executable (enables hardware polling when set)",
     )
+    sensor_daemon_socket: Optional[str] = Field(
+        None,
+        description="Control socket of a running sensor-daemon (e.g. /tmp/sensor-daemon.sock); replaces tof_reader_binary",
+    )
     tof_i2c_bus: str = Field("/dev/i2c-1", description="I2C bus exposed by the ToF sensor")
     tof_i2c_address: int = Field(0x29, description="7-bit I2C address for the ToF sensor")
     tof_xshut_path: Optional[str] = Field(
         None,
         description="Optional sysfs GPIO value path to toggle the sensor XSHUT line",
     )
+    tof_gpio1_path: Optional[str] = Field(
+        None,
+        description="Optional sysfs GPIO value path wired to the sensor GPIO1 data-ready line",
+    )
     tof_output_hz: int = Field(20, description="Polling rate (Hz) requested from the tof-reader process")
+    tof_continuous: bool = Field(
+        False,
+        description="Run the ToF sensor in continuous timed mode paced at tof_output_hz",
+    )
+    tof_binary_output: bool = Field(
+        False,
+        description="Read fixed-size binary records from tof-reader instead of JSON lines",
+    )
+    tof_shm_name: Optional[str] = Field(
+        None,
+        description="POSIX shared-memory name (e.g. /tof-reader) to read the latest ToF sample from instead of stdout",
+    )
+    tof_calibration_cache: Optional[str] = Field(
+        None,
+        description="File where tof-reader keeps the sensor's calibration so restarts skip re-calibrating",
+    )
+    tof_filter: Optional[str] = Field(
+        None,
+        description="Smoothing filter applied inside tof-reader: median, ema or kalman (None = raw samples)",
+    )
+    tof_adaptive_timing: bool = Field(
+        False,
+        description="Let tof-reader range faster while someone is close and slow down while nobody is in range",
+    )
+    tof_sched_fifo: int = Field(
+        0,
+        description="SCHED_FIFO priority (1-99) for tof-reader's acquisition thread; 0 keeps the normal scheduler",
+    )
+    tof_cpu_affinity: Optional[str] = Field(
+        None,
+        description="CPUs (e.g. 3 or 2-3) to pin tof-reader's acquisition thread to",
+    )
+    tof_mlock: bool = Field(
+        False,
+        description="Lock tof-reader's memory so its wake-ups never wait on a page fault",
+    )
+    tof_metrics_path: Optional[str] = Field(
+        None,
+        description="File tof-reader rewrites with Prometheus metrics (e.g. for node_exporter's textfile collector)",
+    )
+    tof_event_mode: bool = Field(
+        False,
+        description="Have tof-reader print only threshold crossings, large changes and a heartbeat instead of every sample",
+    )
 
     preview_frame_width: int = Field(640, description="Preview width for MJPEG streaming")
     preview_frame_height: int = Field(480, description="Preview height for MJPEG streaming")
     preview_fps: int = Field(15, description="Target FPS for preview stream")
+    preview_jpeg_quality: int = Field(80, description="JPEG quality (1-100) of the native preview encoder")
 
     mediapipe_stride: int = Field(3, description="Stride used by MediaPipe liveness worker")
     mediapipe_confidence: float = Field(0.6, description="Minimum face detector confidence")
@@ -16,6 +16,11 @@ except Exception:  # noqa: BLE001 - broad to avoid hardware import failures duri
     LivenessConfig = None
     LivenessResult = None
 
+try:  # pragma: no cover - optional native extension, built with libjpeg(-turbo)
+    from d435i._liveness_core import PreviewEncoder
+except Exception:  # noqa: BLE001 - missing module or built without the preview encoder
+    PreviewEncoder = None
+
 _PLACEHOLDER_JPEG = base64.b64decode(
     b"/9j/4AAQSkZJRgABAQAAAQABAAD/2wBDAAgGBgcGBQgHBwcJCQgKDBQNDAsLDBkSEw8UHRofHh0aHBwgJC4nICIsIxwcKDcpLDAxNDQ0Hyc5PTgyPC4zNDL/2wBDAQkJCQwLDBgNDRgyIRwhMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjL/wAARCAABAAEDASIAAhEBAxEB/8QAHwAAAQUBAQEBAQEAAAAAAAAAAAECAwQFBgcICQoL/8QAtRAAAgEDAwIEAwUFBAQAAAF9AQIDAAQRBRIhMUEGE1FhByJxFDKBkaEII0KxwRVS0fAkM2JyggkKFhcYGRolJicoKSo0NTY3ODk6Q0RFRkdISUpTVFVWV1hZWmNkZWZnaGlqc3R1dnd4eXqDhIWGh4iJipKTlJWWl5iZmqKjpKWmp6ipqrKztLW2t7i5usLDxMXGx8jJytLT1NXW19jZ2uHi4+Tl5ufo6erx8vP09fb3+Pn6/8QAHwEAAwEBAQEBAQEBAQAAAAAAAAECAwQFBgcICQoL/8QAtREAAgECBAQDBAcFBAQAAQJ3AAECAxEEBSExBhJBUQdhcRMiMoEIFEKRobHBCSMzUvAVYnLRChYkNOEl8RcYGRomJygpKjU2Nzg5OkNERUZHSElKU1RVVldYWVpjZGVmZ2hpanN0dXZ3eHl6goOEhYaHiImKkpOUlZaXmJmaoqOkpaanqKmqsrO0tba3uLm6wsPExcbHyMnK0tPU1dbX2Nna4uPk5ebn6Onq8vP09fb3+Pn6/9oADAMBAAIRAxEAPwD5/ooooA//2Q=="
 )
@@ -24,9 +29,21 @@ _PLACEHOLDER_JPEG = base64.b64decode(
 class RealSenseService:
     """Coordinates preview streaming and liveness evaluation."""
 
-    def __init__(self, *, enable_hardware: bool = True, liveness_config: Optional[dict] = None) -> None:
+    def __init__(
+        self,
+        *,
+        enable_hardware: bool = True,
+        liveness_config: Optional[dict] = None,
+        preview_width: int = 0,
+        preview_height: int = 0,
+        preview_quality: int = 80,
+    ) -> None:
         self.enable_hardware = enable_hardware and MediaPipeLiveness is not None
         self._liveness_config = liveness_config or {}
+        self._preview_size = (preview_width, preview_height)
+        self._preview_quality = preview_quality
+        self._encoder: Optional["PreviewEncoder"] = None
+        self._encoded_sequence = 0
         self._instance: Optional[MediaPipeLiveness] = None
         self._hardware_active = False
         self._lock = asyncio.Lock()
@@ -43,6 +60,11 @@ class RealSenseService:
         else:
             logger.info("RealSense hardware idle until session start")
         self._stop_event.clear()
+        if PreviewEncoder is not None and self.enable_hardware:
+            # Encodes on its own niced thread, off the event loop and away from the liveness math
+            width, height = self._preview_size
+            self._encoder = PreviewEncoder(width=width, height=height, quality=self._preview_quality)
+            self._encoded_sequence = 0
         self._loop_task = asyncio.create_task(self._preview_loop(), name="realsense-preview-loop")
 
     async def stop(self) -> None:
@@ -51,6 +73,9 @@ class RealSenseService:
         self._stop_event.set()
         await self._loop_task
         self._loop_task = None
+        if self._encoder is not None:
+            self._encoder.close()
+            self._encoder = None
         await self.set_hardware_active(False)
 
     async def preview_stream(self) -> AsyncIterator[bytes]:
@@ -97,11 +122,15 @@ class RealSenseService:
                 result: Optional[LivenessResult]
                 if self.enable_hardware and self._hardware_active and self._instance:
                     result = await self._run_process()
-                    frame_bytes = self._serialize_frame(result)
+                    if self._encoder is not None:
+                        frame_bytes = await self._encode_native(result)
+                    else:
+                        frame_bytes = self._serialize_frame(result)
                 else:
                     result = None
                     frame_bytes = self._placeholder_frame()
-                self._broadcast_frame(frame_bytes)
+                if frame_bytes is not None:
+                    self._broadcast_frame(frame_bytes)
                 self._broadcast_result(result)
                 await asyncio.sleep(1 / 15)
         except asyncio.CancelledError:  # pragma: no cover - cooperative cancel
@@ -119,6 +148,25 @@ class RealSenseService:
             loop = asyncio.get_running_loop()
             return await loop.run_in_executor(None, self._instance.process)
 
+    async def _encode_native(self, result: Optional[LivenessResult]) -> Optional[bytes]:
+        """Hand the frame to the native encoder; None when no newer JPEG is ready to broadcast."""
+
+        assert self._encoder is not None
+        if not result:
+            return self._placeholder_frame()
+        try:
+            self._encoder.submit(result.color_image)
+        except (TypeError, ValueError):
+            logger.exception("Native preview encoder rejected the frame; falling back to placeholder")
+            return self._placeholder_frame()
+        # The encode takes about a millisecond; wait for it off the event loop (the GIL is released).
+        loop = asyncio.get_running_loop()
+        frame = await loop.run_in_executor(None, self._encoder.wait_newer, self._encoded_sequence, 0.05)
+        if frame is None:
+            return None
+        self._encoded_sequence, payload = frame
+        return payload
+
     def _serialize_frame(self, result: Optional[LivenessResult]) -> bytes:
         if not result:
             return self._placeholder_frame()
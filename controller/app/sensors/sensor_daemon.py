@@ -0,0 +1,162 @@
+"""Async client for the sensor-daemon control socket (d435i/sensor_daemon.cpp)."""
+from __future__ import annotations
+
+import asyncio
+import json
+import logging
+import time
+from typing import Any, Dict, Optional
+
+logger = logging.getLogger(__name__)
+
+# Without a ToF event for this long the last distance is treated as missing; event-gated daemons still send
+# a heartbeat every second.
+_EVENT_STALE_MS = 1500
+_RECONNECT_S = 1.0
+# A reconfigure that restarts the ToF waits for its thread to stop, which may be in the middle of init().
+_REPLY_TIMEOUT_S = 5.0
+
+
+class SensorDaemonClient:
+    """Talks to a running sensor-daemon instead of spawning tof-reader; same interface as ToFReaderProcess."""
+
+    def __init__(self, *, socket_path: str, settings: Optional[Dict[str, Any]] = None) -> None:
+        self.socket_path = socket_path
+        # Sent as one reconfigure request after every connect, e.g. {"hz": 20, "wake_mm": 450}
+        self.settings = dict(settings or {})
+
+        self._reader: Optional[asyncio.StreamReader] = None
+        self._writer: Optional[asyncio.StreamWriter] = None
+        self._read_task: Optional[asyncio.Task[None]] = None
+        self._replies: asyncio.Queue[Dict[str, Any]] = asyncio.Queue()
+        # Requests given up on before their reply came. The daemon answers each connection in order, so
+        # the next this many replies are theirs.
+        self._abandoned = 0
+        self._request_lock = asyncio.Lock()
+        self._connect_lock = asyncio.Lock()
+        self._last_connect_attempt = 0.0
+        self._latest_distance: Optional[int] = None
+        self._latest_ms = 0.0
+        self._live: Optional[bool] = None
+
+    @property
+    def live(self) -> Optional[bool]:
+        """The daemon's last smoothed depth liveness verdict, None before the first one."""
+
+        return self._live
+
+    async def start(self) -> None:
+        """Connect to the daemon and start its ToF; the depth mode is left as the daemon was started."""
+
+        if self._writer is not None:
+            return
+        async with self._connect_lock:
+            if self._writer is not None:
+                return
+            self._last_connect_attempt = time.monotonic()
+            try:
+                self._reader, self._writer = await asyncio.open_unix_connection(self.socket_path)
+            except OSError as exc:
+                logger.error("sensor-daemon not reachable at %s: %s", self.socket_path, exc)
+                return
+            self._replies = asyncio.Queue()
+            self._abandoned = 0
+            self._read_task = asyncio.create_task(self._consume_events(), name="sensor-daemon-events")
+            if self.settings:
+                reply = await self.request("reconfigure", **self.settings)
+                if reply and not reply.get("ok"):
+                    logger.error("sensor-daemon rejected settings %s: %s", self.settings, reply.get("error"))
+            await self.request("start", sensor="tof")
+
+    async def stop(self) -> None:
+        """Disconnect. The daemon keeps running for its other clients."""
+
+        if self._read_task:
+            self._read_task.cancel()
+            await asyncio.gather(self._read_task, return_exceptions=True)
+            self._read_task = None
+        await self._close()
+
+    async def request(self, cmd: str, **fields: Any) -> Optional[Dict[str, Any]]:
+        """Send one request and wait for its reply; None when the daemon is gone."""
+
+        async with self._request_lock:
+            if self._writer is None:
+                return None
+            payload = dict(fields)
+            payload["cmd"] = cmd
+            try:
+                self._writer.write((json.dumps(payload) + "\n").encode("utf-8"))
+                await self._writer.drain()
+            except OSError as exc:
+                logger.warning("sensor-daemon request %s failed: %s", cmd, exc)
+                return None
+            deadline = time.monotonic() + _REPLY_TIMEOUT_S
+            while True:
+                try:
+                    reply = await asyncio.wait_for(self._replies.get(), timeout=max(0.0, deadline - time.monotonic()))
+                except asyncio.TimeoutError:
+                    # Its reply may still come; it must not be taken for the next request's
+                    self._abandoned += 1
+                    logger.warning("sensor-daemon request %s timed out", cmd)
+                    return None
+                if self._abandoned:
+                    self._abandoned -= 1
+                    continue
+                if reply.get("reply") != cmd:
+                    logger.warning("sensor-daemon answered %s with a reply to %s", cmd, reply.get("reply"))
+                    continue
+                return reply
+
+    async def get_distance(self) -> Optional[int]:
+        """Return the most recent ToF distance the daemon reported."""
+
+        if self._writer is None:
+            if time.monotonic() - self._last_connect_attempt >= _RECONNECT_S:
+                await self.start()
+            return None
+        if time.monotonic() * 1000 - self._latest_ms > _EVENT_STALE_MS:
+            return None
+        return self._latest_distance
+
+    async def _consume_events(self) -> None:
+        assert self._reader
+        try:
+            while True:
+                raw_line = await self._reader.readline()
+                if not raw_line:
+                    logger.warning("sensor-daemon closed the connection")
+                    break
+                try:
+                    message = json.loads(raw_line)
+                except json.JSONDecodeError:
+                    logger.debug("Unexpected sensor-daemon payload: %r", raw_line)
+                    continue
+                if "reply" in message:
+                    self._replies.put_nowait(message)
+                    continue
+                event = message.get("event")
+                if event == "tof":
+                    self._latest_distance = message.get("distance_mm") if message.get("status", 0) == 0 else None
+                    self._latest_ms = time.monotonic() * 1000
+                elif event == "liveness":
+                    self._live = bool(message.get("live"))
+                elif event == "error":
+                    logger.warning("sensor-daemon %s: %s", message.get("sensor"), message.get("message"))
+        except asyncio.CancelledError:
+            raise
+        except Exception as exc:  # pragma: no cover - defensive guard
+            logger.exception("Failed while reading sensor-daemon events: %s", exc)
+        finally:
+            await self._close()
+
+    async def _close(self) -> None:
+        writer, self._writer, self._reader = self._writer, None, None
+        if writer is not None:
+            writer.close()
+            try:
+                await writer.wait_closed()
+            except OSError:
+                pass
+        self._latest_distance = None
+        self._live = None
@@ -4,11 +4,24 @@ from __future__ import annotations
 import asyncio
 import json
 import logging
+import struct
+import time
 from pathlib import Path
 from typing import Optional
 
+from .tof_shm import ToFSharedMemory, ToFShmSample
+
 logger = logging.getLogger(__name__)
 
+# Binary stream emitted by `tof-reader --binary` (see controller/tof/include/sample_writer.hpp).
+_BINARY_MAGIC = b"TOFR"
+_BINARY_VERSION = 1
+_BINARY_HEADER = struct.Struct("<4sHH")
+_BINARY_RECORD = struct.Struct("<QIHHf")  # prefix of each record; later fields are skipped
+
+# Shared-memory samples older than this are treated as missing.
+_SHM_STALE_MS = 500
+
 
 class ToFReaderProcess:
     """Spawns the C++ tof-reader binary and streams distance measurements."""
@@ -21,11 +34,38 @@ class ToFReaderProcess:
         i2c_address: int,
         xshut_path: Optional[str],
         output_hz: int,
+        gpio1_path: Optional[str] = None,
+        continuous: bool = False,
+        binary_output: bool = False,
+        shm_name: Optional[str] = None,
+        calibration_cache: Optional[str] = None,
+        filter_kind: Optional[str] = None,
+        adaptive_timing: bool = False,
+        sched_fifo: int = 0,
+        cpu_affinity: Optional[str] = None,
+        mlock: bool = False,
+        metrics_path: Optional[str] = None,
+        event_mode: bool = False,
+        event_threshold_mm: Optional[int] = None,
     ) -> None:
         self.binary_path = binary_path
         self.i2c_bus = i2c_bus
         self.i2c_address = i2c_address
         self.xshut_path = xshut_path
+        self.gpio1_path = gpio1_path
+        self.continuous = continuous
+        self.binary_output = binary_output
+        self.shm_name = shm_name
+        self._shm = ToFSharedMemory(shm_name) if shm_name else None
+        self.calibration_cache = calibration_cache
+        self.filter_kind = filter_kind
+        self.adaptive_timing = adaptive_timing
+        self.sched_fifo = sched_fifo
+        self.cpu_affinity = cpu_affinity
+        self.mlock = mlock
+        self.metrics_path = metrics_path
+        self.event_mode = event_mode
+        self.event_threshold_mm = event_threshold_mm
         self.output_hz = output_hz
 
         self._proc: Optional[asyncio.subprocess.Process] = None
@@ -61,6 +101,38 @@ class ToFReaderProcess:
             ]
             if self.xshut_path:
                 cmd.extend(["--xshut", self.xshut_path])
+            if self.gpio1_path:
+                cmd.extend(["--gpio1", self.gpio1_path])
+            if self.continuous:
+                cmd.append("--continuous")
+            if self.binary_output:
+                cmd.append("--binary")
+            if self.shm_name:
+                # Samples are read straight from shared memory; stdout stays silent.
+                cmd.extend(["--shm", self.shm_name, "--no-stdout"])
+            if self.calibration_cache:
+                cmd.extend(["--calibration-cache", self.calibration_cache])
+            if self.filter_kind:
+                cmd.extend(["--filter", self.filter_kind])
+            if self.adaptive_timing:
+                cmd.append("--adaptive")
+            if self.sched_fifo > 0:
+                cmd.extend(["--sched-fifo", str(self.sched_fifo)])
+            if self.cpu_affinity:
+                cmd.extend(["--cpu-acquisition", self.cpu_affinity])
+            if self.mlock:
+                cmd.append("--mlock")
+            if self.metrics_path:
+                cmd.extend(["--metrics", self.metrics_path])
+            if self.event_mode and self._shm is None:
+                # Only crossings of the trigger threshold, big moves and a 1 s heartbeat reach stdout.
+                cmd.append("--events")
+                if self.event_threshold_mm is not None:
+                    cmd.extend(["--threshold", str(self.event_threshold_mm)])
+
+            if self._shm is not None:
+                # The previous reader unlinked its segment on exit; map the new one once it is there.
+                self._shm.close()
 
             logger.info("Starting tof-reader process: %s", " ".join(cmd))
             self._proc = await asyncio.create_subprocess_exec(
@@ -69,7 +141,8 @@ class ToFReaderProcess:
                 stderr=asyncio.subprocess.PIPE,
             )
             self._ready_event.clear()
-            self._stdout_task = asyncio.create_task(self._consume_stdout(), name="tof-reader-stdout")
+            if self._shm is None:
+                self._stdout_task = asyncio.create_task(self._consume_stdout(), name="tof-reader-stdout")
             if self._proc.stderr:
                 self._stderr_task = asyncio.create_task(self._consume_stderr(), name="tof-reader-stderr")
 
@@ -99,6 +172,8 @@ class ToFReaderProcess:
         if tasks:
             await asyncio.gather(*tasks, return_exceptions=True)
 
+        if self._shm is not None:
+            self._shm.close()
         self._latest_distance = None
         self._ready_event.clear()
 
@@ -109,6 +184,9 @@ class ToFReaderProcess:
             # Process died; attempt a restart on the next loop.
             await self.start()
 
+        if self._shm is not None:
+            return self._read_shm_distance()
+
         if not self._ready_event.is_set():
             try:
                 await asyncio.wait_for(self._ready_event.wait(), timeout=0.5)
@@ -117,9 +195,27 @@ class ToFReaderProcess:
 
         return self._latest_distance
 
+    def _read_shm_distance(self) -> Optional[int]:
+        assert self._shm is not None
+        sample = self._shm.read_latest()
+        if not self._is_fresh(sample) and self._shm.replaced():
+            # Mapped before the current reader created its segment; costs a stat only while samples are stale.
+            self._shm.close()
+            sample = self._shm.read_latest()
+        if sample is None or not self._is_fresh(sample) or sample.status != 0:
+            return None
+        return sample.distance_mm
+
+    @staticmethod
+    def _is_fresh(sample: Optional[ToFShmSample]) -> bool:
+        return sample is not None and time.monotonic() * 1000 - sample.timestamp_ms <= _SHM_STALE_MS
+
     async def _consume_stdout(self) -> None:
         assert self._proc and self._proc.stdout
         try:
+            if self.binary_output:
+                await self._consume_binary(self._proc.stdout)
+                return
             while True:
                 raw_line = await self._proc.stdout.readline()
                 if not raw_line:
@@ -130,6 +226,9 @@ class ToFReaderProcess:
                 distance = self._parse_distance(line)
                 if distance is None:
                     logger.debug("Unexpected tof-reader payload: %s", line)
+                    if self.event_mode:
+                        # No further line until the reading changes again; do not keep the old one.
+                        self._latest_distance = None
                     continue
                 self._latest_distance = distance
                 self._ready_event.set()
@@ -144,6 +243,31 @@ class ToFReaderProcess:
             self._ready_event.clear()
             self._latest_distance = None
 
+    async def _consume_binary(self, stream: asyncio.StreamReader) -> None:
+        try:
+            header = await stream.readexactly(_BINARY_HEADER.size)
+        except asyncio.IncompleteReadError:
+            return
+        magic, version, record_size = _BINARY_HEADER.unpack(header)
+        if magic != _BINARY_MAGIC or version != _BINARY_VERSION or record_size < _BINARY_RECORD.size:
+            logger.error(
+                "Unsupported tof-reader binary stream (magic=%r version=%s record_size=%s)",
+                magic,
+                version,
+                record_size,
+            )
+            return
+        while True:
+            try:
+                record = await stream.readexactly(record_size)
+            except asyncio.IncompleteReadError:
+                return
+            _timestamp_ms, _sequence, distance, status, _signal = _BINARY_RECORD.unpack_from(record)
+            if status != 0:
+                continue
+            self._latest_distance = distance
+            self._ready_event.set()
+
     async def _consume_stderr(self) -> None:
         assert self._proc and self._proc.stderr
         try:
@@ -168,6 +292,8 @@ class ToFReaderProcess:
                 payload = json.loads(line)
             except json.JSONDecodeError:
                 return None
+            if payload.get("status", 0) != 0:
+                return None
             try:
                 distance = int(payload.get("distance_mm"))
             except (TypeError, ValueError):
@@ -0,0 +1,103 @@
+"""Reader for the shared-memory channel published by `tof-reader --shm`."""
+from __future__ import annotations
+
+import logging
+import mmap
+import os
+import struct
+from dataclasses import dataclass
+from typing import Optional
+
+logger = logging.getLogger(__name__)
+
+# Mirrors ShmLayout in controller/tof/include/shm_channel.hpp (native byte order).
+_MAGIC = b"TOFS"
+_VERSION = 1
+_HEADER = struct.Struct("=4sHHIIQ")
+_SAMPLE = struct.Struct("=QIHHfHH")
+_SEQ_OFFSET = 8
+_LATEST_OFFSET = _HEADER.size
+_MAX_RETRIES = 16
+
+
+@dataclass(frozen=True)
+class ToFShmSample:
+    timestamp_ms: int
+    sequence: int
+    distance_mm: int
+    status: int
+    signal_rate: float
+    sensor_id: int = 0
+
+
+class ToFSharedMemory:
+    """Maps the tof-reader segment read-only and returns the latest sample without syscalls."""
+
+    def __init__(self, name: str) -> None:
+        self.name = name
+        self._path = os.path.join("/dev/shm", name.lstrip("/"))
+        self._map: Optional[mmap.mmap] = None
+        self._inode = 0
+
+    def open(self) -> bool:
+        if self._map is not None:
+            return True
+        path = self._path
+        try:
+            fd = os.open(path, os.O_RDONLY)
+        except FileNotFoundError:
+            return False
+        try:
+            stat = os.fstat(fd)
+            size = stat.st_size
+            if size < _LATEST_OFFSET + _SAMPLE.size:
+                return False
+            shm = mmap.mmap(fd, size, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+
+        magic, version, _history, _seq, _pid, _count = _HEADER.unpack_from(shm, 0)
+        if magic != _MAGIC or version != _VERSION:
+            logger.error("Unsupported tof-reader shared memory %s (magic=%r version=%s)", path, magic, version)
+            shm.close()
+            return False
+        self._map = shm
+        self._inode = stat.st_ino
+        return True
+
+    def close(self) -> None:
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+
+    def replaced(self) -> bool:
+        """True when the name no longer leads to the mapped segment: a restarted tof-reader unlinks the old one."""
+
+        if self._map is None:
+            return False
+        try:
+            return os.stat(self._path).st_ino != self._inode
+        except FileNotFoundError:
+            return True
+
+    def read_latest(self) -> Optional[ToFShmSample]:
+        """Return the most recent sample, or None if nothing was published or the writer kept it busy."""
+
+        if self._map is None and not self.open():
+            return None
+        shm = self._map
+        assert shm is not None
+        for _ in range(_MAX_RETRIES):
+            (seq_before,) = struct.unpack_from("=I", shm, _SEQ_OFFSET)
+            if seq_before & 1:
+                continue
+            (count,) = struct.unpack_from("=Q", shm, _SEQ_OFFSET + 8)
+            fields = _SAMPLE.unpack_from(shm, _LATEST_OFFSET)
+            (seq_after,) = struct.unpack_from("=I", shm, _SEQ_OFFSET)
+            if seq_before != seq_after:
+                continue
+            if count == 0:
+                return None
+            timestamp_ms, sequence, distance_mm, status, signal_rate, sensor_id, _reserved = fields
+            return ToFShmSample(timestamp_ms, sequence, distance_mm, status, signal_rate, sensor_id)
+        return None
@@ -7,13 +7,14 @@ import base64
 import logging
 import time
 from dataclasses import dataclass, field
-from typing import Any, AsyncIterator, Dict, List, Optional
+from typing import Any, AsyncIterator, Dict, List, Optional, Union
 from urllib.parse import urlparse
 
 from .backend.http_client import BridgeHttpClient
 from .backend.ws_client import BackendWebSocketClient
 from .config import Settings, get_settings
 from .sensors.realsense import RealSenseService
+from .sensors.sensor_daemon import SensorDaemonClient
 from .sensors.tof import DistanceProvider, ToFSensor, mock_distance_provider
 from .sensors.tof_process import ToFReaderProcess
 from .state import ControllerEvent, SessionPhase
@@ -47,14 +48,33 @@ class SessionManager:
         self._ui_subscribers: List[asyncio.Queue[ControllerEvent]] = []
         self._current_session = SessionContext()
 
-        self._tof_process: Optional[ToFReaderProcess] = None
+        self._tof_process: Optional[Union[ToFReaderProcess, SensorDaemonClient]] = None
         if tof_distance_provider is None:
-            if self.settings.tof_reader_binary:
+            if self.settings.sensor_daemon_socket:
+                self._tof_process = SensorDaemonClient(
+                    socket_path=self.settings.sensor_daemon_socket,
+                    settings={"hz": self.settings.tof_output_hz},
+                )
+                tof_distance_provider = self._tof_process.get_distance
+            elif self.settings.tof_reader_binary:
                 self._tof_process = ToFReaderProcess(
                     binary_path=self.settings.tof_reader_binary,
                     i2c_bus=self.settings.tof_i2c_bus,
                     i2c_address=self.settings.tof_i2c_address,
                     xshut_path=self.settings.tof_xshut_path,
+                    gpio1_path=self.settings.tof_gpio1_path,
+                    continuous=self.settings.tof_continuous,
+                    binary_output=self.settings.tof_binary_output,
+                    shm_name=self.settings.tof_shm_name,
+                    calibration_cache=self.settings.tof_calibration_cache,
+                    filter_kind=self.settings.tof_filter,
+                    adaptive_timing=self.settings.tof_adaptive_timing,
+                    sched_fifo=self.settings.tof_sched_fifo,
+                    cpu_affinity=self.settings.tof_cpu_affinity,
+                    mlock=self.settings.tof_mlock,
+                    metrics_path=self.settings.tof_metrics_path,
+                    event_mode=self.settings.tof_event_mode,
+                    event_threshold_mm=self.settings.tof_threshold_mm,
                     output_hz=self.settings.tof_output_hz,
                 )
                 tof_distance_provider = self._tof_process.get_distance
@@ -68,7 +88,12 @@ class SessionManager:
         )
         self._tof.register_callback(self._handle_tof_trigger)
 
-        self._realsense = RealSenseService(enable_hardware=self.settings.realsense_enable_hardware)
+        self._realsense = RealSenseService(
+            enable_hardware=self.settings.realsense_enable_hardware,
+            preview_width=self.settings.preview_frame_width,
+            preview_height=self.settings.preview_frame_height,
+            preview_quality=self.settings.preview_jpeg_quality,
+        )
         self._http_client = BridgeHttpClient(self.settings)
         self._ws_client = BackendWebSocketClient(self.settings)
 
@@ -0,0 +1,206 @@
+// Microbenchmarks for the VL53L0X register paths against I2Cmock and VL53L0Xsim. The mocks count the
+// bus transfers I2Cdev would issue, so `i2c_transfers` is the number of ioctl()s per operation on real
+// hardware.
+// Build the `bench` target to run them and write tof-bench.json.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <vl53lXx/interfaces/i2cmock.hpp>
+#include <vl53lXx/interfaces/vl53l0x_sim.hpp>
+#include <vl53lXx/vl53l0x.hpp>
+#include <vl53lXx/vl53l0x_defines.hpp>
+
+namespace {
+
+void set_transfer_counters(benchmark::State& state, const I2Cmock& bus) {
+    const double ops = static_cast<double>(state.iterations());
+    state.counters["i2c_transfers"] = static_cast<double>(bus.counters().transfers) / ops;
+    state.counters["i2c_bytes"] = static_cast<double>(bus.counters().bytesRead + bus.counters().bytesWritten) / ops;
+}
+
+// A sensor with a result pending: interrupt status set and 500 mm in the range register.
+I2Cmock* ready_bus() {
+    I2Cmock* bus = new I2Cmock(VL53L0X_ADDRESS_DEFAULT);
+    bus->registers[RESULT_INTERRUPT_STATUS] = 0x07;
+    bus->registers[RESULT_RANGE_STATUS + 10] = 0x01;
+    bus->registers[RESULT_RANGE_STATUS + 11] = 0xF4;
+    return bus;
+}
+
+void BM_MockReadByte(benchmark::State& state) {
+    I2Cmock bus;
+    uint8_t value = 0;
+    for (auto _ : state) {
+        bus.readByte(static_cast<uint8_t>(RESULT_INTERRUPT_STATUS), &value);
+        benchmark::DoNotOptimize(value);
+    }
+    set_transfer_counters(state, bus);
+}
+BENCHMARK(BM_MockReadByte);
+
+void BM_MockReadBytes(benchmark::State& state) {
+    I2Cmock bus;
+    uint8_t buffer[64];
+    const uint8_t length = static_cast<uint8_t>(state.range(0));
+    for (auto _ : state) {
+        bus.readBytes(static_cast<uint8_t>(RESULT_RANGE_STATUS), length, buffer);
+        benchmark::DoNotOptimize(buffer);
+    }
+    set_transfer_counters(state, bus);
+}
+BENCHMARK(BM_MockReadBytes)->Arg(2)->Arg(12);
+
+// Batched writes against the byte-at-a-time fallback in I2Cgeneric::writeBatch().
+void BM_MockWriteBatch(benchmark::State& state) {
+    I2Cmock bus;
+    I2CRegisterWrite writes[80];
+    const uint16_t count = static_cast<uint16_t>(state.range(0));
+    for (uint16_t i = 0; i < count; i++) {
+        writes[i] = {static_cast<uint8_t>(i), static_cast<uint8_t>(i * 3)};
+    }
+    const bool batched = state.range(1) != 0;
+    for (auto _ : state) {
+        bool ok = batched ? bus.writeBatch(writes, count) : bus.I2Cgeneric::writeBatch(writes, count);
+        benchmark::DoNotOptimize(ok);
+    }
+    set_transfer_counters(state, bus);
+}
+BENCHMARK(BM_MockWriteBatch)->Args({8, 1})->Args({8, 0})->Args({80, 1})->Args({80, 0});
+
+// What the tof-reader loop does per sample in continuous mode.
+void BM_ReadRangeContinuous(benchmark::State& state) {
+    I2Cmock* bus = ready_bus();
+    VL53L0X sensor(bus);
+    const bool blocking = state.range(0) != 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readRangeContinuousMillimeters(blocking));
+        // The driver clears the interrupt after each read; raise it again for the next one.
+        bus->registers[RESULT_INTERRUPT_STATUS] = 0x07;
+    }
+    set_transfer_counters(state, *bus);
+}
+BENCHMARK(BM_ReadRangeContinuous)->Arg(0)->Arg(1);
+
+// Polling with no result pending: the cost of an early exit in non-blocking mode.
+void BM_ReadRangeNotReady(benchmark::State& state) {
+    I2Cmock* bus = new I2Cmock(VL53L0X_ADDRESS_DEFAULT);
+    VL53L0X sensor(bus);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readRangeContinuousMillimeters(false));
+    }
+    set_transfer_counters(state, *bus);
+}
+BENCHMARK(BM_ReadRangeNotReady);
+
+// Triggering a single-shot measurement without waiting for it.
+void BM_StartRangeSingle(benchmark::State& state) {
+    I2Cmock* bus = new I2Cmock(VL53L0X_ADDRESS_DEFAULT);
+    VL53L0X sensor(bus);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readRangeSingleMillimeters(false));
+    }
+    set_transfer_counters(state, *bus);
+}
+BENCHMARK(BM_StartRangeSingle);
+
+// The rest runs on the VL53L0Xsim register model with zero ranging time, so only the driver's own
+// register traffic is measured.
+VL53L0XSimConfig instant_sim() {
+    VL53L0XSimConfig config;
+    config.measurementMicroseconds = 0;
+    return config;
+}
+
+// Full DataInit/StaticInit/RefCalibration sequence plus the timing budget tof-reader applies.
+void BM_SensorInit(benchmark::State& state) {
+    uint64_t transfers = 0;
+    for (auto _ : state) {
+        VL53L0Xsim* bus = new VL53L0Xsim(instant_sim());
+        VL53L0X sensor(bus);
+        sensor.setTimeout(200);
+        sensor.init();
+        sensor.setMeasurementTimingBudget(50000);
+        transfers += bus->counters().transfers;
+    }
+    state.counters["i2c_transfers"] = static_cast<double>(transfers) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_SensorInit);
+
+// Same, restoring the calibration the full init produced (tof-reader --calibration-cache). The restore and
+// read-back cost about what the two reference calibrations do in transfers; on the device the win is the
+// two skipped ranging cycles, which the model's measurementMicroseconds = 0 leaves out here.
+void BM_SensorInitCached(benchmark::State& state) {
+    VL53L0XCalibration calibration;
+    {
+        VL53L0X sensor(new VL53L0Xsim(instant_sim()));
+        sensor.setTimeout(200);
+        sensor.init();
+        sensor.getCalibration(&calibration);
+    }
+    uint64_t transfers = 0;
+    for (auto _ : state) {
+        VL53L0Xsim* bus = new VL53L0Xsim(instant_sim());
+        VL53L0X sensor(bus);
+        sensor.setTimeout(200);
+        if (!sensor.init(calibration)) {
+            state.SkipWithError("cached calibration rejected");
+            break;
+        }
+        sensor.setMeasurementTimingBudget(50000);
+        transfers += bus->counters().transfers;
+    }
+    state.counters["i2c_transfers"] = static_cast<double>(transfers) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_SensorInitCached);
+
+// Blocking single shot: trigger, wait for SYSRANGE_START to clear, read the result.
+void BM_ReadRangeSingle(benchmark::State& state) {
+    VL53L0Xsim* bus = new VL53L0Xsim(instant_sim());
+    VL53L0X sensor(bus);
+    sensor.setTimeout(200);
+    sensor.init();
+    bus->resetCounters();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readRangeSingleMillimeters(true));
+    }
+    set_transfer_counters(state, *bus);
+}
+BENCHMARK(BM_ReadRangeSingle);
+
+// Back-to-back continuous ranging as tof-reader --continuous reads it.
+void BM_ReadRangeBackToBack(benchmark::State& state) {
+    VL53L0Xsim* bus = new VL53L0Xsim(instant_sim());
+    VL53L0X sensor(bus);
+    sensor.setTimeout(200);
+    sensor.init();
+    sensor.startContinuous();
+    bus->resetCounters();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readRangeContinuousMillimeters(true));
+    }
+    set_transfer_counters(state, *bus);
+}
+BENCHMARK(BM_ReadRangeBackToBack);
+
+// The burst result read tof-reader uses: status and result block in one transfer when a sample is waiting.
+void BM_ReadRangingData(benchmark::State& state) {
+    VL53L0Xsim* bus = new VL53L0Xsim(instant_sim());
+    VL53L0X sensor(bus);
+    sensor.setTimeout(200);
+    sensor.init();
+    sensor.startContinuous();
+    bus->resetCounters();
+    const bool blocking = state.range(0) != 0;
+    VL53L0XRangingData data;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readRangingData(&data, blocking));
+    }
+    set_transfer_counters(state, *bus);
+}
+BENCHMARK(BM_ReadRangingData)->Arg(0)->Arg(1);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <vl53lXx/vl53l0x_defines.hpp>
+
+// Saved VL53L0X reference SPAD and VHV/phase calibrations, one line per sensor keyed by bus and address,
+// so a restart can call VL53L0X::init(calibration) instead of re-running the calibration measurements.
+//
+//   # tof-reader calibration cache v1
+//   <bus> <address hex> <spad count> <aperture 0|1> <ref SPAD map, 12 hex digits> <vhv hex> <phase hex> <unix time>
+
+// The entry for bus/address if it is plausible and at most max_age_s old (0 = no age limit).
+std::optional<VL53L0XCalibration> load_calibration(const std::string& path, const std::string& bus,
+                                                   uint8_t address, uint32_t max_age_s);
+// Adds or replaces the entry for bus/address, keeping the others; the file is replaced atomically.
+bool save_calibration(const std::string& path, const std::string& bus, uint8_t address,
+                      const VL53L0XCalibration& calibration);
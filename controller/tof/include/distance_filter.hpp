@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tof_reader.hpp"
+
+enum class FilterKind {
+    None,
+    Median,  // median of the last median_window valid ranges
+    Ema,     // exponential moving average
+    Kalman,  // 1D constant-position Kalman filter
+};
+
+struct FilterConfig {
+    FilterKind kind = FilterKind::None;
+    size_t median_window = 5;  // odd, at most kMaxMedianWindow
+    float ema_alpha = 0.3f;  // weight of the newest range
+    float kalman_process_noise = 1000.0f;  // mm^2 per second the target may move
+    float kalman_measurement_noise = 100.0f;  // mm^2, the sensor's range variance
+    uint64_t reset_after_ms = 500;  // a gap this long without a valid range restarts the filter
+};
+
+// Smooths distance_mm of valid samples (status 0), separately per sensor_id. Samples without a valid
+// range pass through unchanged and do not touch the state; the raw stream stays available for --record.
+class DistanceFilter {
+  public:
+    static constexpr size_t kMaxMedianWindow = 15;
+
+    explicit DistanceFilter(const FilterConfig& config = FilterConfig());
+
+    ToFMeasurement apply(const ToFMeasurement& measurement);
+    bool enabled() const { return config_.kind != FilterKind::None; }
+
+  private:
+    struct State {
+        uint64_t last_ms = 0;
+        bool primed = false;
+        float estimate = 0.0f;  // EMA / Kalman
+        float variance = 0.0f;  // Kalman
+        uint16_t window[kMaxMedianWindow] = {};  // median ring
+        size_t count = 0;
+        size_t next = 0;
+    };
+
+    float update(State& state, float range, uint64_t timestamp_ms);
+
+    FilterConfig config_;
+    std::vector<State> states_;  // indexed by sensor_id
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tof_reader.hpp"
+
+struct EventConfig {
+    std::vector<uint16_t> thresholds_mm;  // zone boundaries; crossing one is an event
+    uint16_t hysteresis_mm = 20;  // a range must pass a boundary by this much to change zone
+    uint16_t delta_mm = 0;  // also an event when the range moved this far since the last one; 0 = off
+    uint64_t heartbeat_ms = 1000;  // re-send the current sample after this long without an event; 0 = never
+};
+
+// Decides which samples are worth emitting in --events mode, per sensor_id: the first one, zone changes,
+// changes between a valid range and none, moves of more than delta_mm, and a heartbeat so a consumer can
+// tell a quiet scene from a dead reader.
+class EventGate {
+  public:
+    explicit EventGate(const EventConfig& config);
+
+    bool should_emit(const ToFMeasurement& measurement, uint64_t now_ms);
+    // The heartbeat on the gate's own clock, for a reader that has stopped delivering samples (timeouts, a
+    // hung bus): appends a no-range sample for every sensor silent for heartbeat_ms, already passed through
+    // should_emit(). Live runs only; a replay has no clock but its samples'.
+    void heartbeat(uint64_t now_ms, std::vector<ToFMeasurement>& out);
+    // When heartbeat() next has something to append; UINT64_MAX without a heartbeat or a sensor seen.
+    uint64_t next_heartbeat_ms() const;
+
+  private:
+    struct State {
+        bool seen = false;
+        bool valid = false;
+        size_t zone = 0;  // number of thresholds below the range
+        uint16_t emitted_mm = 0;
+        uint64_t emitted_ms = 0;
+        uint64_t sample_ms = 0;  // the last should_emit(), emitted or not
+    };
+
+    size_t zone_for(size_t current, uint16_t distance_mm) const;
+
+    EventConfig config_;
+    std::vector<State> states_;  // indexed by sensor_id
+};
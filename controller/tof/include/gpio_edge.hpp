@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+// Edge-triggered wait on a sysfs GPIO value file (e.g. /sys/class/gpio/gpio17/value).
+// The pin must already be exported and configured as an input.
+class GpioEdge {
+  public:
+    GpioEdge() = default;
+    ~GpioEdge();
+
+    GpioEdge(const GpioEdge&) = delete;
+    GpioEdge& operator=(const GpioEdge&) = delete;
+
+    // Configures the sibling "edge" file and opens the value file for poll().
+    bool open(const std::string& value_path, const std::string& edge = "falling");
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Consumes any edge that is already pending so the next wait() only sees new ones.
+    void clear();
+    // Returns 1 when an edge fired, 0 on timeout and -1 on error.
+    int wait(int timeout_ms);
+
+  private:
+    int fd_ = -1;
+};
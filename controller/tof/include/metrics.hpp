@@ -0,0 +1,79 @@
+#pragma once
+
+// Prometheus text metrics behind --metrics of tof-reader, d435i-liveness and sensor-daemon, so every sensor
+// tool writes the same file format and histogram buckets.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+// Latency histogram with Prometheus-style cumulative buckets from 50 us to 1 s. record() is lock-free,
+// so the sensor threads record while the metrics thread reads.
+class LatencyHistogram {
+  public:
+    void record(int64_t us);
+
+    static constexpr size_t kBounds = 13;
+    static const int64_t kBoundsUs[kBounds];
+
+  private:
+    friend class MetricsText;
+    std::atomic<uint64_t> buckets_[kBounds + 1] = {};  // per bucket, not cumulative; the last is +Inf
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+};
+
+// Prometheus text exposition format (version 0.0.4), written one metric family at a time.
+class MetricsText {
+  public:
+    // HELP and TYPE lines; the samples of that family follow.
+    void family(const char* name, const char* type, const char* help);
+    // `labels` is the inside of the braces, e.g. sensor="0"; empty for none.
+    void sample(const char* name, uint64_t value, const std::string& labels = "");
+    void sample(const char* name, double value, const std::string& labels = "");
+    // _bucket, _sum and _count samples in seconds; call family(name, "histogram", ...) first.
+    void histogram(const char* name, const LatencyHistogram& histogram, const std::string& labels = "");
+
+    const std::string& str() const { return text_; }
+
+  private:
+    std::string text_;
+};
+
+// Rewrites `path` with collect()'s text every interval_ms from a thread of its own, through a temporary
+// file and rename(), so readers (node_exporter's textfile collector, the controller) never see half a file.
+class MetricsFile {
+  public:
+    MetricsFile(std::string path, uint64_t interval_ms, std::function<std::string()> collect);
+    ~MetricsFile();
+
+    MetricsFile(const MetricsFile&) = delete;
+    MetricsFile& operator=(const MetricsFile&) = delete;
+
+    void start();
+    // Writes once more, so the file ends with the final totals, and joins the thread.
+    void stop();
+
+  private:
+    void run();
+    bool write_file(const std::string& text) const;
+
+    std::string path_;
+    uint64_t interval_ms_;
+    std::function<std::string()> collect_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// CPU time (user + system) of the whole process and of one thread, in seconds; 0 if unavailable.
+double process_cpu_seconds();
+double thread_cpu_seconds(pthread_t thread);
@@ -0,0 +1,63 @@
+#pragma once
+
+// Thread scheduling, memory locking and wake-up latency histograms behind --sched-fifo, --mlock and the
+// latency reports of tof-reader, d435i-liveness and sensor-daemon, so all of them take the same flags and
+// print the same report lines.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scheduling of one thread of a sensor process (tof-reader's acquisition, d435i-liveness's processing).
+struct ThreadRealtime {
+    int fifo_priority = 0;  // SCHED_FIFO 1-99; 0 = keep the default policy
+    std::vector<int> cpus;  // pin to these CPUs; empty = any
+};
+
+// "3", "2,3" or "0-1,3"; false on anything else.
+bool parse_cpu_list(const char* text, std::vector<int>& cpus);
+
+// Shows up in top -H and /proc/<pid>/task/*/comm; keep the main thread's name, pkill matches on it.
+void set_thread_name(const char* name);
+
+// Applies `rt` to the calling thread; `name` is for messages. Failures (no CAP_SYS_NICE or RLIMIT_RTPRIO
+// for SCHED_FIFO, a CPU that does not exist) are reported on stderr and leave the thread as it was.
+bool apply_thread_realtime(const char* name, const ThreadRealtime& rt);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE): everything mapped now and later stays resident, so a wake-up never
+// waits on a page fault. Also keeps malloc from handing freed memory back to the kernel, which would
+// make the next allocation fault again. Call after the long-lived buffers exist and before starting threads
+// (for librealsense, before pipe.start(), so its frame pools are covered too).
+bool lock_process_memory();
+
+// Touches `bytes` of the calling thread's stack so deep calls later do not fault it in.
+void prefault_stack(size_t bytes = 256 * 1024);
+
+// Latency samples in microseconds, e.g. how late a loop woke up relative to the deadline it slept until.
+// Fixed buckets, so record() never allocates; percentiles are accurate to the bucket width (10 us up to
+// 10 ms, 1 ms above).
+class WakeLatency {
+  public:
+    void record(int64_t late_us);
+    void reset();
+
+    uint64_t count() const { return count_; }
+    int64_t max_us() const { return max_us_; }
+    double mean_us() const { return count_ ? static_cast<double>(total_us_) / static_cast<double>(count_) : 0.0; }
+    int64_t percentile_us(double fraction) const;
+
+    // Writes "<program> <name> latency: n=... mean=...us p50=...us p99=...us max=...us\n" to stderr in one
+    // write(), so it does not interleave with other threads' lines.
+    void report(const char* name) const;
+
+  private:
+    static constexpr size_t kFineBuckets = 1000;  // 10 us each, up to 10 ms
+    static constexpr int64_t kFineWidthUs = 10;
+    static constexpr size_t kCoarseBuckets = 100;  // 1 ms each, up to 110 ms; the last one takes the rest
+    static constexpr int64_t kCoarseWidthUs = 1000;
+
+    uint32_t buckets_[kFineBuckets + kCoarseBuckets] = {};
+    uint64_t count_ = 0;
+    int64_t total_us_ = 0;
+    int64_t max_us_ = 0;
+};
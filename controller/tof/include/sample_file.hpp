@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tof_reader.hpp"
+
+// Read-only mapping of a binary sample stream as written by SampleWriter (see sample_writer.hpp),
+// e.g. a tof-reader --record file. Records are decoded in place; nothing is copied up front.
+class SampleFile {
+  public:
+    SampleFile() = default;
+    ~SampleFile();
+
+    SampleFile(const SampleFile&) = delete;
+    SampleFile& operator=(const SampleFile&) = delete;
+
+    // Fails on a missing file, a bad magic/version or a record size older than this reader knows.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return data_ != nullptr; }
+
+    // Complete records only; a truncated trailing record is ignored.
+    size_t size() const { return count_; }
+    ToFMeasurement at(size_t index) const;
+
+  private:
+    const uint8_t* data_ = nullptr;
+    size_t length_ = 0;
+    size_t record_size_ = 0;
+    size_t count_ = 0;
+};
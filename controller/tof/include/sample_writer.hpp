@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tof_reader.hpp"
+
+enum class OutputFormat {
+    Json,
+    Plain,
+    Binary,
+};
+
+// Binary stream layout (all fields little-endian):
+//   header, once:  char magic[4] = "TOFR", uint16 version, uint16 record_size
+//   record:        uint64 timestamp_ms, uint32 sequence, uint16 distance_mm,
+//                  uint16 status, float32 signal_rate, uint16 sensor_id, uint16 reserved,
+//                  float32 ambient_rate
+// Readers must step by the header's record_size: fields are only ever appended.
+constexpr char kBinaryMagic[4] = {'T', 'O', 'F', 'R'};
+constexpr uint16_t kBinaryVersion = 1;
+constexpr size_t kBinaryHeaderSize = 8;
+constexpr size_t kBinaryRecordSize = 28;
+constexpr size_t kBinaryMinRecordSize = 24;  // records written before ambient_rate was appended
+
+// Buffers formatted samples and writes them to a file descriptor in one write() per flush.
+class SampleWriter {
+  public:
+    SampleWriter(int fd, OutputFormat format);
+
+    void append(const ToFMeasurement& measurement);
+    bool flush();
+    bool empty() const { return buffer_.empty(); }
+
+  private:
+    int fd_;
+    OutputFormat format_;
+    std::string buffer_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tof_reader.hpp"
+
+// Shared-memory layout published by tof-reader --shm (all fields native-endian).
+//
+// `seq` is a seqlock: the publisher makes it odd, updates `latest`, the
+// history slot and `write_count`, then makes it even again. Readers copy the
+// fields they need and retry while `seq` is odd or changed during the copy.
+// `history[i % kShmHistoryLength]` holds the i-th published sample.
+constexpr char kShmMagic[4] = {'T', 'O', 'F', 'S'};
+constexpr uint16_t kShmVersion = 1;
+constexpr size_t kShmHistoryLength = 32;
+
+struct ShmSample {
+    uint64_t timestamp_ms;  // steady clock (CLOCK_MONOTONIC) milliseconds
+    uint32_t sequence;
+    uint16_t distance_mm;
+    uint16_t status;
+    float signal_rate;
+    uint16_t sensor_id;
+    uint16_t reserved;
+};
+static_assert(sizeof(ShmSample) == 24, "ShmSample layout is part of the shared-memory ABI");
+
+struct ShmLayout {
+    char magic[4];
+    uint16_t version;
+    uint16_t history_length;
+    std::atomic<uint32_t> seq;
+    uint32_t publisher_pid;
+    uint64_t write_count;
+    ShmSample latest;
+    ShmSample history[kShmHistoryLength];
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock must be usable across processes");
+
+// Owns the POSIX shared-memory segment and publishes samples into it from a single thread.
+class ShmPublisher {
+  public:
+    ShmPublisher() = default;
+    ~ShmPublisher();
+
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    // name follows shm_open() rules, e.g. "/tof-reader".
+    bool open(const std::string& name);
+    void close();
+    bool is_open() const { return layout_ != nullptr; }
+
+    void publish(const ToFMeasurement& measurement);
+
+  private:
+    std::string name_;
+    ShmLayout* layout_ = nullptr;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Fixed-capacity lock-free ring for one producer thread and one consumer thread.
+//
+// One slot is kept free, so at most Capacity - 1 values are buffered. When the
+// ring is full, push() either drops the new value or discards the oldest one,
+// and counts which happened. Slots are stored as relaxed atomic words so the
+// consumer can race a discarding producer without a data race; such a read is
+// detected by the failed tail CAS and retried.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing values must be trivially copyable");
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+  public:
+    explicit SpscRing(bool overwrite_oldest = false) : overwrite_oldest_(overwrite_oldest) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false if the value was dropped because the ring was full.
+    bool push(const T& value) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= Capacity - 1) {
+            if (!overwrite_oldest_) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // If the consumer popped the oldest entry meanwhile, the CAS fails and there is room anyway.
+            if (tail_.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                overwritten_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        store(slots_[head & kMask], value);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(T& out) {
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        for (;;) {
+            uint64_t head = head_.load(std::memory_order_acquire);
+            if (tail == head) {
+                return false;
+            }
+            T value = load(slots_[tail & kMask]);
+            if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                out = value;
+                return true;
+            }
+            // The producer discarded this entry while we were copying it; tail now holds the new position.
+        }
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+    }
+    static constexpr size_t capacity() { return Capacity - 1; }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t overwritten() const { return overwritten_.load(std::memory_order_relaxed); }
+
+  private:
+    static constexpr size_t kMask = Capacity - 1;
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    struct Slot {
+        std::array<std::atomic<uint32_t>, kWords> words{};
+    };
+
+    static void store(Slot& slot, const T& value) {
+        uint32_t buf[kWords] = {};
+        std::memcpy(buf, &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i) {
+            slot.words[i].store(buf[i], std::memory_order_relaxed);
+        }
+    }
+
+    static T load(const Slot& slot) {
+        uint32_t buf[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            buf[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, buf, sizeof(T));
+        return value;
+    }
+
+    std::array<Slot, Capacity> slots_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> overwritten_{0};
+    const bool overwrite_oldest_;
+};
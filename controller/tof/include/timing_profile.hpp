@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+// Ranging presets after the VL53L0X API's high-speed, default and long-range profiles.
+enum class TimingProfile {
+    Fast,       // short budget, high rate: someone is close and the signal is strong
+    Balanced,   // the configured budget and --hz
+    LongRange,  // longer VCSEL pulses and a lower signal limit at a low rate while nobody is in range
+};
+
+struct TimingPreset {
+    uint32_t budget_us;
+    uint8_t pre_range_vcsel_pclks;  // 12-18, even
+    uint8_t final_range_vcsel_pclks;  // 8-14, even
+    float signal_rate_limit_mcps;
+    uint32_t period_ms;  // time between samples; 0 = the configured cadence
+};
+
+const TimingPreset& timing_preset(TimingProfile profile);
+const char* timing_profile_name(TimingProfile profile);
+
+struct AdaptiveTimingConfig {
+    uint16_t near_mm = 800;  // closer than this with a strong signal selects Fast
+    uint16_t far_mm = 1300;  // valid ranges beyond this count as nobody there
+    uint16_t hysteresis_mm = 100;  // Fast holds until the range is this far past near_mm
+    float min_signal_mcps = 1.0f;  // weaker returns are ranged with the Balanced budget
+    uint64_t idle_ms = 3000;  // LongRange after this long without a target
+    uint64_t dwell_ms = 1000;  // how long a slower profile's condition has to hold before dropping to it
+};
+
+// Picks the profile for the next samples from the ones just taken. Moving to a faster profile happens on
+// the first sample that calls for it, so a session starts at the high rate; moving to a slower one waits
+// for dwell_ms (idle_ms for LongRange), so a single dropout or noisy reading does not flap the sensor.
+class ProfileSelector {
+  public:
+    explicit ProfileSelector(const AdaptiveTimingConfig& config = AdaptiveTimingConfig(),
+                             TimingProfile initial = TimingProfile::Balanced);
+
+    // `distance_mm` is ignored when `valid` is false (no target, range error or failed read).
+    TimingProfile update(bool valid, uint16_t distance_mm, float signal_mcps, uint64_t now_ms);
+    TimingProfile current() const { return current_; }
+
+  private:
+    TimingProfile wanted(bool valid, uint16_t distance_mm, float signal_mcps) const;
+
+    AdaptiveTimingConfig config_;
+    TimingProfile current_;
+    uint64_t target_ms_ = 0;  // last sample with a target
+    uint64_t slower_since_ms_ = 0;  // since when a slower profile than current_ has been wanted
+    bool slower_pending_ = false;
+    bool started_ = false;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tof_reader.hpp"
+
+struct ToFSensorSpec {
+    uint8_t address = 0x29;  // address the sensor is moved to during bring-up
+    std::string xshut_path;  // sysfs value path holding this sensor in reset; required for more than one sensor
+};
+
+// Several VL53L0X sensors sharing one I2C bus, each behind its own XSHUT line.
+//
+// init() holds every sensor in reset, then releases them one at a time and
+// moves each to its own address before the next one boots at 0x29. All
+// sensors run in continuous timed mode with their start times spread evenly
+// across one inter-measurement period, so ranging overlaps and only the
+// short result readouts share the bus.
+class ToFArray {
+  public:
+    ToFArray(const ToFConfig& base, std::vector<ToFSensorSpec> sensors);
+
+    // Succeeds when at least one sensor came up; failed sensors are left in reset.
+    bool init();
+    size_t size() const { return slots_.size(); }
+
+    // Reads every sensor whose next sample is due and appends the results, tagged with their sensor_id.
+    size_t poll(std::vector<ToFMeasurement>& out);
+    // Earliest monotonic_millis() at which poll() has work to do.
+    uint64_t next_due_ms() const;
+    // Reader of slot i; its sensor_id is the config's, not necessarily i.
+    const ToFReader& reader(size_t i) const { return *slots_[i].reader; }
+
+  private:
+    struct Slot {
+        std::unique_ptr<ToFReader> reader;
+        uint64_t next_due_ms = 0;
+    };
+
+    ToFConfig base_;
+    std::vector<ToFSensorSpec> specs_;
+    std::vector<Slot> slots_;
+};
@@ -1,24 +1,53 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 
+#include <vl53lXx/interfaces/vl53l0x_sim.hpp>
+
+#include "gpio_edge.hpp"
+#include "timing_profile.hpp"
+
 struct ToFConfig {
     std::string i2c_bus = "/dev/i2c-1";
     uint8_t i2c_address = 0x29;
     std::string xshut_path;  // optional sysfs path to toggle
+    std::string gpio1_path;  // optional sysfs value path wired to the sensor's GPIO1 (data ready)
     int timing_budget_ms = 50;  // measurement timing budget
-    int inter_measurement_ms = 60;
+    int inter_measurement_ms = 60;  // sensor-side period in continuous mode
+    bool continuous = false;  // continuous timed ranging instead of one shot per read
     int output_hz = 20;
     bool json_output = true;
+    bool persistent_i2c = true;  // keep the bus fd open instead of reopening per transfer
+    bool assign_address = false;  // boot at the default 0x29 and move the sensor to i2c_address
+    uint8_t sensor_id = 0;  // copied into every measurement
+    bool simulate = false;  // drive an in-memory VL53L0X model instead of i2c_bus
+    VL53L0XSimConfig sim;
+    std::string calibration_cache;  // optional file to restore/save the sensor's calibration (calibration_cache.hpp)
+    uint32_t calibration_max_age_s = 86400;  // older entries are recalibrated; 0 = no limit
+    bool adaptive_timing = false;  // switch between the timing_profile.hpp presets as the range changes
+    AdaptiveTimingConfig adaptive;
 };
 
 struct ToFMeasurement {
     uint16_t distance_mm = 0;
-    float signal_rate = 0.0f;  // MCPS equivalent (best-effort)
+    float signal_rate = 0.0f;  // return signal rate, MCPS
+    float ambient_rate = 0.0f;  // ambient rate, MCPS
     uint64_t timestamp_ms = 0;
+    uint8_t status = 0;  // 0 = valid range, else the sensor's device range status (255 if none or out of reach)
+    uint32_t sequence = 0;  // assigned by the acquisition loop; gaps mean samples were lost
+    uint8_t sensor_id = 0;  // index of the sensor in a ToFArray, 0 for a single reader
+};
+
+// Written by the thread that reads the sensor, readable from any other (tof-reader --metrics).
+struct ToFReaderCounters {
+    std::atomic<uint64_t> samples{0};  // measurements returned, valid range or not
+    std::atomic<uint64_t> timeouts{0};  // reads the driver gave up on (timeoutOccurred())
+    std::atomic<uint64_t> i2c_transfers{0};  // bus transfers since init(), calibration included
+    std::atomic<uint64_t> i2c_errors{0};
 };
 
 class ToFReader {
@@ -26,17 +55,45 @@ class ToFReader {
     explicit ToFReader(const ToFConfig& cfg);
     ~ToFReader();
 
-    bool init();
+    // start_ranging=false leaves continuous mode idle until start_ranging() is called.
+    bool init(bool start_ranging = true);
+    void start_ranging();
+    // Single-shot: triggers and waits for one measurement. Continuous: waits for the next sample.
     std::optional<ToFMeasurement> read_once();
+    // Continuous mode only: returns a sample if one is ready, without waiting.
+    std::optional<ToFMeasurement> try_read();
+    // Continuous mode without the data-ready IRQ: when try_read() is next worth calling. Just before the
+    // sample after the last one it took off the sensor is due, valid range or not; every few ms while late.
+    uint64_t next_poll_ms(uint64_t now_ms) const;
+    bool has_data_ready_irq() const { return data_ready_.is_open(); }
+    const ToFConfig& config() const { return config_; }
+    // Time between samples: the active profile's period, else the inter-measurement period (continuous)
+    // or the --hz interval (single-shot).
+    uint32_t period_ms() const;
+    TimingProfile timing_profile() const { return profile_; }
+    const ToFReaderCounters& counters() const { return counters_; }
 
   private:
     bool reset_sensor();
+    bool init_sensor();
+    // Programs the preset's budget, VCSEL periods and signal limit, restarting continuous ranging around it.
+    bool apply_timing(TimingProfile profile);
+    // `data` is null when no result could be read.
+    std::optional<ToFMeasurement> finish_measurement(const struct VL53L0XRangingData* data, uint64_t timestamp_ms);
+    std::optional<ToFMeasurement> decode_measurement(const struct VL53L0XRangingData* data, uint64_t timestamp_ms);
     int parse_bus_number(const std::string& bus) const;
+    void update_bus_counters();
 
     ToFConfig config_;
     int bus_number_ = 1;
     bool initialized_ = false;
+    bool ranging_ = false;  // continuous ranging started
+    uint64_t consumed_ms_ = 0;  // when try_read() last got a result, 0 since start_ranging()
+    TimingProfile profile_ = TimingProfile::Balanced;  // what init() leaves the sensor in
+    ProfileSelector profiles_;
     std::unique_ptr<class VL53L0X> sensor_;
+    GpioEdge data_ready_;
+    ToFReaderCounters counters_;
 };
 
 uint64_t monotonic_millis();
@@ -0,0 +1,144 @@
+#include "calibration_cache.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const char kHeader[] = "# tof-reader calibration cache v1";
+
+struct Entry {
+    std::string bus;
+    unsigned address = 0;
+    VL53L0XCalibration calibration{};
+    int64_t saved_at = 0;
+};
+
+bool parse_entry(const std::string& line, Entry* entry) {
+    std::istringstream in(line);
+    std::string address, map, vhv, phase;
+    unsigned spad_count = 0, aperture = 0;
+    if (!(in >> entry->bus >> address >> spad_count >> aperture >> map >> vhv >> phase >> entry->saved_at) ||
+        map.size() != 2 * sizeof(entry->calibration.refSpadMap)) {
+        return false;
+    }
+    try {
+        entry->address = static_cast<unsigned>(std::stoul(address, nullptr, 16));
+        entry->calibration.vhvSettings = static_cast<uint8_t>(std::stoul(vhv, nullptr, 16));
+        entry->calibration.phaseCal = static_cast<uint8_t>(std::stoul(phase, nullptr, 16));
+        for (size_t i = 0; i < sizeof(entry->calibration.refSpadMap); ++i) {
+            entry->calibration.refSpadMap[i] = static_cast<uint8_t>(std::stoul(map.substr(2 * i, 2), nullptr, 16));
+        }
+    } catch (...) {
+        return false;
+    }
+    entry->calibration.spadCount = static_cast<uint8_t>(spad_count);
+    entry->calibration.spadTypeIsAperture = aperture != 0;
+    return spad_count <= 0xFF && aperture <= 1;
+}
+
+// What init() can produce: 1-44 reference SPADs (DYNAMIC_SPAD_NUM_REQUESTED_REF_SPAD), exactly that many
+// enabled in the map and none below the first aperture SPAD for aperture modules.
+bool plausible(const VL53L0XCalibration& c) {
+    if (c.spadCount == 0 || c.spadCount > 44) {
+        return false;
+    }
+    unsigned enabled = 0;
+    for (unsigned i = 0; i < 48; ++i) {
+        if ((c.refSpadMap[i / 8] >> (i % 8)) & 0x1) {
+            if (c.spadTypeIsAperture && i < 12) {
+                return false;
+            }
+            enabled++;
+        }
+    }
+    return enabled == c.spadCount;
+}
+
+std::vector<Entry> read_entries(const std::string& path) {
+    std::vector<Entry> entries;
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != kHeader) {
+        return entries;
+    }
+    while (std::getline(in, line)) {
+        Entry entry;
+        if (!line.empty() && line[0] != '#' && parse_entry(line, &entry)) {
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+}  // namespace
+
+std::optional<VL53L0XCalibration> load_calibration(const std::string& path, const std::string& bus,
+                                                   uint8_t address, uint32_t max_age_s) {
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    for (const Entry& entry : read_entries(path)) {
+        if (entry.bus != bus || entry.address != address) {
+            continue;
+        }
+        if (!plausible(entry.calibration) ||
+            (max_age_s != 0 && (entry.saved_at > now || now - entry.saved_at > static_cast<int64_t>(max_age_s)))) {
+            return std::nullopt;
+        }
+        return entry.calibration;
+    }
+    return std::nullopt;
+}
+
+bool save_calibration(const std::string& path, const std::string& bus, uint8_t address,
+                      const VL53L0XCalibration& calibration) {
+    std::vector<Entry> entries = read_entries(path);
+    Entry* slot = nullptr;
+    for (Entry& entry : entries) {
+        if (entry.bus == bus && entry.address == address) {
+            slot = &entry;
+        }
+    }
+    if (!slot) {
+        entries.emplace_back();
+        slot = &entries.back();
+        slot->bus = bus;
+        slot->address = address;
+    }
+    slot->calibration = calibration;
+    slot->saved_at = static_cast<int64_t>(std::time(nullptr));
+
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << kHeader << '\n';
+        for (const Entry& entry : entries) {
+            char line[512];
+            const uint8_t* map = entry.calibration.refSpadMap;
+            std::snprintf(line, sizeof(line), "%s 0x%02x %u %u %02x%02x%02x%02x%02x%02x 0x%02x 0x%02x %lld\n",
+                          entry.bus.c_str(), entry.address, entry.calibration.spadCount,
+                          entry.calibration.spadTypeIsAperture ? 1u : 0u, map[0], map[1], map[2], map[3], map[4],
+                          map[5], entry.calibration.vhvSettings, entry.calibration.phaseCal,
+                          static_cast<long long>(entry.saved_at));
+            out << line;
+        }
+        out.flush();
+        if (!out) {
+            std::cerr << "Failed to write calibration cache " << tmp << std::endl;
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace calibration cache " << path << ": " << std::strerror(errno) << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#include "distance_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+DistanceFilter::DistanceFilter(const FilterConfig& config) : config_(config) {
+    config_.median_window = std::clamp<size_t>(config_.median_window | 1, 1, kMaxMedianWindow);
+    config_.ema_alpha = std::clamp(config_.ema_alpha, 0.0f, 1.0f);
+}
+
+ToFMeasurement DistanceFilter::apply(const ToFMeasurement& measurement) {
+    if (config_.kind == FilterKind::None || measurement.status != 0) {
+        return measurement;
+    }
+    if (measurement.sensor_id >= states_.size()) {
+        states_.resize(measurement.sensor_id + 1);
+    }
+    State& state = states_[measurement.sensor_id];
+    if (state.primed && measurement.timestamp_ms - state.last_ms > config_.reset_after_ms) {
+        state = State();
+    }
+    ToFMeasurement out = measurement;
+    float filtered = update(state, static_cast<float>(measurement.distance_mm), measurement.timestamp_ms);
+    out.distance_mm = static_cast<uint16_t>(std::lround(std::max(0.0f, filtered)));
+    state.last_ms = measurement.timestamp_ms;
+    state.primed = true;
+    return out;
+}
+
+float DistanceFilter::update(State& state, float range, uint64_t timestamp_ms) {
+    switch (config_.kind) {
+        case FilterKind::Median: {
+            state.window[state.next] = static_cast<uint16_t>(range);
+            state.next = (state.next + 1) % config_.median_window;
+            state.count = std::min(state.count + 1, config_.median_window);
+            uint16_t sorted[kMaxMedianWindow];
+            std::copy(state.window, state.window + state.count, sorted);
+            std::nth_element(sorted, sorted + state.count / 2, sorted + state.count);
+            return sorted[state.count / 2];
+        }
+        case FilterKind::Ema:
+            state.estimate = state.primed ? state.estimate + config_.ema_alpha * (range - state.estimate) : range;
+            return state.estimate;
+        case FilterKind::Kalman: {
+            if (!state.primed) {
+                state.estimate = range;
+                state.variance = config_.kalman_measurement_noise;
+                return range;
+            }
+            // Predict: the target may have moved by process noise scaled with the time since the last range
+            float dt = static_cast<float>(timestamp_ms - state.last_ms) / 1000.0f;
+            state.variance += config_.kalman_process_noise * dt;
+            float gain = state.variance / (state.variance + config_.kalman_measurement_noise);
+            state.estimate += gain * (range - state.estimate);
+            state.variance *= 1.0f - gain;
+            return state.estimate;
+        }
+        case FilterKind::None:
+            break;
+    }
+    return range;
+}
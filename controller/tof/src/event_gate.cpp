@@ -0,0 +1,99 @@
+#include "event_gate.hpp"
+
+#include <algorithm>
+#include <limits>
+
+EventGate::EventGate(const EventConfig& config) : config_(config) {
+    std::sort(config_.thresholds_mm.begin(), config_.thresholds_mm.end());
+    config_.thresholds_mm.erase(std::unique(config_.thresholds_mm.begin(), config_.thresholds_mm.end()),
+                                config_.thresholds_mm.end());
+}
+
+// Moves up or down one boundary at a time, each only once the range is hysteresis_mm past it.
+size_t EventGate::zone_for(size_t current, uint16_t distance_mm) const {
+    const auto& t = config_.thresholds_mm;
+    const int d = distance_mm;
+    const int h = config_.hysteresis_mm;
+    size_t zone = std::min(current, t.size());
+    while (zone < t.size() && d >= t[zone] + h) {
+        ++zone;
+    }
+    while (zone > 0 && d < t[zone - 1] - h) {
+        --zone;
+    }
+    return zone;
+}
+
+bool EventGate::should_emit(const ToFMeasurement& measurement, uint64_t now_ms) {
+    if (measurement.sensor_id >= states_.size()) {
+        states_.resize(measurement.sensor_id + 1);
+    }
+    State& state = states_[measurement.sensor_id];
+    const bool valid = measurement.status == 0;
+
+    bool emit = false;
+    if (!state.seen || valid != state.valid) {
+        emit = true;
+        if (valid) {
+            // Enter the zone the range is actually in, without hysteresis
+            auto& t = config_.thresholds_mm;
+            state.zone = static_cast<size_t>(std::upper_bound(t.begin(), t.end(), measurement.distance_mm) - t.begin());
+        }
+    } else if (valid) {
+        size_t zone = zone_for(state.zone, measurement.distance_mm);
+        if (zone != state.zone) {
+            state.zone = zone;
+            emit = true;
+        }
+        int moved = static_cast<int>(measurement.distance_mm) - static_cast<int>(state.emitted_mm);
+        if (config_.delta_mm != 0 && (moved > config_.delta_mm || -moved > config_.delta_mm)) {
+            emit = true;
+        }
+    }
+    if (!emit && config_.heartbeat_ms != 0 && now_ms - state.emitted_ms >= config_.heartbeat_ms) {
+        emit = true;
+    }
+
+    state.seen = true;
+    state.valid = valid;
+    state.sample_ms = now_ms;
+    if (emit) {
+        state.emitted_ms = now_ms;
+        if (valid) {
+            state.emitted_mm = measurement.distance_mm;
+        }
+    }
+    return emit;
+}
+
+void EventGate::heartbeat(uint64_t now_ms, std::vector<ToFMeasurement>& out) {
+    if (config_.heartbeat_ms == 0) {
+        return;
+    }
+    for (size_t id = 0; id < states_.size(); ++id) {
+        const State& state = states_[id];
+        if (!state.seen || std::max(state.emitted_ms, state.sample_ms) + config_.heartbeat_ms > now_ms) {
+            continue;
+        }
+        ToFMeasurement silent;
+        silent.status = 255;
+        silent.timestamp_ms = now_ms;
+        silent.sensor_id = static_cast<uint8_t>(id);
+        if (should_emit(silent, now_ms)) {
+            out.push_back(silent);
+        }
+    }
+}
+
+uint64_t EventGate::next_heartbeat_ms() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    if (config_.heartbeat_ms == 0) {
+        return next;
+    }
+    for (const State& state : states_) {
+        if (state.seen) {
+            next = std::min(next, std::max(state.emitted_ms, state.sample_ms) + config_.heartbeat_ms);
+        }
+    }
+    return next;
+}
@@ -0,0 +1,79 @@
+#include "gpio_edge.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+
+GpioEdge::~GpioEdge() {
+    close();
+}
+
+bool GpioEdge::open(const std::string& value_path, const std::string& edge) {
+    close();
+
+    auto slash = value_path.rfind('/');
+    std::string edge_path = (slash == std::string::npos ? std::string() : value_path.substr(0, slash + 1)) + "edge";
+    {
+        std::ofstream ofs(edge_path);
+        if (!ofs) {
+            std::cerr << "Failed to open GPIO edge path: " << edge_path << std::endl;
+            return false;
+        }
+        ofs << edge;
+        if (!ofs.good()) {
+            std::cerr << "Failed to set GPIO edge '" << edge << "' on " << edge_path << std::endl;
+            return false;
+        }
+    }
+
+    fd_ = ::open(value_path.c_str(), O_RDONLY | O_NONBLOCK);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open GPIO value path: " << value_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    clear();
+    return true;
+}
+
+void GpioEdge::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void GpioEdge::clear() {
+    if (fd_ < 0) {
+        return;
+    }
+    // sysfs only re-arms the edge notification after the value has been read.
+    char buf[8];
+    lseek(fd_, 0, SEEK_SET);
+    (void)::read(fd_, buf, sizeof(buf));
+}
+
+int GpioEdge::wait(int timeout_ms) {
+    if (fd_ < 0) {
+        return -1;
+    }
+    struct pollfd pfd {
+        .fd = fd_, .events = POLLPRI | POLLERR, .revents = 0
+    };
+    int rc;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0) {
+        std::cerr << "GPIO poll failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    if (rc == 0) {
+        return 0;
+    }
+    clear();
+    return 1;
+}
@@ -1,23 +1,465 @@
+#include "distance_filter.hpp"
+#include "event_gate.hpp"
+#include "metrics.hpp"
+#include "realtime.hpp"
+#include "sample_file.hpp"
+#include "sample_writer.hpp"
+#include "shm_channel.hpp"
+#include "spsc_ring.hpp"
+#include "tof_array.hpp"
 #include "tof_reader.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <csignal>
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <getopt.h>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <thread>
 #include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include <vl53lXx/vl53l0x_defines.hpp>
 
 namespace {
-volatile std::sig_atomic_t g_should_exit = 0;
+std::atomic<bool> g_should_exit{false};
+static_assert(std::atomic<bool>::is_always_lock_free, "exit flag is set from a signal handler");
 
 void signal_handler(int) {
-    g_should_exit = 1;
+    g_should_exit.store(true);
+}
+
+// Samples buffered between the acquisition and emitter threads.
+using SampleRing = SpscRing<ToFMeasurement, 64>;
+
+// Minimum spacing between backpressure reports on stderr.
+constexpr uint64_t kBackpressureReportMs = 1000;
+
+// Sleeps until deadline_ms on the monotonic_millis() clock (CLOCK_MONOTONIC) and returns how many
+// microseconds late the thread got back; also positive when the deadline had already passed.
+int64_t sleep_until_ms(uint64_t deadline_ms) {
+    struct timespec deadline {
+        .tv_sec = static_cast<time_t>(deadline_ms / 1000),
+        .tv_nsec = static_cast<long>((deadline_ms % 1000) * 1'000'000)
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR &&
+           !g_should_exit.load(std::memory_order_relaxed)) {
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec - deadline.tv_sec) * 1'000'000 + (now.tv_nsec - deadline.tv_nsec) / 1000;
+}
+
+// --latency-report: how late each read of the acquisition loop started against its schedule, printed every
+// period_ms.
+struct LatencyReport {
+    uint64_t period_ms = 0;  // 0 = off
+    uint64_t next_ms = 0;
+    WakeLatency wake;
+    LatencyHistogram* histogram = nullptr;  // --metrics, fed whether or not the report is on
+
+    void record(int64_t late_us) {
+        if (histogram) {
+            histogram->record(late_us);
+        }
+        if (period_ms == 0) {
+            return;
+        }
+        wake.record(late_us);
+        uint64_t now = monotonic_millis();
+        if (next_ms == 0) {
+            next_ms = now + period_ms;
+        } else if (now >= next_ms) {
+            wake.report("acquisition wake");
+            wake.reset();
+            next_ms = now + period_ms;
+        }
+    }
+
+    void finish() {
+        if (period_ms != 0 && wake.count() != 0) {
+            wake.report("acquisition wake");
+        }
+    }
+};
+
+// --metrics: what the acquisition and output threads count for the metrics file.
+struct ReaderMetrics {
+    std::atomic<uint64_t> published{0};  // samples handed to the output thread
+    std::atomic<uint64_t> written{0};  // stdout records, after --events
+    LatencyHistogram wake;  // how late the acquisition loop woke, as in --latency-report
+    LatencyHistogram read;  // one read that returned a sample, or one ToFArray::poll() that returned any
+    LatencyHistogram publish;  // sample timestamp to --shm and stdout, in whole ms; live samples only
+    std::atomic<double> acquisition_cpu_s{0.0};  // set as the acquisition thread exits, when its clock goes away
+};
+
+int64_t micros_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
 }
 
 void usage(const char* prog) {
     std::cerr << "Usage: " << prog << " [--bus /dev/i2c-1] [--addr 0x29]"
-              << " [--xshut /sys/class/gpio/gpio4/value] [--hz 20] [--plain]\n";
+              << " [--xshut /sys/class/gpio/gpio4/value] [--hz 20] [--plain|--binary]"
+              << " [--gpio1 /sys/class/gpio/gpio17/value] [--continuous] [--reopen-i2c]"
+              << " [--overflow overwrite|drop] [--shm /tof-reader] [--no-stdout]"
+              << " [--sensor ADDR[,XSHUT]]... [--record FILE] [--replay FILE]"
+              << " [--sim] [--sim-trace FILE] [--sim-measure-us N] [--sim-bus-us N] [--sim-error-rate P]"
+              << " [--calibration-cache FILE] [--calibration-max-age S]"
+              << " [--filter median|ema|kalman] [--median-window N] [--ema-alpha A] [--kalman-q Q] [--kalman-r R]"
+              << " [--events] [--threshold MM]... [--hysteresis MM] [--delta MM] [--heartbeat MS]"
+              << " [--adaptive] [--near-mm MM] [--idle-ms MS]"
+              << " [--sched-fifo ACQ[,PROC]] [--cpu-acquisition LIST] [--cpu-processing LIST] [--mlock]"
+              << " [--latency-report S] [--metrics FILE] [--metrics-interval S]\n"
+              << "  --record FILE  also write every sample to FILE in the --binary format\n"
+              << "  --replay FILE  publish the samples of a --record file as fast as the outputs take them,\n"
+              << "                 with their recorded timestamps and sequence numbers, instead of reading a sensor\n"
+              << "  --sim          run the driver against an in-memory VL53L0X model instead of the bus\n"
+              << "  --sim-trace FILE      ranges for the model, taken in order from a --record file (implies --sim)\n"
+              << "  --sim-measure-us N    model ranging time per sample (default: the 50 ms timing budget);\n"
+              << "                        lowering it lifts the rate cap for load tests\n"
+              << "  --sim-bus-us N        model bus time per transfer\n"
+              << "  --sim-error-rate P    fraction of model transfers that fail with EIO\n"
+              << "  --calibration-cache FILE  restore each sensor's SPAD/VHV/phase calibration from FILE instead of\n"
+              << "                            re-running it; recalibrates and updates FILE when an entry is missing,\n"
+              << "                            stale or rejected by the sensor\n"
+              << "  --calibration-max-age S   recalibrate entries older than S seconds (default 86400, 0 = never)\n"
+              << "  --filter KIND  smooth valid ranges per sensor before stdout and --shm (--record stays raw):\n"
+              << "                 median of the last --median-window (default 5), EMA with --ema-alpha (default\n"
+              << "                 0.3) or a 1D Kalman filter with --kalman-q mm^2/s (default 1000) and\n"
+              << "                 --kalman-r mm^2 (default 100)\n"
+              << "  --events       write a sample to stdout only when it crosses a --threshold (repeatable) by\n"
+              << "                 --hysteresis (default 20 mm), moves more than --delta mm since the last one (0 = off),\n"
+              << "                 gains or loses a valid range, or --heartbeat ms passed (default 1000, 0 = off);\n"
+              << "                 --shm and --record still get every sample\n"
+              << "  --adaptive     switch the timing profile with the range: fast (20 ms budget, 40 Hz) while a target\n"
+              << "                 is closer than --near-mm (default 800) with a strong return, balanced (the\n"
+              << "                 configured budget and --hz) otherwise, long-range (VCSEL 18/14, 0.1 MCPS, 5 Hz)\n"
+              << "                 after --idle-ms (default 3000) without a target; single sensor only\n"
+              << "  --sched-fifo ACQ[,PROC]  SCHED_FIFO priority (1-99) for the acquisition thread and optionally the\n"
+              << "                           processing/output thread; needs CAP_SYS_NICE or an RLIMIT_RTPRIO, warns\n"
+              << "                           and keeps the normal policy without\n"
+              << "  --cpu-acquisition LIST   pin the acquisition thread to CPUs, e.g. 3 or 2-3 (an isolcpus= core\n"
+              << "                           keeps other work off it); --cpu-processing LIST the same for the output\n"
+              << "  --mlock        lock all memory (mlockall) and pre-fault the thread stacks, so a wake-up never\n"
+              << "                 waits on a page fault; needs CAP_IPC_LOCK or a large enough RLIMIT_MEMLOCK\n"
+              << "  --latency-report S  print how late the acquisition loop woke up or, when a read overran the period,\n"
+              << "                      started the next one (mean, p50, p99, max) every S seconds to stderr\n"
+              << "  --metrics FILE  rewrite FILE every --metrics-interval seconds (default 5) with Prometheus text:\n"
+              << "                  sample, drop and per-sensor I2C transfer, error and timeout counters, latency\n"
+              << "                  histograms for wake-up, read and publish, and CPU time per thread. Point\n"
+              << "                  node_exporter's textfile collector at it, or read it directly\n";
+}
+
+// Turns a --record file into a model range trace; the sensor ids in the file are ignored.
+bool load_sim_trace(const std::string& path, std::vector<VL53L0XSimSample>& trace) {
+    SampleFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    trace.clear();
+    trace.reserve(file.size());
+    for (size_t i = 0; i < file.size(); ++i) {
+        ToFMeasurement measurement = file.at(i);
+        VL53L0XSimSample sample;
+        sample.rangeMillimeters = measurement.distance_mm;
+        if (measurement.signal_rate > 0.0f) {
+            sample.signalRateMCPS = measurement.signal_rate;
+            sample.ambientRateMCPS = measurement.ambient_rate;
+        }
+        sample.rangeStatus = (measurement.status == 0) ? VL53L0X_RANGE_STATUS_VALID : measurement.status;
+        trace.push_back(sample);
+    }
+    if (trace.empty()) {
+        std::cerr << "Sample file " << path << " holds no samples" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Parses "0x30" or "0x30,/sys/class/gpio/gpio5/value" as given to --sensor.
+bool parse_sensor_spec(const char* arg, ToFSensorSpec& spec) {
+    std::string text(arg);
+    auto comma = text.find(',');
+    std::string address = text.substr(0, comma);
+    char* end = nullptr;
+    unsigned long value = std::strtoul(address.c_str(), &end, 0);
+    if (address.empty() || *end != '\0' || value == 0 || value > 0x7F) {
+        return false;
+    }
+    spec.address = static_cast<uint8_t>(value);
+    spec.xshut_path = (comma == std::string::npos) ? std::string() : text.substr(comma + 1);
+    return true;
+}
+
+void publish_sample(ToFMeasurement& measurement, uint32_t& sequence, SampleRing& ring, int wake_fd,
+                    ReaderMetrics& metrics) {
+    measurement.sequence = sequence++;
+    ring.push(measurement);
+    metrics.published.fetch_add(1, std::memory_order_relaxed);
+    uint64_t one = 1;
+    (void)write(wake_fd, &one, sizeof(one));
+}
+
+// Sensor side: reads samples at the configured cadence and hands them to the emitter.
+void acquisition_loop(ToFReader& reader, const ToFConfig& cfg, SampleRing& ring, int wake_fd, LatencyReport& latency,
+                      ReaderMetrics& metrics) {
+    uint64_t next_deadline = monotonic_millis();
+    uint32_t sequence = 0;
+
+    while (!g_should_exit.load(std::memory_order_relaxed)) {
+        std::optional<ToFMeasurement> measurement;
+        auto read_start = std::chrono::steady_clock::now();
+        if (cfg.continuous && !reader.has_data_ready_irq()) {
+            measurement = reader.try_read();
+        } else {
+            measurement = reader.read_once();
+        }
+        if (measurement) {
+            metrics.read.record(micros_since(read_start));
+            publish_sample(*measurement, sequence, ring, wake_fd, metrics);
+        }
+
+        if (cfg.continuous) {
+            if (reader.has_data_ready_irq()) {
+                continue;  // read_once() already blocks on the data-ready edge
+            }
+            // Sleep until just before the next sample is due, then poll for it.
+            next_deadline = reader.next_poll_ms(monotonic_millis());
+            latency.record(sleep_until_ms(next_deadline));
+            continue;
+        }
+
+        next_deadline += reader.period_ms();
+        uint64_t now = monotonic_millis();
+        if (next_deadline > now) {
+            latency.record(sleep_until_ms(next_deadline));
+        } else {
+            // Overran the period: the read starts late without a sleep, which the report counts as well
+            latency.record(static_cast<int64_t>(now - next_deadline) * 1000);
+            next_deadline = now;
+        }
+    }
+}
+
+// Multi-sensor variant: services whichever sensors are due and sleeps until the next one is.
+void array_acquisition_loop(ToFArray& array, SampleRing& ring, int wake_fd, LatencyReport& latency,
+                            ReaderMetrics& metrics) {
+    std::vector<ToFMeasurement> batch;
+    batch.reserve(array.size());
+    uint32_t sequence = 0;
+
+    while (!g_should_exit.load(std::memory_order_relaxed)) {
+        batch.clear();
+        auto read_start = std::chrono::steady_clock::now();
+        array.poll(batch);
+        if (!batch.empty()) {
+            metrics.read.record(micros_since(read_start));
+        }
+        for (auto& measurement : batch) {
+            publish_sample(measurement, sequence, ring, wake_fd, metrics);
+        }
+        latency.record(sleep_until_ms(array.next_due_ms()));
+    }
+}
+
+// Replay side: feeds recorded samples through the same ring and emitter as live ones.
+// Waits for room instead of dropping, so every output sees the whole recording.
+void replay_loop(const SampleFile& file, SampleRing& ring, int wake_fd, ReaderMetrics& metrics) {
+    uint64_t start_ms = monotonic_millis();
+    size_t published = 0;
+    for (; published < file.size() && !g_should_exit.load(std::memory_order_relaxed); ++published) {
+        while (ring.size() >= SampleRing::capacity()) {
+            if (g_should_exit.load(std::memory_order_relaxed)) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        ring.push(file.at(published));
+        metrics.published.fetch_add(1, std::memory_order_relaxed);
+        uint64_t one = 1;
+        (void)write(wake_fd, &one, sizeof(one));
+    }
+    std::cerr << "tof-reader replay: " << published << "/" << file.size() << " samples in "
+              << (monotonic_millis() - start_ms) << " ms" << std::endl;
+}
+
+// Output side: drains the ring whenever the acquisition thread signals wake_fd and writes once per batch.
+// The recording gets raw samples; --shm and stdout get filtered ones, stdout only those `events` passes.
+void emitter_loop(SampleWriter* writer, SampleWriter* recorder, ShmPublisher& shm, SampleRing& ring, int wake_fd,
+                  const std::atomic<bool>& acquisition_done, DistanceFilter& filter, EventGate* events,
+                  ReaderMetrics& metrics, bool live) {
+    uint64_t reported_dropped = 0;
+    uint64_t reported_overwritten = 0;
+    uint64_t last_report_ms = 0;
+    // Live --events runs wake for the gate's heartbeat as well, so a reader that stops delivering samples
+    // still shows on stdout
+    const bool heartbeat = live && events && writer;
+    std::vector<ToFMeasurement> heartbeats;
+
+    for (;;) {
+        int timeout_ms = -1;
+        if (heartbeat) {
+            uint64_t due = events->next_heartbeat_ms();
+            uint64_t now = monotonic_millis();
+            if (due != UINT64_MAX) {
+                timeout_ms = (due > now) ? static_cast<int>(std::min<uint64_t>(due - now, 60000)) : 0;
+            }
+        }
+        pollfd wake = {wake_fd, POLLIN, 0};
+        int ready = poll(&wake, 1, timeout_ms);
+        uint64_t pending;
+        if (ready > 0 && read(wake_fd, &pending, sizeof(pending)) < 0) {
+            ready = -1;
+        }
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "tof-reader wake fd read failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        bool done = acquisition_done.load(std::memory_order_acquire);
+
+        ToFMeasurement raw;
+        uint64_t popped_ms = monotonic_millis();
+        while (ring.pop(raw)) {
+            if (recorder) {
+                recorder->append(raw);
+            }
+            const ToFMeasurement measurement = filter.apply(raw);
+            shm.publish(measurement);
+            if (live) {
+                metrics.publish.record(static_cast<int64_t>(popped_ms - measurement.timestamp_ms) * 1000);
+            }
+            // Sample time rather than wall time, so a replay gates exactly like the live run
+            if (writer && (!events || events->should_emit(measurement, measurement.timestamp_ms))) {
+                writer->append(measurement);
+                metrics.written.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (heartbeat) {
+            heartbeats.clear();
+            events->heartbeat(monotonic_millis(), heartbeats);
+            for (const ToFMeasurement& measurement : heartbeats) {
+                writer->append(measurement);
+                metrics.written.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (writer && !writer->flush()) {
+            break;
+        }
+        if (recorder && !recorder->flush()) {
+            break;
+        }
+
+        uint64_t dropped = ring.dropped();
+        uint64_t overwritten = ring.overwritten();
+        uint64_t now = monotonic_millis();
+        if ((dropped != reported_dropped || overwritten != reported_overwritten) &&
+            now - last_report_ms >= kBackpressureReportMs) {
+            std::cerr << "tof-reader backpressure: dropped=" << dropped << " overwritten=" << overwritten << std::endl;
+            reported_dropped = dropped;
+            reported_overwritten = overwritten;
+            last_report_ms = now;
+        }
+
+        if (done) {
+            break;
+        }
+    }
+}
+
+// Totals at the previous --metrics write, for the per-sample gauges.
+struct MetricsBaseline {
+    uint64_t samples = 0;
+    uint64_t i2c_transfers = 0;
+    uint64_t i2c_errors = 0;
+};
+
+// Prometheus text for --metrics. Totals are counters, so rates come from the scraper (rate() etc.); the
+// per-sample gauges cover the interval since the previous write.
+std::string format_metrics(const ReaderMetrics& metrics, const SampleRing& ring,
+                           const std::vector<const ToFReader*>& readers, pthread_t acquisition_thread,
+                           pthread_t output_thread, MetricsBaseline& baseline) {
+    MetricsText text;
+    text.family("tof_reader_samples_total", "counter", "Samples read and handed to the output thread.");
+    text.sample("tof_reader_samples_total", metrics.published.load(std::memory_order_relaxed));
+    text.family("tof_reader_written_total", "counter", "Samples written to stdout, after --events.");
+    text.sample("tof_reader_written_total", metrics.written.load(std::memory_order_relaxed));
+    text.family("tof_reader_dropped_total", "counter", "Samples the full ring dropped (--overflow drop).");
+    text.sample("tof_reader_dropped_total", ring.dropped());
+    text.family("tof_reader_overwritten_total", "counter",
+                "Samples the full ring overwrote before output (--overflow overwrite).");
+    text.sample("tof_reader_overwritten_total", ring.overwritten());
+
+    if (!readers.empty()) {
+        text.family("tof_reader_i2c_transfers_total", "counter", "I2C transfers per sensor, calibration included.");
+        for (const ToFReader* r : readers) {
+            text.sample("tof_reader_i2c_transfers_total", r->counters().i2c_transfers.load(std::memory_order_relaxed),
+                        "sensor=\"" + std::to_string(r->config().sensor_id) + "\"");
+        }
+        text.family("tof_reader_i2c_errors_total", "counter", "Failed I2C transfers per sensor.");
+        for (const ToFReader* r : readers) {
+            text.sample("tof_reader_i2c_errors_total", r->counters().i2c_errors.load(std::memory_order_relaxed),
+                        "sensor=\"" + std::to_string(r->config().sensor_id) + "\"");
+        }
+        text.family("tof_reader_timeouts_total", "counter", "Reads the VL53L0X driver timed out (timeoutOccurred).");
+        for (const ToFReader* r : readers) {
+            text.sample("tof_reader_timeouts_total", r->counters().timeouts.load(std::memory_order_relaxed),
+                        "sensor=\"" + std::to_string(r->config().sensor_id) + "\"");
+        }
+        text.family("tof_reader_sensor_samples_total", "counter", "Samples returned per sensor.");
+        for (const ToFReader* r : readers) {
+            text.sample("tof_reader_sensor_samples_total", r->counters().samples.load(std::memory_order_relaxed),
+                        "sensor=\"" + std::to_string(r->config().sensor_id) + "\"");
+        }
+
+        MetricsBaseline now;
+        for (const ToFReader* r : readers) {
+            now.samples += r->counters().samples.load(std::memory_order_relaxed);
+            now.i2c_transfers += r->counters().i2c_transfers.load(std::memory_order_relaxed);
+            now.i2c_errors += r->counters().i2c_errors.load(std::memory_order_relaxed);
+        }
+        // The first interval includes init() and calibration
+        double samples = static_cast<double>(std::max<uint64_t>(1, now.samples - baseline.samples));
+        text.family("tof_reader_i2c_transfers_per_sample", "gauge",
+                    "I2C transfers per sample since the previous write, all sensors.");
+        text.sample("tof_reader_i2c_transfers_per_sample",
+                    static_cast<double>(now.i2c_transfers - baseline.i2c_transfers) / samples);
+        text.family("tof_reader_i2c_errors_per_sample", "gauge",
+                    "Failed I2C transfers per sample since the previous write, all sensors.");
+        text.sample("tof_reader_i2c_errors_per_sample",
+                    static_cast<double>(now.i2c_errors - baseline.i2c_errors) / samples);
+        baseline = now;
+    }
+
+    text.family("tof_reader_wake_latency_seconds", "histogram",
+                "How late the acquisition loop woke up, or started a read after one overran its period.");
+    text.histogram("tof_reader_wake_latency_seconds", metrics.wake);
+    text.family("tof_reader_read_seconds", "histogram",
+                "Duration of a read that returned a sample (bus transfers and the wait for the result).");
+    text.histogram("tof_reader_read_seconds", metrics.read);
+    text.family("tof_reader_publish_latency_seconds", "histogram",
+                "Sample timestamp to --shm and stdout, whole milliseconds.");
+    text.histogram("tof_reader_publish_latency_seconds", metrics.publish);
+
+    text.family("process_cpu_seconds_total", "counter", "User and system CPU time of the process.");
+    text.sample("process_cpu_seconds_total", process_cpu_seconds());
+    text.family("tof_reader_thread_cpu_seconds_total", "counter", "CPU time per thread.");
+    double acquisition_cpu_s = metrics.acquisition_cpu_s.load(std::memory_order_relaxed);
+    text.sample("tof_reader_thread_cpu_seconds_total",
+                acquisition_cpu_s > 0.0 ? acquisition_cpu_s : thread_cpu_seconds(acquisition_thread),
+                "thread=\"acquisition\"");
+    text.sample("tof_reader_thread_cpu_seconds_total", thread_cpu_seconds(output_thread), "thread=\"output\"");
+    return text.str();
 }
 
 }  // namespace
@@ -27,13 +469,68 @@ int main(int argc, char** argv) {
     std::signal(SIGTERM, signal_handler);
 
     ToFConfig cfg;
+    bool overwrite_oldest = true;
+    bool binary_output = false;
+    bool stdout_output = true;
+    std::string shm_name;
+    std::string record_path;
+    std::string replay_path;
+    std::string sim_trace_path;
+    long sim_measure_us = -1;
+    std::vector<ToFSensorSpec> sensors;
+    FilterConfig filter_cfg;
+    bool events_mode = false;
+    EventConfig event_cfg;
+    ThreadRealtime acquisition_rt;
+    ThreadRealtime output_rt;
+    bool lock_memory = false;
+    LatencyReport latency;
+    std::string metrics_path;
+    uint64_t metrics_interval_ms = 5000;
 
     static struct option long_opts[] = {
         {"bus", required_argument, nullptr, 'b'},
         {"addr", required_argument, nullptr, 'a'},
         {"xshut", required_argument, nullptr, 'x'},
+        {"gpio1", required_argument, nullptr, 'g'},
         {"hz", required_argument, nullptr, 'f'},
         {"plain", no_argument, nullptr, 'p'},
+        {"binary", no_argument, nullptr, 'B'},
+        {"continuous", no_argument, nullptr, 'c'},
+        {"reopen-i2c", no_argument, nullptr, 'r'},
+        {"overflow", required_argument, nullptr, 'o'},
+        {"shm", required_argument, nullptr, 'm'},
+        {"no-stdout", no_argument, nullptr, 'n'},
+        {"sensor", required_argument, nullptr, 's'},
+        {"record", required_argument, nullptr, 'R'},
+        {"replay", required_argument, nullptr, 'P'},
+        {"sim", no_argument, nullptr, 'S'},
+        {"sim-trace", required_argument, nullptr, 'T'},
+        {"sim-measure-us", required_argument, nullptr, 'M'},
+        {"sim-bus-us", required_argument, nullptr, 'U'},
+        {"sim-error-rate", required_argument, nullptr, 'E'},
+        {"calibration-cache", required_argument, nullptr, 'C'},
+        {"calibration-max-age", required_argument, nullptr, 'A'},
+        {"filter", required_argument, nullptr, 'F'},
+        {"median-window", required_argument, nullptr, 'W'},
+        {"ema-alpha", required_argument, nullptr, 'L'},
+        {"kalman-q", required_argument, nullptr, 'Q'},
+        {"kalman-r", required_argument, nullptr, 'K'},
+        {"events", no_argument, nullptr, 'v'},
+        {"threshold", required_argument, nullptr, 't'},
+        {"hysteresis", required_argument, nullptr, 'H'},
+        {"delta", required_argument, nullptr, 'D'},
+        {"heartbeat", required_argument, nullptr, 'I'},
+        {"adaptive", no_argument, nullptr, 'j'},
+        {"near-mm", required_argument, nullptr, 'N'},
+        {"idle-ms", required_argument, nullptr, 'i'},
+        {"sched-fifo", required_argument, nullptr, 'y'},
+        {"cpu-acquisition", required_argument, nullptr, 'G'},
+        {"cpu-processing", required_argument, nullptr, 'X'},
+        {"mlock", no_argument, nullptr, 'l'},
+        {"latency-report", required_argument, nullptr, 'Y'},
+        {"metrics", required_argument, nullptr, 'z'},
+        {"metrics-interval", required_argument, nullptr, 'Z'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, 0, nullptr, 0},
     };
@@ -50,12 +547,158 @@ int main(int argc, char** argv) {
             case 'x':
                 cfg.xshut_path = optarg;
                 break;
+            case 'g':
+                cfg.gpio1_path = optarg;
+                break;
             case 'f':
                 cfg.output_hz = std::max(1, std::atoi(optarg));
                 break;
             case 'p':
                 cfg.json_output = false;
                 break;
+            case 'B':
+                binary_output = true;
+                break;
+            case 'm':
+                shm_name = optarg;
+                break;
+            case 'n':
+                stdout_output = false;
+                break;
+            case 'c':
+                cfg.continuous = true;
+                break;
+            case 's': {
+                ToFSensorSpec spec;
+                if (!parse_sensor_spec(optarg, spec)) {
+                    std::cerr << "Invalid --sensor value: " << optarg << std::endl;
+                    usage(argv[0]);
+                    return 1;
+                }
+                sensors.push_back(spec);
+                break;
+            }
+            case 'r':
+                cfg.persistent_i2c = false;
+                break;
+            case 'R':
+                record_path = optarg;
+                break;
+            case 'P':
+                replay_path = optarg;
+                break;
+            case 'S':
+                cfg.simulate = true;
+                break;
+            case 'T':
+                cfg.simulate = true;
+                sim_trace_path = optarg;
+                break;
+            case 'M':
+                cfg.simulate = true;
+                sim_measure_us = std::max(0L, std::strtol(optarg, nullptr, 0));
+                break;
+            case 'U':
+                cfg.simulate = true;
+                cfg.sim.transferMicroseconds = static_cast<uint32_t>(std::max(0L, std::strtol(optarg, nullptr, 0)));
+                break;
+            case 'E':
+                cfg.simulate = true;
+                cfg.sim.errorRate = std::min(1.0, std::max(0.0, std::strtod(optarg, nullptr)));
+                break;
+            case 'C':
+                cfg.calibration_cache = optarg;
+                break;
+            case 'A':
+                cfg.calibration_max_age_s = static_cast<uint32_t>(std::max(0L, std::strtol(optarg, nullptr, 0)));
+                break;
+            case 'F':
+                if (std::strcmp(optarg, "median") == 0) {
+                    filter_cfg.kind = FilterKind::Median;
+                } else if (std::strcmp(optarg, "ema") == 0) {
+                    filter_cfg.kind = FilterKind::Ema;
+                } else if (std::strcmp(optarg, "kalman") == 0) {
+                    filter_cfg.kind = FilterKind::Kalman;
+                } else if (std::strcmp(optarg, "none") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'W':
+                filter_cfg.median_window = static_cast<size_t>(std::max(1L, std::strtol(optarg, nullptr, 0)));
+                break;
+            case 'L':
+                filter_cfg.ema_alpha = std::strtof(optarg, nullptr);
+                break;
+            case 'Q':
+                filter_cfg.kalman_process_noise = std::max(0.0f, std::strtof(optarg, nullptr));
+                break;
+            case 'K':
+                filter_cfg.kalman_measurement_noise = std::max(1e-3f, std::strtof(optarg, nullptr));
+                break;
+            case 'j':
+                cfg.adaptive_timing = true;
+                break;
+            case 'N':
+                cfg.adaptive.near_mm = static_cast<uint16_t>(std::clamp(std::strtol(optarg, nullptr, 0), 0L, 4000L));
+                break;
+            case 'i':
+                cfg.adaptive.idle_ms = static_cast<uint64_t>(std::max(0L, std::strtol(optarg, nullptr, 0)));
+                break;
+            case 'y': {
+                char* end = nullptr;
+                acquisition_rt.fifo_priority = static_cast<int>(std::clamp(std::strtol(optarg, &end, 0), 0L, 99L));
+                if (*end == ',') {
+                    output_rt.fifo_priority = static_cast<int>(std::clamp(std::strtol(end + 1, nullptr, 0), 0L, 99L));
+                }
+                break;
+            }
+            case 'G':
+            case 'X':
+                if (!parse_cpu_list(optarg, opt == 'G' ? acquisition_rt.cpus : output_rt.cpus)) {
+                    std::cerr << "Invalid CPU list: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case 'l':
+                lock_memory = true;
+                break;
+            case 'Y':
+                latency.period_ms = static_cast<uint64_t>(std::max(0.0, std::strtod(optarg, nullptr)) * 1000.0);
+                break;
+            case 'z':
+                metrics_path = optarg;
+                break;
+            case 'Z':
+                metrics_interval_ms =
+                    static_cast<uint64_t>(std::max(0.1, std::strtod(optarg, nullptr)) * 1000.0);
+                break;
+            case 'v':
+                events_mode = true;
+                break;
+            case 't':
+                event_cfg.thresholds_mm.push_back(
+                    static_cast<uint16_t>(std::clamp(std::strtol(optarg, nullptr, 0), 0L, 65535L)));
+                break;
+            case 'H':
+                event_cfg.hysteresis_mm = static_cast<uint16_t>(std::clamp(std::strtol(optarg, nullptr, 0), 0L, 65535L));
+                break;
+            case 'D':
+                event_cfg.delta_mm = static_cast<uint16_t>(std::clamp(std::strtol(optarg, nullptr, 0), 0L, 65535L));
+                break;
+            case 'I':
+                event_cfg.heartbeat_ms = static_cast<uint64_t>(std::max(0L, std::strtol(optarg, nullptr, 0)));
+                break;
+            case 'o':
+                if (std::strcmp(optarg, "overwrite") == 0) {
+                    overwrite_oldest = true;
+                } else if (std::strcmp(optarg, "drop") == 0) {
+                    overwrite_oldest = false;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
             case 'h':
             default:
                 usage(argv[0]);
@@ -63,40 +706,165 @@ int main(int argc, char** argv) {
         }
     }
 
-    ToFReader reader(cfg);
-    if (!reader.init()) {
-        std::cerr << "Failed to initialize VL53L0X" << std::endl;
+    if (!sensors.empty()) {
+        // Each sensor in an array ranges on its own schedule; --hz is the per-sensor rate.
+        cfg.continuous = true;
+        if (cfg.adaptive_timing) {
+            // Profiles change the period the array staggers its sensors across
+            std::cerr << "--adaptive is not supported with --sensor; using fixed timing" << std::endl;
+            cfg.adaptive_timing = false;
+        }
+    }
+    int budget_ms = cfg.timing_budget_ms;
+    if (cfg.simulate) {
+        if (sim_measure_us >= 0) {
+            cfg.sim.measurementMicroseconds = static_cast<uint32_t>(sim_measure_us);
+            budget_ms = static_cast<int>((sim_measure_us + 999) / 1000);
+        } else if (cfg.adaptive_timing) {
+            // The model does not follow the budget; use the shortest preset so it never caps the fast period
+            cfg.sim.measurementMicroseconds = timing_preset(TimingProfile::Fast).budget_us;
+        } else {
+            cfg.sim.measurementMicroseconds = static_cast<uint32_t>(cfg.timing_budget_ms) * 1000U;
+        }
+        if (!sim_trace_path.empty() && !load_sim_trace(sim_trace_path, cfg.sim.trace)) {
+            return 2;
+        }
+    }
+    if (cfg.continuous) {
+        // The sensor paces itself; --hz picks the inter-measurement period it runs at.
+        cfg.inter_measurement_ms = std::max({1, budget_ms, 1000 / cfg.output_hz});
+    }
+
+    std::unique_ptr<ToFReader> reader;
+    std::unique_ptr<ToFArray> array;
+    SampleFile replay;
+    if (!replay_path.empty()) {
+        if (!replay.open(replay_path)) {
+            return 2;
+        }
+    } else if (sensors.empty()) {
+        reader = std::make_unique<ToFReader>(cfg);
+        bool ok = false;
+        try {
+            ok = reader->init();
+        } catch (const std::exception& ex) {
+            std::cerr << "VL53L0X I/O error: " << ex.what() << std::endl;
+        }
+        if (!ok) {
+            std::cerr << "Failed to initialize VL53L0X" << std::endl;
+            return 2;
+        }
+    } else {
+        array = std::make_unique<ToFArray>(cfg, std::move(sensors));
+        if (!array->init()) {
+            std::cerr << "Failed to initialize any VL53L0X in the array" << std::endl;
+            return 2;
+        }
+    }
+
+    ShmPublisher shm;
+    if (!shm_name.empty() && !shm.open(shm_name)) {
         return 2;
     }
 
-    const double interval_ms = 1000.0 / cfg.output_hz;
-    uint64_t next_deadline = monotonic_millis();
+    std::unique_ptr<SampleWriter> recorder;
+    int record_fd = -1;
+    if (!record_path.empty()) {
+        record_fd = open(record_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (record_fd < 0) {
+            std::cerr << "Failed to open " << record_path << ": " << std::strerror(errno) << std::endl;
+            return 2;
+        }
+        recorder = std::make_unique<SampleWriter>(record_fd, OutputFormat::Binary);
+    }
 
-    while (!g_should_exit) {
-        auto measurement = reader.read_once();
-        if (measurement) {
-            if (cfg.json_output) {
-                std::cout << "{\"distance_mm\":" << measurement->distance_mm
-                          << ",\"signal\":" << measurement->signal_rate
-                          << ",\"timestamp_ms\":" << measurement->timestamp_ms
-                          << "}" << std::endl;
+    int wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        std::cerr << "Failed to create eventfd: " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+
+    SampleRing ring(overwrite_oldest);
+    ReaderMetrics metrics;
+    latency.histogram = &metrics.wake;
+    std::atomic<bool> acquisition_done{false};
+    int exit_code = 0;
+
+    if (lock_memory) {
+        // Everything the loops touch exists by now; stacks of the threads below are locked as they map
+        lock_process_memory();
+        prefault_stack();
+    }
+
+    std::thread acquisition([&] {
+        set_thread_name("tof-acquire");
+        apply_thread_realtime("acquisition", acquisition_rt);
+        if (lock_memory) {
+            prefault_stack();
+        }
+        try {
+            if (replay.is_open()) {
+                replay_loop(replay, ring, wake_fd, metrics);
+            } else if (array) {
+                array_acquisition_loop(*array, ring, wake_fd, latency, metrics);
             } else {
-                std::cout << measurement->distance_mm << std::endl;
+                acquisition_loop(*reader, cfg, ring, wake_fd, latency, metrics);
             }
+            latency.finish();
+        } catch (const std::exception& ex) {
+            std::cerr << "VL53L0X I/O error: " << ex.what() << std::endl;
+            exit_code = 3;
         }
-        next_deadline += static_cast<uint64_t>(interval_ms);
-        uint64_t now = monotonic_millis();
-        if (next_deadline > now) {
-            uint64_t sleep_ms = next_deadline - now;
-            struct timespec ts {
-                .tv_sec = static_cast<time_t>(sleep_ms / 1000),
-                .tv_nsec = static_cast<long>((sleep_ms % 1000) * 1'000'000)
-            };
-            nanosleep(&ts, nullptr);
-        } else {
-            next_deadline = now;
+        metrics.acquisition_cpu_s.store(thread_cpu_seconds(pthread_self()), std::memory_order_relaxed);
+        acquisition_done.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        (void)write(wake_fd, &one, sizeof(one));
+    });
+
+    OutputFormat format = binary_output ? OutputFormat::Binary
+                          : cfg.json_output ? OutputFormat::Json
+                                            : OutputFormat::Plain;
+    SampleWriter writer(STDOUT_FILENO, format);
+    // The emitter stays on the main thread, which keeps the process name
+    apply_thread_realtime("processing", output_rt);
+    DistanceFilter filter(filter_cfg);
+    std::unique_ptr<EventGate> events = events_mode ? std::make_unique<EventGate>(event_cfg) : nullptr;
+
+    std::unique_ptr<MetricsFile> metrics_file;
+    if (!metrics_path.empty()) {
+        std::vector<const ToFReader*> readers;
+        if (reader) {
+            readers.push_back(reader.get());
         }
+        for (size_t i = 0; array && i < array->size(); ++i) {
+            readers.push_back(&array->reader(i));
+        }
+        metrics_file = std::make_unique<MetricsFile>(
+            metrics_path, metrics_interval_ms,
+            [&metrics, &ring, readers, acquisition_thread = acquisition.native_handle(), output_thread = pthread_self(),
+             baseline = MetricsBaseline{}]() mutable {
+                return format_metrics(metrics, ring, readers, acquisition_thread, output_thread, baseline);
+            });
+        metrics_file->start();
     }
 
-    return 0;
+    emitter_loop(stdout_output ? &writer : nullptr, recorder.get(), shm, ring, wake_fd, acquisition_done, filter,
+                 events.get(), metrics, !replay.is_open());
+    g_should_exit.store(true);
+    if (metrics_file) {
+        // Before join() invalidates the acquisition thread's handle
+        metrics_file->stop();
+    }
+    acquisition.join();
+    close(wake_fd);
+    if (recorder) {
+        recorder->flush();
+        close(record_fd);
+    }
+
+    if (ring.dropped() != 0 || ring.overwritten() != 0) {
+        std::cerr << "tof-reader backpressure totals: dropped=" << ring.dropped()
+                  << " overwritten=" << ring.overwritten() << std::endl;
+    }
+    return exit_code;
 }
@@ -0,0 +1,164 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <time.h>
+#include <unistd.h>
+
+#include "realtime.hpp"
+
+const int64_t LatencyHistogram::kBoundsUs[kBounds] = {50,    100,    250,    500,     1000,    2500,   5000,
+                                                      10000, 25000, 50000, 100000, 250000, 1000000};
+
+void LatencyHistogram::record(int64_t us) {
+    if (us < 0) {
+        us = 0;
+    }
+    size_t bucket = 0;
+    while (bucket < kBounds && us > kBoundsUs[bucket]) {
+        ++bucket;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsText::family(const char* name, const char* type, const char* help) {
+    text_ += "# HELP ";
+    text_ += name;
+    text_ += ' ';
+    text_ += help;
+    text_ += "\n# TYPE ";
+    text_ += name;
+    text_ += ' ';
+    text_ += type;
+    text_ += '\n';
+}
+
+namespace {
+void append_name(std::string& text, const char* name, const std::string& labels) {
+    text += name;
+    if (!labels.empty()) {
+        text += '{';
+        text += labels;
+        text += '}';
+    }
+    text += ' ';
+}
+}  // namespace
+
+void MetricsText::sample(const char* name, uint64_t value, const std::string& labels) {
+    append_name(text_, name, labels);
+    text_ += std::to_string(value);
+    text_ += '\n';
+}
+
+void MetricsText::sample(const char* name, double value, const std::string& labels) {
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.9g", value);
+    append_name(text_, name, labels);
+    text_ += number;
+    text_ += '\n';
+}
+
+void MetricsText::histogram(const char* name, const LatencyHistogram& histogram, const std::string& labels) {
+    const std::string bucket_name = std::string(name) + "_bucket";
+    const std::string prefix = labels.empty() ? std::string() : labels + ",";
+    // Buckets are read one by one while others record, so clamp to keep the series cumulative
+    uint64_t count = histogram.count_.load(std::memory_order_relaxed);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= LatencyHistogram::kBounds; ++i) {
+        cumulative += histogram.buckets_[i].load(std::memory_order_relaxed);
+        char le[32];
+        if (i < LatencyHistogram::kBounds) {
+            std::snprintf(le, sizeof(le), "le=\"%g\"", static_cast<double>(LatencyHistogram::kBoundsUs[i]) / 1e6);
+        } else {
+            std::snprintf(le, sizeof(le), "le=\"+Inf\"");
+        }
+        sample(bucket_name.c_str(), i < LatencyHistogram::kBounds ? std::min(cumulative, count) : count, prefix + le);
+    }
+    sample((std::string(name) + "_sum").c_str(),
+           static_cast<double>(histogram.sum_us_.load(std::memory_order_relaxed)) / 1e6, labels);
+    sample((std::string(name) + "_count").c_str(), count, labels);
+}
+
+MetricsFile::MetricsFile(std::string path, uint64_t interval_ms, std::function<std::string()> collect)
+    : path_(std::move(path)), interval_ms_(interval_ms), collect_(std::move(collect)) {}
+
+MetricsFile::~MetricsFile() {
+    stop();
+}
+
+void MetricsFile::start() {
+    thread_ = std::thread(&MetricsFile::run, this);
+}
+
+void MetricsFile::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+void MetricsFile::run() {
+    set_thread_name("metrics");
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        bool stopping = wake_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return stopping_; });
+        lock.unlock();
+        write_file(collect_());
+        lock.lock();
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+bool MetricsFile::write_file(const std::string& text) const {
+    const std::string tmp = path_ + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << tmp << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    ok = (close(fd) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Failed to write metrics to " << path_ << ": " << std::strerror(errno) << std::endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+namespace {
+double clock_seconds(clockid_t clock) {
+    timespec ts{};
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0.0;
+    }
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+}  // namespace
+
+double process_cpu_seconds() {
+    return clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+double thread_cpu_seconds(pthread_t thread) {
+    clockid_t clock;
+    if (pthread_getcpuclockid(thread, &clock) != 0) {
+        return 0.0;
+    }
+    return clock_seconds(clock);
+}
@@ -0,0 +1,165 @@
+#include "realtime.hpp"
+
+#include <alloca.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Messages carry the program name (glibc's program_invocation_short_name): tof-reader, d435i-liveness or
+// sensor-daemon.
+
+bool parse_cpu_list(const char* text, std::vector<int>& cpus) {
+    cpus.clear();
+    const char* p = text;
+    while (*p != '\0') {
+        char* end = nullptr;
+        long first = std::strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*p == ',') {
+            ++p;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    return !cpus.empty();
+}
+
+void set_thread_name(const char* name) {
+    // The kernel keeps 15 characters
+    char short_name[16];
+    std::snprintf(short_name, sizeof(short_name), "%s", name);
+    pthread_setname_np(pthread_self(), short_name);
+}
+
+bool apply_thread_realtime(const char* name, const ThreadRealtime& rt) {
+    pthread_t self = pthread_self();
+    bool ok = true;
+    if (!rt.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : rt.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << program_invocation_short_name << " " << name << ": CPU affinity not applied: "
+                      << std::strerror(err) << std::endl;
+            ok = false;
+        }
+    }
+    if (rt.fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = std::clamp(rt.fifo_priority, sched_get_priority_min(SCHED_FIFO),
+                                          sched_get_priority_max(SCHED_FIFO));
+        int err = pthread_setschedparam(self, SCHED_FIFO, &param);
+        if (err != 0) {
+            std::cerr << program_invocation_short_name << " " << name << ": SCHED_FIFO " << param.sched_priority
+                      << " not applied: " << std::strerror(err)
+                      << (err == EPERM ? " (needs CAP_SYS_NICE or an RLIMIT_RTPRIO)" : "") << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool lock_process_memory() {
+    // Freed memory stays in the heap instead of being trimmed or unmapped, so it stays locked and mapped
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    int flags = MCL_CURRENT | MCL_FUTURE;
+    rlimit limit{};
+    if (geteuid() != 0 && getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        // MCL_FUTURE would count every new thread's 8 MiB stack against the limit and make thread creation fail
+        std::cerr << program_invocation_short_name << ": RLIMIT_MEMLOCK is " << (limit.rlim_cur / 1024)
+                  << " KiB; locking current memory only (raise it or grant CAP_IPC_LOCK for all of it)" << std::endl;
+        flags = MCL_CURRENT;
+    }
+    if (mlockall(flags) != 0) {
+        std::cerr << program_invocation_short_name << ": mlockall failed: " << std::strerror(errno)
+                  << (errno == ENOMEM || errno == EPERM ? " (raise RLIMIT_MEMLOCK or grant CAP_IPC_LOCK)" : "")
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void prefault_stack(size_t bytes) {
+    // alloca() rather than a recursive fixed array, which the compiler may turn into a loop on one frame
+    volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+void WakeLatency::record(int64_t late_us) {
+    late_us = std::max<int64_t>(0, late_us);
+    size_t bucket;
+    if (late_us < static_cast<int64_t>(kFineBuckets) * kFineWidthUs) {
+        bucket = static_cast<size_t>(late_us / kFineWidthUs);
+    } else {
+        int64_t coarse = (late_us - static_cast<int64_t>(kFineBuckets) * kFineWidthUs) / kCoarseWidthUs;
+        bucket = kFineBuckets + static_cast<size_t>(std::min<int64_t>(coarse, kCoarseBuckets - 1));
+    }
+    ++buckets_[bucket];
+    ++count_;
+    total_us_ += late_us;
+    max_us_ = std::max(max_us_, late_us);
+}
+
+void WakeLatency::reset() {
+    *this = WakeLatency();
+}
+
+// Upper edge of the bucket holding the given fraction of samples, capped at the observed maximum.
+int64_t WakeLatency::percentile_us(double fraction) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kFineBuckets + kCoarseBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            int64_t edge = (i < kFineBuckets)
+                               ? static_cast<int64_t>(i + 1) * kFineWidthUs
+                               : static_cast<int64_t>(kFineBuckets) * kFineWidthUs +
+                                     static_cast<int64_t>(i - kFineBuckets + 1) * kCoarseWidthUs;
+            return std::min(edge, max_us_);
+        }
+    }
+    return max_us_;
+}
+
+void WakeLatency::report(const char* name) const {
+    char line[160];
+    int n = std::snprintf(line, sizeof(line), "%s %s latency: n=%llu mean=%.0fus p50=%lldus p99=%lldus max=%lldus\n",
+                          program_invocation_short_name, name, static_cast<unsigned long long>(count_), mean_us(),
+                          static_cast<long long>(percentile_us(0.5)), static_cast<long long>(percentile_us(0.99)),
+                          static_cast<long long>(max_us_));
+    if (n > 0) {
+        (void)write(STDERR_FILENO, line, std::min(static_cast<size_t>(n), sizeof(line) - 1));
+    }
+}
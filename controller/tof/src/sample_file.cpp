@@ -0,0 +1,96 @@
+#include "sample_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sample_writer.hpp"
+
+namespace {
+
+uint64_t get_le(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+}  // namespace
+
+SampleFile::~SampleFile() {
+    close();
+}
+
+bool SampleFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open sample file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kBinaryHeaderSize)) {
+        std::cerr << "Sample file " << path << " is too short" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Failed to map sample file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Replay walks the file front to back exactly once.
+    madvise(addr, length, MADV_SEQUENTIAL);
+
+    const uint8_t* data = static_cast<const uint8_t*>(addr);
+    uint16_t version = static_cast<uint16_t>(get_le(data + 4, 2));
+    size_t record_size = static_cast<size_t>(get_le(data + 6, 2));
+    if (std::memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) != 0 || version != kBinaryVersion ||
+        record_size < kBinaryMinRecordSize) {
+        std::cerr << "Sample file " << path << " is not a tof-reader binary stream" << std::endl;
+        munmap(addr, length);
+        return false;
+    }
+
+    data_ = data;
+    length_ = length;
+    record_size_ = record_size;
+    count_ = (length - kBinaryHeaderSize) / record_size;
+    return true;
+}
+
+void SampleFile::close() {
+    if (!data_) {
+        return;
+    }
+    munmap(const_cast<uint8_t*>(data_), length_);
+    data_ = nullptr;
+    length_ = 0;
+    record_size_ = 0;
+    count_ = 0;
+}
+
+ToFMeasurement SampleFile::at(size_t index) const {
+    const uint8_t* record = data_ + kBinaryHeaderSize + index * record_size_;
+    ToFMeasurement measurement;
+    measurement.timestamp_ms = get_le(record, 8);
+    measurement.sequence = static_cast<uint32_t>(get_le(record + 8, 4));
+    measurement.distance_mm = static_cast<uint16_t>(get_le(record + 12, 2));
+    measurement.status = static_cast<uint8_t>(get_le(record + 14, 2));
+    uint32_t signal_bits = static_cast<uint32_t>(get_le(record + 16, 4));
+    std::memcpy(&measurement.signal_rate, &signal_bits, sizeof(signal_bits));
+    measurement.sensor_id = static_cast<uint8_t>(get_le(record + 20, 2));
+    if (record_size_ >= kBinaryRecordSize) {
+        uint32_t ambient_bits = static_cast<uint32_t>(get_le(record + 24, 4));
+        std::memcpy(&measurement.ambient_rate, &ambient_bits, sizeof(ambient_bits));
+    }
+    return measurement;
+}
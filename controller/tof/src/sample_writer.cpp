@@ -0,0 +1,89 @@
+#include "sample_writer.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+void put_le(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+}  // namespace
+
+SampleWriter::SampleWriter(int fd, OutputFormat format) : fd_(fd), format_(format) {
+    buffer_.reserve(4096);
+    if (format_ == OutputFormat::Binary) {
+        buffer_.append(kBinaryMagic, sizeof(kBinaryMagic));
+        put_le(buffer_, kBinaryVersion, 2);
+        put_le(buffer_, kBinaryRecordSize, 2);
+    }
+}
+
+void SampleWriter::append(const ToFMeasurement& measurement) {
+    switch (format_) {
+        case OutputFormat::Binary: {
+            uint32_t signal_bits;
+            uint32_t ambient_bits;
+            static_assert(sizeof(signal_bits) == sizeof(measurement.signal_rate), "float32 expected");
+            std::memcpy(&signal_bits, &measurement.signal_rate, sizeof(signal_bits));
+            std::memcpy(&ambient_bits, &measurement.ambient_rate, sizeof(ambient_bits));
+            put_le(buffer_, measurement.timestamp_ms, 8);
+            put_le(buffer_, measurement.sequence, 4);
+            put_le(buffer_, measurement.distance_mm, 2);
+            put_le(buffer_, measurement.status, 2);
+            put_le(buffer_, signal_bits, 4);
+            put_le(buffer_, measurement.sensor_id, 2);
+            put_le(buffer_, 0, 2);
+            put_le(buffer_, ambient_bits, 4);
+            break;
+        }
+        case OutputFormat::Json: {
+            char line[160];
+            int n = std::snprintf(line, sizeof(line),
+                                  "{\"distance_mm\":%u,\"status\":%u,\"signal\":%g,\"ambient\":%g,\"timestamp_ms\":%llu,"
+                                  "\"sensor\":%u}\n",
+                                  static_cast<unsigned>(measurement.distance_mm),
+                                  static_cast<unsigned>(measurement.status),
+                                  static_cast<double>(measurement.signal_rate),
+                                  static_cast<double>(measurement.ambient_rate),
+                                  static_cast<unsigned long long>(measurement.timestamp_ms),
+                                  static_cast<unsigned>(measurement.sensor_id));
+            buffer_.append(line, static_cast<size_t>(n));
+            break;
+        }
+        case OutputFormat::Plain: {
+            if (measurement.status != 0) {
+                buffer_.append("-\n");  // no range; the raw reading (8190 with no target) is not a distance
+                break;
+            }
+            char line[16];
+            int n = std::snprintf(line, sizeof(line), "%u\n", static_cast<unsigned>(measurement.distance_mm));
+            buffer_.append(line, static_cast<size_t>(n));
+            break;
+        }
+    }
+}
+
+bool SampleWriter::flush() {
+    size_t offset = 0;
+    while (offset < buffer_.size()) {
+        ssize_t n = write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "tof-reader output write failed: " << std::strerror(errno) << std::endl;
+            buffer_.clear();
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    buffer_.clear();
+    return true;
+}
@@ -0,0 +1,78 @@
+#include "shm_channel.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+ShmPublisher::~ShmPublisher() {
+    close();
+}
+
+bool ShmPublisher::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, sizeof(ShmLayout)) != 0) {
+        std::cerr << "Failed to size shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, sizeof(ShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    layout_ = new (addr) ShmLayout{};
+    layout_->version = kShmVersion;
+    layout_->history_length = kShmHistoryLength;
+    layout_->publisher_pid = static_cast<uint32_t>(getpid());
+    // Readers check the magic last, so publish it after the rest of the header.
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(layout_->magic, kShmMagic, sizeof(kShmMagic));
+    name_ = name;
+    return true;
+}
+
+void ShmPublisher::close() {
+    if (!layout_) {
+        return;
+    }
+    munmap(layout_, sizeof(ShmLayout));
+    layout_ = nullptr;
+    // Remove the name so new readers do not pick up a stale sample; existing mappings stay valid.
+    shm_unlink(name_.c_str());
+    name_.clear();
+}
+
+void ShmPublisher::publish(const ToFMeasurement& measurement) {
+    if (!layout_) {
+        return;
+    }
+    ShmSample sample{};
+    sample.timestamp_ms = measurement.timestamp_ms;
+    sample.sequence = measurement.sequence;
+    sample.distance_mm = measurement.distance_mm;
+    sample.status = measurement.status;
+    sample.signal_rate = measurement.signal_rate;
+    sample.sensor_id = measurement.sensor_id;
+
+    uint32_t seq = layout_->seq.load(std::memory_order_relaxed);
+    layout_->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    layout_->latest = sample;
+    layout_->history[layout_->write_count % kShmHistoryLength] = sample;
+    layout_->write_count += 1;
+
+    layout_->seq.store(seq + 2, std::memory_order_release);
+}
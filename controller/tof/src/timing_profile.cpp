@@ -0,0 +1,79 @@
+#include "timing_profile.hpp"
+
+namespace {
+// Budgets and limits from the API's ranging profile examples (VL53L0X user manual, UM2039); the periods
+// are ours: 40 Hz while someone is close, 5 Hz while the sensor only waits for someone to show up.
+const TimingPreset kFast{20000, 14, 10, 0.25f, 25};
+const TimingPreset kBalanced{0, 14, 10, 0.25f, 0};  // budget and period from ToFConfig
+const TimingPreset kLongRange{33000, 18, 14, 0.1f, 200};
+}  // namespace
+
+const TimingPreset& timing_preset(TimingProfile profile) {
+    switch (profile) {
+        case TimingProfile::Fast:
+            return kFast;
+        case TimingProfile::LongRange:
+            return kLongRange;
+        case TimingProfile::Balanced:
+        default:
+            return kBalanced;
+    }
+}
+
+const char* timing_profile_name(TimingProfile profile) {
+    switch (profile) {
+        case TimingProfile::Fast:
+            return "fast";
+        case TimingProfile::LongRange:
+            return "long-range";
+        case TimingProfile::Balanced:
+        default:
+            return "balanced";
+    }
+}
+
+ProfileSelector::ProfileSelector(const AdaptiveTimingConfig& config, TimingProfile initial)
+    : config_(config), current_(initial) {}
+
+TimingProfile ProfileSelector::wanted(bool valid, uint16_t distance_mm, float signal_mcps) const {
+    if (!valid || distance_mm > config_.far_mm) {
+        return TimingProfile::LongRange;
+    }
+    int fast_limit = config_.near_mm + (current_ == TimingProfile::Fast ? config_.hysteresis_mm : 0);
+    if (distance_mm < fast_limit && signal_mcps >= config_.min_signal_mcps) {
+        return TimingProfile::Fast;
+    }
+    return TimingProfile::Balanced;
+}
+
+TimingProfile ProfileSelector::update(bool valid, uint16_t distance_mm, float signal_mcps, uint64_t now_ms) {
+    if (!started_) {
+        // Idle time counts from the first sample, not from boot
+        started_ = true;
+        target_ms_ = now_ms;
+    }
+    TimingProfile want = wanted(valid, distance_mm, signal_mcps);
+    if (want != TimingProfile::LongRange) {
+        target_ms_ = now_ms;
+    }
+
+    if (want <= current_) {
+        // Same or faster: take it right away
+        current_ = want;
+        slower_pending_ = false;
+        return current_;
+    }
+    if (!slower_pending_) {
+        slower_pending_ = true;
+        slower_since_ms_ = now_ms;
+    }
+    if (want == TimingProfile::LongRange && now_ms - target_ms_ >= config_.idle_ms) {
+        current_ = TimingProfile::LongRange;
+        slower_pending_ = false;
+    } else if (current_ == TimingProfile::Fast && now_ms - slower_since_ms_ >= config_.dwell_ms) {
+        // Leaving Fast always goes through Balanced; LongRange still waits for idle_ms
+        current_ = TimingProfile::Balanced;
+        slower_pending_ = false;
+    }
+    return current_;
+}
@@ -0,0 +1,91 @@
+#include "tof_array.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+ToFArray::ToFArray(const ToFConfig& base, std::vector<ToFSensorSpec> sensors)
+    : base_(base), specs_(std::move(sensors)) {
+    base_.continuous = true;
+    base_.gpio1_path.clear();
+}
+
+bool ToFArray::init() {
+    // Every sensor boots at the default address, so all of them must be quiet before the first one is released.
+    for (const auto& spec : specs_) {
+        if (!write_gpio_value(spec.xshut_path, false)) {
+            return false;
+        }
+    }
+    if (specs_.size() > 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    for (size_t i = 0; i < specs_.size(); ++i) {
+        const auto& spec = specs_[i];
+        ToFConfig cfg = base_;
+        cfg.i2c_address = spec.address;
+        cfg.xshut_path = spec.xshut_path;
+        cfg.assign_address = !spec.xshut_path.empty();
+        cfg.sensor_id = static_cast<uint8_t>(i);
+
+        auto reader = std::make_unique<ToFReader>(cfg);
+        bool ok = false;
+        try {
+            ok = reader->init(false);
+        } catch (const std::exception& ex) {
+            std::cerr << "VL53L0X I/O error: " << ex.what() << std::endl;
+        }
+        if (!ok) {
+            // Back into reset so it cannot answer at 0x29 while the next sensor is assigned
+            std::cerr << "ToF sensor " << i << " at 0x" << std::hex << static_cast<unsigned>(spec.address)
+                      << std::dec << " failed to initialize" << std::endl;
+            write_gpio_value(spec.xshut_path, false);
+            continue;
+        }
+        slots_.push_back(Slot{std::move(reader), 0});
+    }
+    if (slots_.empty()) {
+        return false;
+    }
+
+    // Spread the start times across one period so readouts interleave instead of colliding.
+    const uint64_t period = static_cast<uint64_t>(std::max(1, base_.inter_measurement_ms));
+    const uint64_t stagger = period / slots_.size();
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (i != 0 && stagger != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(stagger));
+        }
+        slots_[i].reader->start_ranging();
+        slots_[i].next_due_ms = monotonic_millis() + static_cast<uint64_t>(base_.timing_budget_ms);
+    }
+    return true;
+}
+
+size_t ToFArray::poll(std::vector<ToFMeasurement>& out) {
+    size_t appended = 0;
+    for (auto& slot : slots_) {
+        uint64_t now = monotonic_millis();
+        if (slot.next_due_ms > now) {
+            continue;
+        }
+        auto measurement = slot.reader->try_read();
+        if (measurement) {
+            out.push_back(*measurement);
+            ++appended;
+        }
+        // Sleep until just before the next sample is due, then poll for it.
+        slot.next_due_ms = slot.reader->next_poll_ms(monotonic_millis());
+    }
+    return appended;
+}
+
+uint64_t ToFArray::next_due_ms() const {
+    uint64_t due = UINT64_MAX;
+    for (const auto& slot : slots_) {
+        due = std::min(due, slot.next_due_ms);
+    }
+    return due;
+}
@@ -1,4 +1,5 @@
 #include "tof_reader.hpp"
+#include "calibration_cache.hpp"
 
 #include <chrono>
 #include <cctype>
@@ -9,6 +10,12 @@
 
 #include <vl53lXx/vl53l0x.hpp>
 
+namespace {
+constexpr uint16_t kSensorTimeoutMs = 200;
+// Poll interval while waiting for a continuous-mode sample that is due but not ready yet.
+constexpr uint64_t kContinuousPollMs = 2;
+}  // namespace
+
 uint64_t monotonic_millis() {
     using namespace std::chrono;
     return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
@@ -27,9 +34,16 @@ bool write_gpio_value(const std::string& path, bool high) {
     return ofs.good();
 }
 
-ToFReader::ToFReader(const ToFConfig& cfg) : config_(cfg) {}
+ToFReader::ToFReader(const ToFConfig& cfg) : config_(cfg), profiles_(cfg.adaptive) {}
 
-ToFReader::~ToFReader() = default;
+ToFReader::~ToFReader() {
+    if (initialized_ && sensor_ && config_.continuous) {
+        try {
+            sensor_->stopContinuous();
+        } catch (...) {
+        }
+    }
+}
 
 int ToFReader::parse_bus_number(const std::string& bus) const {
     auto pos = bus.rfind("i2c-");
@@ -72,50 +86,235 @@ bool ToFReader::reset_sensor() {
     return true;
 }
 
-bool ToFReader::init() {
+bool ToFReader::init(bool start_ranging) {
     bus_number_ = parse_bus_number(config_.i2c_bus);
 
     if (!reset_sensor()) {
         return false;
     }
 
-    sensor_ = std::make_unique<VL53L0X>(static_cast<uint8_t>(bus_number_), config_.i2c_address, -1, true);
-    sensor_->setTimeout(200);  // Increased timeout for single-shot mode
+    uint8_t boot_address = config_.assign_address ? VL53L0X_ADDRESS_DEFAULT : config_.i2c_address;
+    if (config_.simulate) {
+        sensor_ = std::make_unique<VL53L0X>(new VL53L0Xsim(config_.sim, boot_address), -1, true);
+    } else {
+        sensor_ = std::make_unique<VL53L0X>(static_cast<uint8_t>(bus_number_), boot_address, -1, true);
+    }
+    sensor_->setPersistentBus(config_.persistent_i2c);
+    sensor_->setTimeout(kSensorTimeoutMs);  // Increased timeout for single-shot mode
+    if (config_.assign_address && config_.i2c_address != boot_address) {
+        // Only valid while every other sensor on the bus is held in reset
+        sensor_->setAddress(config_.i2c_address);
+    }
 
-    if (!sensor_->init()) {
+    if (!init_sensor()) {
         std::cerr << "VL53L0X init failed" << std::endl;
         sensor_.reset();
         return false;
     }
 
-    if (!sensor_->setMeasurementTimingBudget(static_cast<uint32_t>(config_.timing_budget_ms) * 1000U)) {
+    // init() leaves the VCSEL periods and signal limit at the Balanced preset's values
+    if (!apply_timing(TimingProfile::Balanced)) {
         std::cerr << "Failed to set measurement timing budget" << std::endl;
     }
 
-    // Remove continuous mode - we'll use single-shot mode instead
+    if (!config_.gpio1_path.empty() && !data_ready_.open(config_.gpio1_path)) {
+        std::cerr << "GPIO1 data-ready unavailable; falling back to register polling" << std::endl;
+    }
+
     initialized_ = true;
+    update_bus_counters();
+    if (start_ranging) {
+        this->start_ranging();
+    }
+    return true;
+}
+
+// Restores the cached calibration when there is a usable one, else runs (and caches) the full calibration.
+bool ToFReader::init_sensor() {
+    if (config_.calibration_cache.empty()) {
+        return sensor_->init();
+    }
+    const std::string bus = config_.simulate ? "sim" : config_.i2c_bus;
+    auto cached = load_calibration(config_.calibration_cache, bus, config_.i2c_address, config_.calibration_max_age_s);
+    if (cached && sensor_->init(*cached)) {
+        return true;
+    }
+    if (cached) {
+        std::cerr << "Cached VL53L0X calibration for " << bus << " 0x" << std::hex << int(config_.i2c_address)
+                  << std::dec << " does not match the sensor; recalibrating" << std::endl;
+    }
+    if (!sensor_->init()) {
+        return false;
+    }
+    VL53L0XCalibration calibration;
+    if (sensor_->getCalibration(&calibration)) {
+        save_calibration(config_.calibration_cache, bus, config_.i2c_address, calibration);
+    }
     return true;
 }
 
+void ToFReader::start_ranging() {
+    // Single-shot by default; continuous timed mode lets the sensor pace itself
+    if (initialized_ && config_.continuous) {
+        sensor_->startContinuous(period_ms());
+        ranging_ = true;
+        consumed_ms_ = 0;
+    }
+}
+
+uint32_t ToFReader::period_ms() const {
+    uint32_t preset = config_.adaptive_timing ? timing_preset(profile_).period_ms : 0;
+    if (preset != 0) {
+        return preset;
+    }
+    if (config_.continuous) {
+        return static_cast<uint32_t>(config_.inter_measurement_ms);
+    }
+    return static_cast<uint32_t>(1000 / config_.output_hz);
+}
+
+// Only touches what differs from the active preset: each VCSEL period change costs a phase calibration.
+bool ToFReader::apply_timing(TimingProfile profile) {
+    const TimingPreset& from = timing_preset(profile_);
+    const TimingPreset& to = timing_preset(profile);
+    bool restart = ranging_;
+    if (restart) {
+        sensor_->stopContinuous();
+    }
+    bool ok = true;
+    if (to.signal_rate_limit_mcps != from.signal_rate_limit_mcps) {
+        ok = sensor_->setSignalRateLimit(to.signal_rate_limit_mcps) && ok;
+    }
+    if (to.pre_range_vcsel_pclks != from.pre_range_vcsel_pclks) {
+        ok = sensor_->setVcselPulsePeriod(VcselPeriodPreRange, to.pre_range_vcsel_pclks) && ok;
+    }
+    if (to.final_range_vcsel_pclks != from.final_range_vcsel_pclks) {
+        ok = sensor_->setVcselPulsePeriod(VcselPeriodFinalRange, to.final_range_vcsel_pclks) && ok;
+    }
+    // After the VCSEL periods, which the phase step timeouts depend on
+    uint32_t budget_us = (to.budget_us != 0) ? to.budget_us : static_cast<uint32_t>(config_.timing_budget_ms) * 1000U;
+    ok = sensor_->setMeasurementTimingBudget(budget_us) && ok;
+    profile_ = profile;
+    if (restart) {
+        sensor_->startContinuous(period_ms());
+    }
+    return ok;
+}
+
 std::optional<ToFMeasurement> ToFReader::read_once() {
     if (!initialized_ || !sensor_) {
         return std::nullopt;
     }
 
-    // Use single-shot mode instead of continuous mode
-    uint16_t distance = sensor_->readRangeSingleMillimeters();
+    VL53L0XRangingData data;
+    bool ready;
+    uint64_t timestamp_ms;
+    if (data_ready_.is_open()) {
+        data_ready_.clear();
+        if (config_.continuous) {
+            // A sample may already be waiting from the sensor's own schedule
+            ready = sensor_->readRangingData(&data, false);
+        } else {
+            sensor_->readRangeSingleMillimeters(false);
+            ready = false;
+        }
+        timestamp_ms = monotonic_millis();
+        if (!ready) {
+            if (data_ready_.wait(kSensorTimeoutMs) < 0) {
+                std::cerr << "GPIO1 wait failed; falling back to register polling" << std::endl;
+                data_ready_.close();
+            }
+            timestamp_ms = monotonic_millis();
+            ready = sensor_->readRangingData(&data, false);
+        }
+        if (!ready) {
+            // Missed or spurious edge: poll the interrupt status like the non-GPIO path does
+            ready = sensor_->readRangingData(&data, true);
+            timestamp_ms = monotonic_millis();
+        }
+    } else {
+        if (!config_.continuous) {
+            sensor_->readRangeSingleMillimeters(false);
+        }
+        ready = sensor_->readRangingData(&data, true);
+        timestamp_ms = monotonic_millis();
+    }
+    return finish_measurement(ready ? &data : nullptr, timestamp_ms);
+}
+
+std::optional<ToFMeasurement> ToFReader::try_read() {
+    if (!initialized_ || !sensor_ || !config_.continuous) {
+        return std::nullopt;
+    }
+
+    VL53L0XRangingData data;
+    if (!sensor_->readRangingData(&data, false)) {
+        update_bus_counters();
+        return std::nullopt;
+    }
+    consumed_ms_ = monotonic_millis();
+    return finish_measurement(&data, consumed_ms_);
+}
+
+uint64_t ToFReader::next_poll_ms(uint64_t now_ms) const {
+    const uint64_t period = period_ms();
+    if (consumed_ms_ != 0 && period > 2 * kContinuousPollMs) {
+        uint64_t due = consumed_ms_ + period - 2 * kContinuousPollMs;
+        if (due > now_ms) {
+            return due;
+        }
+    }
+    return now_ms + kContinuousPollMs;
+}
+
+void ToFReader::update_bus_counters() {
+    const I2CTransferCounts& bus = sensor_->busCounts();
+    counters_.i2c_transfers.store(bus.transfers, std::memory_order_relaxed);
+    counters_.i2c_errors.store(bus.errors, std::memory_order_relaxed);
+}
+
+std::optional<ToFMeasurement> ToFReader::finish_measurement(const VL53L0XRangingData* data, uint64_t timestamp_ms) {
+    std::optional<ToFMeasurement> measurement = decode_measurement(data, timestamp_ms);
+    if (measurement) {
+        counters_.samples.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!config_.adaptive_timing) {
+        update_bus_counters();
+        return measurement;
+    }
+    // Failed reads and out-of-range results count as nobody there
+    bool valid = measurement && measurement->status == 0;
+    TimingProfile next = profiles_.update(valid, valid ? measurement->distance_mm : 0,
+                                          valid ? measurement->signal_rate : 0.0f, timestamp_ms);
+    if (next != profile_ && !apply_timing(next)) {
+        std::cerr << "Failed to switch to the " << timing_profile_name(next) << " timing profile" << std::endl;
+    }
+    update_bus_counters();
+    return measurement;
+}
+
+std::optional<ToFMeasurement> ToFReader::decode_measurement(const VL53L0XRangingData* data, uint64_t timestamp_ms) {
     if (sensor_->timeoutOccurred()) {
+        counters_.timeouts.fetch_add(1, std::memory_order_relaxed);
         std::cerr << "VL53L0X measurement timeout" << std::endl;
         return std::nullopt;
     }
 
-    if (distance == 0 || distance > 4000) {
+    if (!data) {
         return std::nullopt;
     }
 
     ToFMeasurement measurement;
-    measurement.distance_mm = distance;
-    measurement.signal_rate = 0.0f;
-    measurement.timestamp_ms = monotonic_millis();
+    measurement.distance_mm = data->rangeMillimeters;
+    measurement.signal_rate = data->signalRateMCPS;
+    measurement.ambient_rate = data->ambientRateMCPS;
+    if (data->rangeStatus != VL53L0X_RANGE_STATUS_VALID) {
+        measurement.status = (data->rangeStatus != 0) ? data->rangeStatus : 255;
+    } else if (data->rangeMillimeters == 0 || data->rangeMillimeters > 4000) {
+        // Nothing in reach (8190 and the like): still a sample, so the consumers see the target go
+        measurement.status = 255;
+    }
+    measurement.timestamp_ms = timestamp_ms;
+    measurement.sensor_id = config_.sensor_id;
     return measurement;
 }
@@ -66,6 +66,7 @@ class I2Cdev: public I2Cgeneric {
 
         void setAddress(uint8_t address);
         uint8_t getAddress();
+        void setPersistent(bool persistent);
 
         //8-bits addresses
         int8_t readBit(uint8_t regAddr, uint8_t bitNum, uint8_t *data, uint16_t timeout=0);
@@ -107,11 +108,22 @@ class I2Cdev: public I2Cgeneric {
         bool writeBytes(uint16_t regAddr, uint8_t length, uint8_t *data);
         bool writeWords(uint16_t regAddr, uint8_t length, uint16_t *data);
 
+        bool writeBatch(const I2CRegisterWrite *writes, uint16_t count);
+
         uint16_t readTimeout = 0;
     
     private:
         uint8_t address;
         char i2c_path[12];
+        bool persistent = false;
+        int fd = -1;
+        int selectedAddress = -1;
+        int8_t combinedSupport = -1;  // adapter supports I2C_RDWR (-1 = not probed yet)
+
+        int openBus();
+        void releaseBus(bool ok);
+        void closeBus();
+        bool readCombined(int fd, uint8_t regAddr, uint8_t *data, uint16_t length);
 
         uint16_t bswap(uint16_t val);
         void bswap_table(uint8_t length, uint16_t* data);
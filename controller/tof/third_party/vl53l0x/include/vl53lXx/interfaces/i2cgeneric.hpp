@@ -47,6 +47,18 @@ THE SOFTWARE.
 #include <cstdint>
 #include <stdio.h>
 
+// Bus transfers a backend issued since construction and how many of them failed
+struct I2CTransferCounts {
+    uint64_t transfers = 0;
+    uint64_t errors = 0;
+};
+
+// One 8-bit register write, used to submit several writes in a single transfer
+struct I2CRegisterWrite {
+    uint8_t regAddr;
+    uint8_t data;
+};
+
 class I2Cgeneric {
     public:
         I2Cgeneric(uint8_t port, uint8_t address){}
@@ -55,6 +67,9 @@ class I2Cgeneric {
         virtual void setAddress(uint8_t address) = 0;
         virtual uint8_t getAddress() = 0;
 
+        // Keep the underlying bus handle open between transfers (no-op unless the backend has one)
+        virtual void setPersistent(bool persistent) { (void)persistent; }
+
         //8-bits addresses
         virtual int8_t readBit(uint8_t regAddr, uint8_t bitNum, uint8_t *data, uint16_t timeout=0) = 0;
         virtual int8_t readBitW(uint8_t regAddr, uint8_t bitNum, uint16_t *data, uint16_t timeout=0) = 0;
@@ -95,7 +110,31 @@ class I2Cgeneric {
         virtual bool writeBytes(uint16_t regAddr, uint8_t length, uint8_t *data) = 0;
         virtual bool writeWords(uint16_t regAddr, uint8_t length, uint16_t *data) = 0;
 
+        // Ordered list of 8-bit register writes; backends may coalesce them into fewer bus transactions
+        virtual bool writeBatch(const I2CRegisterWrite *writes, uint16_t count) {
+            for (uint16_t i = 0; i < count; i++) {
+                if (!this->writeByte(writes[i].regAddr, writes[i].data)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const I2CTransferCounts& transferCounts() const { return this->transferTotals; }
+
         uint16_t readTimeout;
+
+    protected:
+        // Backends call this once per bus transfer
+        void countTransfer(bool ok) {
+            this->transferTotals.transfers++;
+            if (!ok) {
+                this->transferTotals.errors++;
+            }
+        }
+
+    private:
+        I2CTransferCounts transferTotals;
 };
 
 #endif //_I2CGENERIC_H_
@@ -0,0 +1,101 @@
+#ifndef _I2CMOCK_H_
+#define _I2CMOCK_H_
+
+#include <cstdint>
+
+#include "i2cgeneric.hpp"
+
+/**
+ * In-memory I2Cgeneric backend with a flat 256-byte register file.
+ *
+ * Every call is counted as the bus transfers I2Cdev would issue for it on an adapter with I2C_RDWR:
+ * one per read or write, one per chunk of a batched write, and a read plus a write for the
+ * read-modify-write bit helpers. That makes the counters a stand-in for ioctl() syscalls per operation.
+ * Subclasses can model device behaviour by overriding onRead()/onWrite() and bus timing or faults by
+ * overriding onTransfer().
+ */
+class I2Cmock : public I2Cgeneric {
+    public:
+        // Messages per I2C_RDWR ioctl (I2C_RDWR_IOCTL_MAX_MSGS in linux/i2c-dev.h)
+        static const uint16_t kBatchMessages = 42;
+
+        struct Counters {
+            uint64_t transfers = 0;
+            uint64_t reads = 0;
+            uint64_t writes = 0;
+            uint64_t bytesRead = 0;
+            uint64_t bytesWritten = 0;
+        };
+
+        explicit I2Cmock(uint8_t address = 0x29);
+        ~I2Cmock() override;
+
+        void setAddress(uint8_t address) override;
+        uint8_t getAddress() override;
+
+        //8-bits addresses
+        int8_t readBit(uint8_t regAddr, uint8_t bitNum, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readBitW(uint8_t regAddr, uint8_t bitNum, uint16_t *data, uint16_t timeout=0) override;
+        int8_t readBits(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readBitsW(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint16_t *data, uint16_t timeout=0) override;
+        int8_t readByte(uint8_t regAddr, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readWord(uint8_t regAddr, uint16_t *data, uint16_t timeout=0) override;
+        int8_t readBytes(uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readWords(uint8_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout=0) override;
+
+        //16-bits addresses; only 0x0000-0x00FF exist in the register file
+        int8_t readBit(uint16_t regAddr, uint8_t bitNum, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readBitW(uint16_t regAddr, uint8_t bitNum, uint16_t *data, uint16_t timeout=0) override;
+        int8_t readBits(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readBitsW(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint16_t *data, uint16_t timeout=0) override;
+        int8_t readByte(uint16_t regAddr, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readWord(uint16_t regAddr, uint16_t *data, uint16_t timeout=0) override;
+        int8_t readBytes(uint16_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout=0) override;
+        int8_t readWords(uint16_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout=0) override;
+
+        //8-bits addresses
+        bool writeBit(uint8_t regAddr, uint8_t bitNum, uint8_t data) override;
+        bool writeBitW(uint8_t regAddr, uint8_t bitNum, uint16_t data) override;
+        bool writeBits(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data) override;
+        bool writeBitsW(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint16_t data) override;
+        bool writeByte(uint8_t regAddr, uint8_t data) override;
+        bool writeWord(uint8_t regAddr, uint16_t data) override;
+        bool writeBytes(uint8_t regAddr, uint8_t length, uint8_t *data) override;
+        bool writeWords(uint8_t regAddr, uint8_t length, uint16_t *data) override;
+
+        //16-bits addresses
+        bool writeBit(uint16_t regAddr, uint8_t bitNum, uint8_t data) override;
+        bool writeBitW(uint16_t regAddr, uint8_t bitNum, uint16_t data) override;
+        bool writeBits(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data) override;
+        bool writeBitsW(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint16_t data) override;
+        bool writeByte(uint16_t regAddr, uint8_t data) override;
+        bool writeWord(uint16_t regAddr, uint16_t data) override;
+        bool writeBytes(uint16_t regAddr, uint8_t length, uint8_t *data) override;
+        bool writeWords(uint16_t regAddr, uint8_t length, uint16_t *data) override;
+
+        bool writeBatch(const I2CRegisterWrite *writes, uint16_t count) override;
+
+        const Counters& counters() const { return this->stats; }
+        void resetCounters() { this->stats = Counters(); }
+
+        // Register file, readable and writable directly to seed values without counting transfers
+        uint8_t registers[256] = {};
+
+    protected:
+        // Called once per counted transfer, before any register is touched; return false to fail it.
+        // `bytes` is the payload, excluding register addresses.
+        virtual bool onTransfer(bool isRead, uint16_t bytes);
+        // Register access within a transfer (a batch chunk calls onWrite() once per message); return false
+        // to fail it. The defaults copy from and to the register file.
+        virtual bool onRead(uint8_t regAddr, uint8_t *data, uint8_t length);
+        virtual bool onWrite(uint8_t regAddr, const uint8_t *data, uint8_t length);
+
+    private:
+        uint8_t address;
+        Counters stats;
+
+        bool read(uint16_t regAddr, uint8_t *data, uint8_t length);
+        bool write(uint16_t regAddr, const uint8_t *data, uint8_t length);
+};
+
+#endif //_I2CMOCK_H_
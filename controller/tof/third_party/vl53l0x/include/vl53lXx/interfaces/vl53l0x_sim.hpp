@@ -0,0 +1,81 @@
+#ifndef _VL53L0X_SIM_H_
+#define _VL53L0X_SIM_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "i2cmock.hpp"
+
+/**
+ * One simulated measurement as it lands in the RESULT_RANGE_STATUS block.
+ */
+struct VL53L0XSimSample {
+    uint16_t rangeMillimeters = 500;
+    float signalRateMCPS = 20.0f;
+    float ambientRateMCPS = 0.3f;
+    uint8_t rangeStatus = 11;  // device range status; 11 = range valid
+};
+
+struct VL53L0XSimConfig {
+    uint32_t measurementMicroseconds = 33000;  // time from SYSRANGE_START to a result; 0 = ready on the next access
+    uint32_t transferMicroseconds = 0;  // simulated bus time per transfer
+    uint32_t byteMicroseconds = 0;  // and per payload byte (about 23 us at 400 kHz)
+    double errorRate = 0.0;  // probability that a transfer fails with EIO
+    uint32_t seed = 1;  // for errorRate
+    std::vector<VL53L0XSimSample> trace;  // one entry per measurement, repeated; empty = a fixed 500 mm target
+};
+
+/**
+ * I2Cmock with enough of a VL53L0X behind it for the driver's init(), single-shot, back-to-back and timed
+ * ranging to run unmodified:
+ *
+ * - register pages selected through 0xFF, so the tuning settings and SPAD/NVM sequences land where they
+ *   do on the device;
+ * - SYSRANGE_START starts a measurement that completes after measurementMicroseconds (single-shot and
+ *   calibration) or repeats at the inter-measurement period (timed) or back to back;
+ * - a completed measurement latches the next trace sample into the result block and raises
+ *   RESULT_INTERRUPT_STATUS until SYSTEM_INTERRUPT_CLEAR. Reference calibrations (final range disabled in
+ *   SYSTEM_SEQUENCE_CONFIG) raise the interrupt without consuming a sample and leave a VHV (0xCB) or
+ *   phase (0xEE) result behind.
+ *
+ * Time is the host's steady clock, so the model paces a caller the way the sensor would.
+ */
+class VL53L0Xsim : public I2Cmock {
+    public:
+        explicit VL53L0Xsim(const VL53L0XSimConfig& config = VL53L0XSimConfig(), uint8_t address = 0x29);
+
+        // Measurements completed, including ones overwritten before they were read
+        uint64_t measurements() const { return this->measurementCount; }
+        uint64_t injectedErrors() const { return this->errorCount; }
+        // VHV and phase reference calibrations run so far
+        uint64_t calibrations() const { return this->calibrationCount; }
+
+    protected:
+        bool onTransfer(bool isRead, uint16_t bytes) override;
+        bool onRead(uint8_t regAddr, uint8_t *data, uint8_t length) override;
+        bool onWrite(uint8_t regAddr, const uint8_t *data, uint8_t length) override;
+
+    private:
+        enum class Mode { Idle, Single, BackToBack, Timed };
+
+        static const uint8_t kPages = 8;
+
+        VL53L0XSimConfig config;
+        uint8_t pages[kPages - 1][256] = {};  // pages 1-7; page 0 is I2Cmock::registers
+        uint8_t page = 0;
+        Mode mode = Mode::Idle;
+        uint64_t dueMicroseconds = 0;
+        size_t traceIndex = 0;
+        uint64_t measurementCount = 0;
+        uint64_t calibrationCount = 0;
+        uint64_t errorCount = 0;
+        uint64_t rng;
+
+        uint8_t* bank();
+        void advance();
+        void complete();
+        void startRanging(uint8_t value);
+        uint64_t periodMicroseconds();
+};
+
+#endif //_VL53L0X_SIM_H_
@@ -26,6 +26,13 @@ class VL53L0X : public VL53LXX {
 		 */
 		VL53L0X(uint8_t port, const uint8_t address = VL53L0X_ADDRESS_DEFAULT, const int16_t xshutGPIOPin = -1, bool ioMode2v8 = true, float *calib = DEFAULT_CALIB);
 
+		/**
+		 * \brief Same as above, on a caller-supplied I2C backend (e.g. I2Cmock) instead of /dev/i2c-<port>.
+		 *
+		 * The sensor takes ownership of `bus` and deletes it on destruction.
+		 */
+		VL53L0X(I2Cgeneric *bus, const int16_t xshutGPIOPin = -1, bool ioMode2v8 = true, float *calib = DEFAULT_CALIB);
+
 		/*** Public methods ***/
 		/**
 		 * \brief Initialize the sensor's hardware and, if needed, GPIO access on the host side.
@@ -33,6 +40,19 @@ class VL53L0X : public VL53LXX {
 		 * It's not part of the constructor as it can throw errors.
 		 */
 		bool init();
+		/**
+		 * \brief Same as init(), but restores a calibration saved with getCalibration() instead of computing the
+		 * reference SPAD map and running the VHV and phase calibration measurements.
+		 *
+		 * Returns false when the module's NVM SPAD info does not match `calibration` or the restored values do
+		 * not read back; init() then has to run the full calibration. Can throw errors like init().
+		 */
+		bool init(const VL53L0XCalibration& calibration);
+		/**
+		 * Calibration in effect since the last successful init(), for init(calibration) on a later start; false
+		 * before that. Reads the VHV and phase results from the sensor, so it can throw errors.
+		 */
+		bool getCalibration(VL53L0XCalibration* calibration);
 		
 		/**
 		 * Change sensor's I2C address (sets both the address on the physical sensor and within sensor's object).
@@ -99,18 +119,33 @@ class VL53L0X : public VL53LXX {
 		void stopContinuous();
 		/**
 		 * Returns a range reading in millimeters when continuous mode is active.
-		 * Warning: Blocking call!
+		 * Warning: Blocking call unless blocking is false!
 		 *
+		 * With blocking set to false the interrupt status is checked once and VL53L0X_RANGE_NOT_READY is returned
+		 * if no measurement has completed yet.
 		 * readRangeSingleMillimeters() also calls this function after starting a single-shot range measurement.
 		 */
 		uint16_t readRangeContinuousMillimeters(bool blocking = true);
 		/**
 		 * Performs a single-shot range measurement and returns the reading in millimeters.
-		 * Warning: Blocking call!
+		 * Warning: Blocking call unless blocking is false!
 		 *
+		 * With blocking set to false the measurement is only started and VL53L0X_RANGE_NOT_READY is returned;
+		 * collect the result later with readRangeContinuousMillimeters().
 		 * Based on VL53L0X_PerformSingleRangingMeasurement().
 		 */
 		uint16_t readRangeSingleMillimeters(bool blocking = true);
+		/**
+		 * Reads a completed measurement with its quality fields and clears the interrupt.
+		 * Works after readRangeSingleMillimeters(false) or in continuous mode.
+		 *
+		 * The interrupt status register directly precedes the result block, so when a measurement is already
+		 * waiting this costs a single burst read plus the interrupt clear. With blocking set to false nothing else
+		 * happens and false is returned if no measurement has completed yet; otherwise the interrupt status is polled
+		 * like readRangeContinuousMillimeters() does and false means a timeout (see timeoutOccurred()).
+		 * Based on VL53L0X_GetRangingMeasurementData().
+		 */
+		bool readRangingData(VL53L0XRangingData *data, bool blocking = true);
 		/**
 		 * Set value of timeout for measurements.
 		 * 0 (dafault value) means no time limit for measurements (infinite wait).
@@ -137,10 +172,17 @@ class VL53L0X : public VL53LXX {
 		bool didTimeout;
 		// read by init and used when starting measurement; is StopVariable field of VL53L0X_DevData_t structure in API
 		uint8_t stopVariable;
+		// filled in by initHardware(), returned by getCalibration()
+		VL53L0XCalibration calibration;
+		bool calibrationValid;
 
 		/*** Private methods ***/
 
-		void initHardware();
+		/**
+		 * Full init sequence; with `restore`, the reference SPADs and calibrations come from it instead of the
+		 * device. Returns false if `restore` does not apply to this module.
+		 */
+		bool initHardware(const VL53L0XCalibration* restore = nullptr);
 		/**
 		 * Get reference SPAD (single photon avalanche diode) count and type.
 		 *
@@ -189,6 +231,14 @@ class VL53L0X : public VL53LXX {
 		 * Based on VL53L0X_perform_single_ref_calibration().
 		 */
 		bool performSingleRefCalibration(uint8_t vhvInitByte);
+		/**
+		 * Read and write the VHV and phase calibration results; setRefCalibration() returns false if they do not
+		 * read back.
+		 *
+		 * Based on VL53L0X_ref_calibration_io().
+		 */
+		void getRefCalibration(uint8_t* vhvSettings, uint8_t* phaseCal);
+		bool setRefCalibration(uint8_t vhvSettings, uint8_t phaseCal);
 
 		/*** I2C wrapper methods ***/
 
@@ -206,6 +256,10 @@ class VL53L0X : public VL53LXX {
 		 * Based on VL53L0X_write_dword from VL53L0X kernel driver.
 		 */
 		void writeRegister32Bit(uint8_t register, uint32_t value);
+		/**
+		 * Write a sequence of 8-bit registers in order, letting the I2C backend coalesce them into as few transactions as it can.
+		 */
+		void writeRegisterBatch(const I2CRegisterWrite* writes, uint16_t count);
 		/**
 		 * Write an arbitrary number of bytes from the given array to the sensor, starting at the given register.
 		 */
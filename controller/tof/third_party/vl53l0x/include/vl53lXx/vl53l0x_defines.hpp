@@ -6,6 +6,9 @@
 //#define VL53L0X_ADDRESS_DEFAULT 0b0101001
 #define VL53L0X_ADDRESS_DEFAULT 0x29
 
+// Returned by non-blocking reads when no measurement is available yet (same value as the timeout result)
+#define VL53L0X_RANGE_NOT_READY 0xFFFF
+
 /**
  * Register addresses from API vl53l0x_device.h (ordered as listed there)
  */
@@ -122,4 +125,38 @@ struct VL53L0XSequenceStepTimeouts {
 	uint32_t finalRangeMicroseconds;
 };
 
+// Bytes in the result block starting at RESULT_RANGE_STATUS, as read by the API's GetRangingMeasurementData()
+#define VL53L0X_RESULT_BLOCK_SIZE 12
+
+// Device range status (bits 6:3 of RESULT_RANGE_STATUS) of a valid measurement
+#define VL53L0X_RANGE_STATUS_VALID 11
+
+/**
+ * Decoded result block; see readRangingData().
+ */
+struct VL53L0XRangingData {
+	uint16_t rangeMillimeters;
+	// Device range status; VL53L0X_RANGE_STATUS_VALID unless the measurement failed a check (sigma, signal, phase, ...)
+	uint8_t rangeStatus;
+	// Return signal and ambient rates in MCPS (mega counts per second), decoded from Q9.7
+	float signalRateMCPS;
+	float ambientRateMCPS;
+	// Effective number of return SPADs, decoded from Q8.8
+	float effectiveSpadCount;
+};
+
+/**
+ * Per-module results of the reference SPAD setup and reference calibrations run by init(); see getCalibration().
+ */
+struct VL53L0XCalibration {
+	// Reference SPAD count and type from NVM; these identify the module a saved calibration belongs to
+	uint8_t spadCount;
+	bool spadTypeIsAperture;
+	// Enabled reference SPADs, GLOBAL_CONFIG_SPAD_ENABLES_REF_0 through _5
+	uint8_t refSpadMap[6];
+	// VHV and phase calibration results, as in VL53L0X_GetRefCalibration()
+	uint8_t vhvSettings;
+	uint8_t phaseCal;
+};
+
 #endif
@@ -18,6 +18,8 @@ class VL53LXX
 {
   public:
     VL53LXX(uint8_t port, const uint8_t address, const int16_t xshutGPIOPin = -1, bool ioMode2v8 = true, float *calib = DEFAULT_CALIB);
+    // Takes ownership of `bus`
+    VL53LXX(I2Cgeneric *bus, const int16_t xshutGPIOPin = -1, bool ioMode2v8 = true, float *calib = DEFAULT_CALIB);
 
     ~VL53LXX();
 
@@ -26,6 +28,11 @@ class VL53LXX
     virtual void setAddress(uint8_t new_addr) = 0;
     uint8_t getAddress() { return this->i2c->getAddress(); }
 
+    // Keep the I2C bus open across register accesses instead of reopening per transfer
+    void setPersistentBus(bool enabled) { this->i2c->setPersistent(enabled); }
+    // Transfers on this sensor's bus backend and how many failed
+    const I2CTransferCounts& busCounts() const { return this->i2c->transferCounts(); }
+
     virtual uint16_t readRangeSingleMillimeters(bool blocking = true) = 0;
     virtual uint16_t readRangeContinuousMillimeters(bool blocking = true) = 0;
 
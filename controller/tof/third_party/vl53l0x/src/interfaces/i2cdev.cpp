@@ -67,9 +67,12 @@ I2Cdev::I2Cdev(uint8_t port, uint8_t address):
 /** Default destructor.
  */
 
-I2Cdev::~I2Cdev(){}
+I2Cdev::~I2Cdev(){
+    this->closeBus();
+}
 
 /** Set device I2C address.
+ * In persistent mode the new address is selected lazily on the next transfer.
  * @param address Device address
  */
 void I2Cdev::setAddress(uint8_t address){
@@ -83,6 +86,107 @@ uint8_t I2Cdev::getAddress(){
     return this->address;
 }
 
+/** Keep the bus file descriptor open between transfers.
+ * When enabled the bus is opened once and I2C_SLAVE is only reissued when the
+ * device address changes; any failed transfer drops the descriptor so the next
+ * call starts from a fresh open(). When disabled every transfer opens and
+ * closes the bus, as the original implementation did.
+ * @param persistent New mode
+ */
+void I2Cdev::setPersistent(bool persistent){
+    this->persistent = persistent;
+    if (!persistent) {
+        this->closeBus();
+    }
+}
+
+/** Open the bus (or reuse the cached descriptor) with the device selected.
+ * @return File descriptor, or -1 on failure
+ */
+int I2Cdev::openBus() {
+    if (this->fd < 0) {
+        this->fd = open(this->i2c_path, O_RDWR);
+        if (this->fd < 0) {
+            fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
+            this->countTransfer(false);
+            return(-1);
+        }
+        this->selectedAddress = -1;
+        if (this->combinedSupport < 0) {
+            unsigned long funcs = 0;
+            this->combinedSupport = (ioctl(this->fd, I2C_FUNCS, &funcs) == 0 && (funcs & I2C_FUNC_I2C)) ? 1 : 0;
+        }
+    }
+    if (this->selectedAddress != this->address) {
+        if (ioctl(this->fd, I2C_SLAVE, this->address) < 0) {
+            fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
+            this->releaseBus(false);
+            return(-1);
+        }
+        this->selectedAddress = this->address;
+    }
+    return this->fd;
+}
+
+/** Finish a transfer started with openBus() and count it.
+ * The descriptor is closed unless persistent mode is on and the transfer
+ * succeeded. errno is preserved so callers can still report the failure.
+ * @param ok Whether the transfer succeeded
+ */
+void I2Cdev::releaseBus(bool ok) {
+    this->countTransfer(ok);
+    if (!this->persistent || !ok) {
+        this->closeBus();
+    }
+}
+
+/** Close the cached descriptor, if any, preserving errno.
+ */
+void I2Cdev::closeBus() {
+    if (this->fd < 0) {
+        return;
+    }
+    int savedErrno = errno;
+    close(this->fd);
+    errno = savedErrno;
+    this->fd = -1;
+    this->selectedAddress = -1;
+}
+
+/** Read from an 8-bit register with a single repeated-start I2C_RDWR transfer.
+ * @param fd Bus file descriptor from openBus()
+ * @param regAddr First register regAddr to read from
+ * @param data Buffer to store read data in
+ * @param length Number of bytes to read
+ * @return Status of read operation (true = success)
+ */
+bool I2Cdev::readCombined(int fd, uint8_t regAddr, uint8_t *data, uint16_t length) {
+    struct i2c_rdwr_ioctl_data msgset;
+    struct i2c_msg msgs[2] = {
+        {
+            .addr = this->address,
+            .flags = 0,
+            .len = 1,
+            .buf = &regAddr,
+        },
+        {
+            .addr = this->address,
+            .flags = I2C_M_RD,
+            .len = length,
+            .buf = data,
+        },
+    };
+
+    msgset.msgs = msgs;
+    msgset.nmsgs = 2;
+
+    if (ioctl(fd, I2C_RDWR, &msgset) < 0) {
+        fprintf(stderr, "Failed to read device: %s\n", strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
 /** Read a single bit from an 8-bit device register.
  * @param regAddr Register regAddr to read from
  * @param bitNum Bit position to read (0-7)
@@ -189,33 +293,36 @@ int8_t I2Cdev::readWord(uint8_t regAddr, uint16_t *data, uint16_t timeout) {
  */
 int8_t I2Cdev::readBytes(uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
     int8_t count = 0;
-    int fd = open(this->i2c_path, O_RDWR);
+    int fd = this->openBus();
 
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
         return(-1);
     }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return(-1);
+    if (this->combinedSupport > 0) {
+        if (!this->readCombined(fd, regAddr, data, length)) {
+            this->releaseBus(false);
+            return(-1);
+        }
+        this->releaseBus(true);
+        (void)timeout;
+        return length;
     }
     if (write(fd, &regAddr, 1) != 1) {
         fprintf(stderr, "Failed to write reg: %s\n", strerror(errno));
-        close(fd);
+        this->releaseBus(false);
         return(-1);
     }
     count = read(fd, data, length);
     if (count < 0) {
         fprintf(stderr, "Failed to read device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
+        this->releaseBus(false);
         return(-1);
     } else if (count != length) {
         fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
-        close(fd);
+        this->releaseBus(false);
         return(-1);
     }
-    close(fd);
+    this->releaseBus(true);
 
     // Suppress compiler warning
     (void)timeout;
@@ -243,33 +350,36 @@ int8_t I2Cdev::readWords(uint8_t regAddr, uint8_t length, uint16_t *data, uint16
 
     return count;*/
     int8_t count = 0;
-    int fd = open(this->i2c_path, O_RDWR);
+    int fd = this->openBus();
 
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
         return(-1);
     }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
-        return(-1);
+    if (this->combinedSupport > 0) {
+        if (!this->readCombined(fd, regAddr, (uint8_t*)data, length*2)) {
+            this->releaseBus(false);
+            return(-1);
+        }
+        this->releaseBus(true);
+        (void)timeout;
+        return length*2;
     }
     if (write(fd, &regAddr, 1) != 1) {
         fprintf(stderr, "Failed to write reg: %s\n", strerror(errno));
-        close(fd);
+        this->releaseBus(false);
         return(-1);
     }
     count = read(fd, data, length*2);
     if (count < 0) {
         fprintf(stderr, "Failed to read device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
+        this->releaseBus(false);
         return(-1);
     } else if (count/2 != length) {
         fprintf(stderr, "Short read  from device, expected %d, got %d\n", length, count);
-        close(fd);
+        this->releaseBus(false);
         return(-1);
     }
-    close(fd);
+    this->releaseBus(true);
 
     // Suppress compiler warning
     (void)timeout;
@@ -393,14 +503,8 @@ bool I2Cdev::writeBytes(uint8_t regAddr, uint8_t length, uint8_t* data) {
         return(FALSE);
     }
 
-    fd = open(this->i2c_path, O_RDWR);
+    fd = this->openBus();
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(FALSE);
-    }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
         return(FALSE);
     }
     buf[0] = regAddr;
@@ -408,14 +512,14 @@ bool I2Cdev::writeBytes(uint8_t regAddr, uint8_t length, uint8_t* data) {
     count = write(fd, buf, length+1);
     if (count < 0) {
         fprintf(stderr, "Failed to write device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
+        this->releaseBus(false);
         return(FALSE);
     } else if (count != length+1) {
         fprintf(stderr, "Short write to device, expected %d, got %d\n", length+1, count);
-        close(fd);
+        this->releaseBus(false);
         return(FALSE);
     }
-    close(fd);
+    this->releaseBus(true);
 
     return TRUE;
 }
@@ -439,14 +543,8 @@ bool I2Cdev::writeWords(uint8_t regAddr, uint8_t length, uint16_t* data) {
         return(FALSE);
     }
 
-    fd = open(this->i2c_path, O_RDWR);
+    fd = this->openBus();
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(FALSE);
-    }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
         return(FALSE);
     }
     buf[0] = regAddr;
@@ -457,14 +555,62 @@ bool I2Cdev::writeWords(uint8_t regAddr, uint8_t length, uint16_t* data) {
     count = write(fd, buf, length*2+1);
     if (count < 0) {
         fprintf(stderr, "Failed to write device(%d): %s\n", count, ::strerror(errno));
-        close(fd);
+        this->releaseBus(false);
         return(FALSE);
     } else if (count != length*2+1) {
         fprintf(stderr, "Short write to device, expected %d, got %d\n", length+1, count);
-        close(fd);
+        this->releaseBus(false);
         return(FALSE);
     }
-    close(fd);
+    this->releaseBus(true);
+    return TRUE;
+}
+
+/** Write a list of 8-bit registers in order.
+ * Each write becomes one message of an I2C_RDWR transfer, so a whole table
+ * goes out in a handful of ioctls; adapters without I2C_RDWR fall back to
+ * one writeByte() per entry.
+ * @param writes Register/value pairs, applied in order
+ * @param count Number of entries in writes
+ * @return Status of operation (true = success)
+ */
+bool I2Cdev::writeBatch(const I2CRegisterWrite *writes, uint16_t count) {
+    uint8_t bufs[I2C_RDWR_IOCTL_MAX_MSGS][2];
+    struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+    struct i2c_rdwr_ioctl_data msgset;
+
+    int fd = this->openBus();
+    if (fd < 0) {
+        return(FALSE);
+    }
+    if (this->combinedSupport <= 0) {
+        // Not a transfer of its own: the writeByte() calls count theirs
+        if (!this->persistent) {
+            this->closeBus();
+        }
+        return I2Cgeneric::writeBatch(writes, count);
+    }
+
+    for (uint16_t done = 0; done < count;) {
+        uint16_t chunk = MIN(count - done, I2C_RDWR_IOCTL_MAX_MSGS);
+        for (uint16_t i = 0; i < chunk; i++) {
+            bufs[i][0] = writes[done + i].regAddr;
+            bufs[i][1] = writes[done + i].data;
+            msgs[i].addr = this->address;
+            msgs[i].flags = 0;
+            msgs[i].len = 2;
+            msgs[i].buf = bufs[i];
+        }
+        msgset.msgs = msgs;
+        msgset.nmsgs = chunk;
+        if (ioctl(fd, I2C_RDWR, &msgset) < 0) {
+            fprintf(stderr, "Failed to write batch to device: %s\n", strerror(errno));
+            this->releaseBus(false);
+            return(FALSE);
+        }
+        done += chunk;
+    }
+    this->releaseBus(true);
     return TRUE;
 }
 
@@ -477,15 +623,9 @@ bool I2Cdev::writeWords(uint8_t regAddr, uint8_t length, uint16_t* data) {
  */
 int8_t I2Cdev::readBytes(uint16_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout){
     int8_t count = 0;
-    int fd = open(this->i2c_path, O_RDWR);
+    int fd = this->openBus();
 
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(-1);
-    }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
         return(-1);
     }
 
@@ -511,7 +651,7 @@ int8_t I2Cdev::readBytes(uint16_t regAddr, uint8_t length, uint8_t *data, uint16
     msgset.nmsgs = 2;
 
     err = ioctl(fd, I2C_RDWR, &msgset);
-    close(fd);
+    this->releaseBus(err >= 0);
 
     // Suppress compiler warning
     (void)timeout;
@@ -528,15 +668,9 @@ int8_t I2Cdev::readBytes(uint16_t regAddr, uint8_t length, uint8_t *data, uint16
  */
 int8_t I2Cdev::readWords(uint16_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout) {
     int8_t count = 0;
-    int fd = open(this->i2c_path, O_RDWR);
+    int fd = this->openBus();
 
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(-1);
-    }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
         return(-1);
     }
 
@@ -562,7 +696,7 @@ int8_t I2Cdev::readWords(uint16_t regAddr, uint8_t length, uint16_t *data, uint1
     msgset.nmsgs = 2;
 
     err = ioctl(fd, I2C_RDWR, &msgset);
-    close(fd);
+    this->releaseBus(err >= 0);
 
     //Convert big to little endian if needed
     bswap_table(length, data);
@@ -685,15 +819,9 @@ bool I2Cdev::writeBytes(uint16_t regAddr, uint8_t length, uint8_t* data) {
         return(FALSE);
     }
 
-    int fd = open(this->i2c_path, O_RDWR);
+    int fd = this->openBus();
 
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(-1);
-    }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
         return(-1);
     }
 
@@ -718,7 +846,7 @@ bool I2Cdev::writeBytes(uint16_t regAddr, uint8_t length, uint8_t* data) {
     msgset.nmsgs = 1;
 
     err = ioctl(fd, I2C_RDWR, &msgset);
-    close(fd);
+    this->releaseBus(err >= 0);
 
     return err >= 0;
 }
@@ -738,15 +866,9 @@ bool I2Cdev::writeWords(uint16_t regAddr, uint8_t length, uint16_t* data) {
         return(FALSE);
     }
 
-    int fd = open(this->i2c_path, O_RDWR);
+    int fd = this->openBus();
 
     if (fd < 0) {
-        fprintf(stderr, "Failed to open device: %s\n", strerror(errno));
-        return(-1);
-    }
-    if (ioctl(fd, I2C_SLAVE, this->address) < 0) {
-        fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
-        close(fd);
         return(-1);
     }
 
@@ -776,7 +898,7 @@ bool I2Cdev::writeWords(uint16_t regAddr, uint8_t length, uint16_t* data) {
     msgset.nmsgs = 1;
 
     err = ioctl(fd, I2C_RDWR, &msgset);
-    close(fd);
+    this->releaseBus(err >= 0);
 
     return TRUE;
 }
@@ -0,0 +1,278 @@
+#include <vl53lXx/interfaces/i2cmock.hpp>
+
+#include <cstring>
+
+I2Cmock::I2Cmock(uint8_t address):
+    I2Cgeneric(0, address),
+    address(address)
+{
+}
+
+I2Cmock::~I2Cmock() = default;
+
+void I2Cmock::setAddress(uint8_t address) {
+    this->address = address;
+}
+
+uint8_t I2Cmock::getAddress() {
+    return this->address;
+}
+
+/** One counted read transfer; registers past 0xFF do not exist and fail like a NACK.
+ */
+bool I2Cmock::read(uint16_t regAddr, uint8_t *data, uint8_t length) {
+    this->stats.transfers++;
+    this->stats.reads++;
+    bool ok = regAddr + length <= sizeof(this->registers) && this->onTransfer(true, length) &&
+              this->onRead(static_cast<uint8_t>(regAddr), data, length);
+    this->countTransfer(ok);
+    if (!ok) {
+        return false;
+    }
+    this->stats.bytesRead += length;
+    return true;
+}
+
+/** One counted write transfer.
+ */
+bool I2Cmock::write(uint16_t regAddr, const uint8_t *data, uint8_t length) {
+    this->stats.transfers++;
+    this->stats.writes++;
+    bool ok = regAddr + length <= sizeof(this->registers) && this->onTransfer(false, length) &&
+              this->onWrite(static_cast<uint8_t>(regAddr), data, length);
+    this->countTransfer(ok);
+    if (!ok) {
+        return false;
+    }
+    this->stats.bytesWritten += length;
+    return true;
+}
+
+bool I2Cmock::onTransfer(bool isRead, uint16_t bytes) {
+    (void)isRead;
+    (void)bytes;
+    return true;
+}
+
+bool I2Cmock::onRead(uint8_t regAddr, uint8_t *data, uint8_t length) {
+    std::memcpy(data, this->registers + regAddr, length);
+    return true;
+}
+
+bool I2Cmock::onWrite(uint8_t regAddr, const uint8_t *data, uint8_t length) {
+    std::memcpy(this->registers + regAddr, data, length);
+    return true;
+}
+
+int8_t I2Cmock::readBit(uint8_t regAddr, uint8_t bitNum, uint8_t *data, uint16_t timeout) {
+    return this->readBit(static_cast<uint16_t>(regAddr), bitNum, data, timeout);
+}
+
+int8_t I2Cmock::readBitW(uint8_t regAddr, uint8_t bitNum, uint16_t *data, uint16_t timeout) {
+    return this->readBitW(static_cast<uint16_t>(regAddr), bitNum, data, timeout);
+}
+
+int8_t I2Cmock::readBits(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t *data, uint16_t timeout) {
+    return this->readBits(static_cast<uint16_t>(regAddr), bitStart, length, data, timeout);
+}
+
+int8_t I2Cmock::readBitsW(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint16_t *data, uint16_t timeout) {
+    return this->readBitsW(static_cast<uint16_t>(regAddr), bitStart, length, data, timeout);
+}
+
+int8_t I2Cmock::readByte(uint8_t regAddr, uint8_t *data, uint16_t timeout) {
+    return this->readBytes(static_cast<uint16_t>(regAddr), 1, data, timeout);
+}
+
+int8_t I2Cmock::readWord(uint8_t regAddr, uint16_t *data, uint16_t timeout) {
+    return this->readWords(static_cast<uint16_t>(regAddr), 1, data, timeout);
+}
+
+int8_t I2Cmock::readBytes(uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
+    return this->readBytes(static_cast<uint16_t>(regAddr), length, data, timeout);
+}
+
+int8_t I2Cmock::readWords(uint8_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout) {
+    return this->readWords(static_cast<uint16_t>(regAddr), length, data, timeout);
+}
+
+int8_t I2Cmock::readBit(uint16_t regAddr, uint8_t bitNum, uint8_t *data, uint16_t timeout) {
+    uint8_t b = 0;
+    int8_t count = this->readByte(regAddr, &b, timeout);
+    *data = b & (1 << bitNum);
+    return count;
+}
+
+int8_t I2Cmock::readBitW(uint16_t regAddr, uint8_t bitNum, uint16_t *data, uint16_t timeout) {
+    uint16_t w = 0;
+    int8_t count = this->readWord(regAddr, &w, timeout);
+    *data = w & (1 << bitNum);
+    return count;
+}
+
+int8_t I2Cmock::readBits(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint8_t *data, uint16_t timeout) {
+    uint8_t b;
+    int8_t count = this->readByte(regAddr, &b, timeout);
+    if (count > 0) {
+        uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
+        *data = (b & mask) >> (bitStart - length + 1);
+    }
+    return count;
+}
+
+int8_t I2Cmock::readBitsW(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint16_t *data, uint16_t timeout) {
+    uint16_t w;
+    int8_t count = this->readWord(regAddr, &w, timeout);
+    if (count > 0) {
+        uint16_t mask = ((1 << length) - 1) << (bitStart - length + 1);
+        *data = (w & mask) >> (bitStart - length + 1);
+    }
+    return count;
+}
+
+int8_t I2Cmock::readByte(uint16_t regAddr, uint8_t *data, uint16_t timeout) {
+    return this->readBytes(regAddr, 1, data, timeout);
+}
+
+int8_t I2Cmock::readWord(uint16_t regAddr, uint16_t *data, uint16_t timeout) {
+    return this->readWords(regAddr, 1, data, timeout);
+}
+
+int8_t I2Cmock::readBytes(uint16_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
+    (void)timeout;
+    if (!this->read(regAddr, data, length)) {
+        return -1;
+    }
+    return static_cast<int8_t>(length);
+}
+
+int8_t I2Cmock::readWords(uint16_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout) {
+    (void)timeout;
+    uint8_t buf[sizeof(this->registers)];
+    if (length > sizeof(buf) / 2 || !this->read(regAddr, buf, length * 2)) {
+        return -1;
+    }
+    // MSB first, as on the wire
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = static_cast<uint16_t>((buf[i * 2] << 8) | buf[i * 2 + 1]);
+    }
+    return static_cast<int8_t>(length);
+}
+
+bool I2Cmock::writeBit(uint8_t regAddr, uint8_t bitNum, uint8_t data) {
+    return this->writeBit(static_cast<uint16_t>(regAddr), bitNum, data);
+}
+
+bool I2Cmock::writeBitW(uint8_t regAddr, uint8_t bitNum, uint16_t data) {
+    return this->writeBitW(static_cast<uint16_t>(regAddr), bitNum, data);
+}
+
+bool I2Cmock::writeBits(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data) {
+    return this->writeBits(static_cast<uint16_t>(regAddr), bitStart, length, data);
+}
+
+bool I2Cmock::writeBitsW(uint8_t regAddr, uint8_t bitStart, uint8_t length, uint16_t data) {
+    return this->writeBitsW(static_cast<uint16_t>(regAddr), bitStart, length, data);
+}
+
+bool I2Cmock::writeByte(uint8_t regAddr, uint8_t data) {
+    return this->writeByte(static_cast<uint16_t>(regAddr), data);
+}
+
+bool I2Cmock::writeWord(uint8_t regAddr, uint16_t data) {
+    return this->writeWord(static_cast<uint16_t>(regAddr), data);
+}
+
+bool I2Cmock::writeBytes(uint8_t regAddr, uint8_t length, uint8_t *data) {
+    return this->writeBytes(static_cast<uint16_t>(regAddr), length, data);
+}
+
+bool I2Cmock::writeWords(uint8_t regAddr, uint8_t length, uint16_t *data) {
+    return this->writeWords(static_cast<uint16_t>(regAddr), length, data);
+}
+
+bool I2Cmock::writeBit(uint16_t regAddr, uint8_t bitNum, uint8_t data) {
+    uint8_t b;
+    if (this->readByte(regAddr, &b) <= 0) {
+        return false;
+    }
+    b = (data != 0) ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
+    return this->writeByte(regAddr, b);
+}
+
+bool I2Cmock::writeBitW(uint16_t regAddr, uint8_t bitNum, uint16_t data) {
+    uint16_t w;
+    if (this->readWord(regAddr, &w) <= 0) {
+        return false;
+    }
+    w = (data != 0) ? (w | (1 << bitNum)) : (w & ~(1 << bitNum));
+    return this->writeWord(regAddr, w);
+}
+
+bool I2Cmock::writeBits(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data) {
+    uint8_t b;
+    if (this->readByte(regAddr, &b) <= 0) {
+        return false;
+    }
+    uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
+    b = (b & ~mask) | ((data << (bitStart - length + 1)) & mask);
+    return this->writeByte(regAddr, b);
+}
+
+bool I2Cmock::writeBitsW(uint16_t regAddr, uint8_t bitStart, uint8_t length, uint16_t data) {
+    uint16_t w;
+    if (this->readWord(regAddr, &w) <= 0) {
+        return false;
+    }
+    uint16_t mask = ((1 << length) - 1) << (bitStart - length + 1);
+    w = (w & ~mask) | ((data << (bitStart - length + 1)) & mask);
+    return this->writeWord(regAddr, w);
+}
+
+bool I2Cmock::writeByte(uint16_t regAddr, uint8_t data) {
+    return this->write(regAddr, &data, 1);
+}
+
+bool I2Cmock::writeWord(uint16_t regAddr, uint16_t data) {
+    return this->writeWords(regAddr, 1, &data);
+}
+
+bool I2Cmock::writeBytes(uint16_t regAddr, uint8_t length, uint8_t *data) {
+    return this->write(regAddr, data, length);
+}
+
+bool I2Cmock::writeWords(uint16_t regAddr, uint8_t length, uint16_t *data) {
+    uint8_t buf[sizeof(this->registers)];
+    if (length > sizeof(buf) / 2) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        buf[i * 2] = static_cast<uint8_t>(data[i] >> 8);
+        buf[i * 2 + 1] = static_cast<uint8_t>(data[i]);
+    }
+    return this->write(regAddr, buf, length * 2);
+}
+
+/** Batched single-byte writes, counted as one transfer per I2C_RDWR chunk like I2Cdev. Writes are
+ * applied in order; a failed write stops the batch.
+ */
+bool I2Cmock::writeBatch(const I2CRegisterWrite *writes, uint16_t count) {
+    for (uint16_t done = 0; done < count; done += kBatchMessages) {
+        this->stats.transfers++;
+        uint16_t end = (count - done < kBatchMessages) ? count : done + kBatchMessages;
+        if (!this->onTransfer(false, end - done)) {
+            this->countTransfer(false);
+            return false;
+        }
+        for (uint16_t i = done; i < end; i++) {
+            this->stats.writes++;
+            if (!this->onWrite(writes[i].regAddr, &writes[i].data, 1)) {
+                this->countTransfer(false);
+                return false;
+            }
+            this->stats.bytesWritten++;
+        }
+        this->countTransfer(true);
+    }
+    return true;
+}
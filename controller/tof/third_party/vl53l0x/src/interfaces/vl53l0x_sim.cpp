@@ -0,0 +1,213 @@
+#include <vl53lXx/interfaces/vl53l0x_sim.hpp>
+#include <vl53lXx/vl53l0x_defines.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+// Power-on values the driver reads before it has written them itself
+const uint8_t kModelId = 0xEE;
+const uint8_t kStopVariable = 0x11;  // page 1, register 0x91
+const uint8_t kSpadInfo = 0x85;  // page 7, register 0x92: 5 aperture SPADs
+const uint16_t kOscCalibrate = 1000;  // timer ticks per millisecond in SYSTEM_INTERMEASUREMENT_PERIOD
+// What the reference calibrations leave in 0xCB (VHV) and 0xEE (phase)
+const uint8_t kVhvSettings = 0x1B;
+const uint8_t kPhaseCal = 0x05;
+
+// Result block layout, relative to RESULT_RANGE_STATUS (as decoded by the API's GetRangingMeasurementData())
+const uint8_t kResultSpadCount = 2;  // 8.8
+const uint8_t kResultSignalRate = 6;  // 9.7 MCPS
+const uint8_t kResultAmbientRate = 8;  // 9.7 MCPS
+const uint8_t kResultRange = 10;
+
+uint64_t nowMicroseconds() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Busy-waits for short delays; sleep_for() alone overshoots them by tens of microseconds.
+void waitMicroseconds(uint64_t us) {
+    if (us == 0) {
+        return;
+    }
+    uint64_t deadline = nowMicroseconds() + us;
+    if (us > 200) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us - 100));
+    }
+    while (nowMicroseconds() < deadline) {
+    }
+}
+
+void putBigEndian16(uint8_t *out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+// splitmix64, so that small seeds do not start xorshift on tiny values
+uint64_t mixSeed(uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+uint16_t toFixed97(float mcps) {
+    float scaled = mcps * (1 << 7);
+    return (scaled <= 0.0f) ? 0 : (scaled >= 65535.0f) ? 65535 : static_cast<uint16_t>(scaled);
+}
+
+}  // namespace
+
+VL53L0Xsim::VL53L0Xsim(const VL53L0XSimConfig& config, uint8_t address):
+    I2Cmock(address),
+    config(config),
+    rng(mixSeed(config.seed))
+{
+    if (this->config.trace.empty()) {
+        this->config.trace.push_back(VL53L0XSimSample());
+    }
+    this->registers[IDENTIFICATION_MODEL_ID] = kModelId;
+    this->registers[I2C_SLAVE_DEVICE_ADDRESS] = address;
+    putBigEndian16(this->registers + OSC_CALIBRATE_VAL, kOscCalibrate);
+    this->pages[1 - 1][0x91] = kStopVariable;
+    this->pages[7 - 1][0x92] = kSpadInfo;
+    // Good reference SPAD map (RefGoodSpadMap): all 48, init() keeps the first kSpadInfo-many it needs
+    std::memset(this->registers + GLOBAL_CONFIG_SPAD_ENABLES_REF_0, 0xFF, 6);
+}
+
+uint8_t* VL53L0Xsim::bank() {
+    uint8_t index = this->page % kPages;
+    return (index == 0) ? this->registers : this->pages[index - 1];
+}
+
+bool VL53L0Xsim::onTransfer(bool isRead, uint16_t bytes) {
+    (void)isRead;
+    waitMicroseconds(this->config.transferMicroseconds + static_cast<uint64_t>(this->config.byteMicroseconds) * bytes);
+    if (this->config.errorRate > 0.0) {
+        // xorshift64
+        this->rng ^= this->rng << 13;
+        this->rng ^= this->rng >> 7;
+        this->rng ^= this->rng << 17;
+        if (static_cast<double>(this->rng >> 11) * (1.0 / 9007199254740992.0) < this->config.errorRate) {
+            this->errorCount++;
+            errno = EIO;
+            return false;
+        }
+    }
+    this->advance();
+    return true;
+}
+
+bool VL53L0Xsim::onRead(uint8_t regAddr, uint8_t *data, uint8_t length) {
+    std::memcpy(data, this->bank() + regAddr, length);
+    return true;
+}
+
+bool VL53L0Xsim::onWrite(uint8_t regAddr, const uint8_t *data, uint8_t length) {
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t reg = static_cast<uint8_t>(regAddr + i);
+        uint8_t value = data[i];
+        if (reg == 0xFF) {
+            // Page select, visible from every page
+            this->page = value;
+            continue;
+        }
+        this->bank()[reg] = value;
+        if (this->page == 0x07 && reg == 0x83 && value == 0x00) {
+            // NVM read requested by getSPADInfo(); the device sets 0x83 again once the data is in 0x92
+            this->bank()[reg] = 0x10;
+        } else if (this->page == 0 && reg == SYSTEM_INTERRUPT_CLEAR && (value & 0x01)) {
+            this->registers[RESULT_INTERRUPT_STATUS] = 0x00;
+        } else if (this->page == 0 && reg == SYSRANGE_START) {
+            this->startRanging(value);
+        }
+    }
+    return true;
+}
+
+void VL53L0Xsim::startRanging(uint8_t value) {
+    uint64_t now = nowMicroseconds();
+    if (value & 0x02) {
+        this->mode = Mode::BackToBack;
+    } else if (value & 0x04) {
+        this->mode = Mode::Timed;
+    } else if (value & 0x01) {
+        if (this->mode == Mode::BackToBack || this->mode == Mode::Timed) {
+            // Start/stop bit while ranging continuously: stop
+            this->mode = Mode::Idle;
+            this->registers[SYSRANGE_START] = 0x00;
+            return;
+        }
+        this->mode = Mode::Single;
+    } else {
+        this->mode = Mode::Idle;
+        return;
+    }
+    this->dueMicroseconds = now + this->periodMicroseconds();
+}
+
+uint64_t VL53L0Xsim::periodMicroseconds() {
+    uint64_t measurement = this->config.measurementMicroseconds;
+    if (this->mode != Mode::Timed) {
+        return measurement;
+    }
+    const uint8_t *p = this->registers + SYSTEM_INTERMEASUREMENT_PERIOD;
+    uint32_t ticks = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                     (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    uint64_t interMeasurement = static_cast<uint64_t>(ticks) * 1000 / kOscCalibrate;
+    return (interMeasurement > measurement) ? interMeasurement : measurement;
+}
+
+/** Completes whatever measurement is due by now; runs before every transfer.
+ */
+void VL53L0Xsim::advance() {
+    if (this->mode == Mode::Idle) {
+        return;
+    }
+    uint64_t now = nowMicroseconds();
+    if (now < this->dueMicroseconds) {
+        return;
+    }
+    this->complete();
+    if (this->mode == Mode::Single) {
+        this->mode = Mode::Idle;
+        this->registers[SYSRANGE_START] &= ~0x01;
+        return;
+    }
+    // Continuous: keep the sensor's own cadence; results nobody read in time are overwritten
+    uint64_t period = this->periodMicroseconds();
+    if (period == 0) {
+        this->dueMicroseconds = now;
+    } else {
+        this->dueMicroseconds += period * ((now - this->dueMicroseconds) / period + 1);
+    }
+}
+
+void VL53L0Xsim::complete() {
+    // Reference calibrations run with the final range step disabled and produce no range
+    if (this->registers[SYSTEM_SEQUENCE_CONFIG] & 0x80) {
+        const VL53L0XSimSample& sample = this->config.trace[this->traceIndex];
+        this->traceIndex = (this->traceIndex + 1) % this->config.trace.size();
+
+        uint8_t *result = this->registers + RESULT_RANGE_STATUS;
+        std::memset(result, 0, 12);
+        result[0] = static_cast<uint8_t>((sample.rangeStatus & 0x0F) << 3);
+        putBigEndian16(result + kResultSpadCount, 10 << 8);
+        putBigEndian16(result + kResultSignalRate, toFixed97(sample.signalRateMCPS));
+        putBigEndian16(result + kResultAmbientRate, toFixed97(sample.ambientRateMCPS));
+        putBigEndian16(result + kResultRange, sample.rangeMillimeters);
+        this->measurementCount++;
+    } else if (this->registers[SYSRANGE_START] & 0x40) {
+        this->registers[0xCB] = (this->registers[0xCB] & 0x80) | kVhvSettings;
+        this->calibrationCount++;
+    } else {
+        this->registers[0xEE] = (this->registers[0xEE] & 0x80) | kPhaseCal;
+        this->calibrationCount++;
+    }
+    // GPIO function 4: new sample ready
+    this->registers[RESULT_INTERRUPT_STATUS] = 0x04;
+}
@@ -1,5 +1,6 @@
 #include <vl53lXx/vl53l0x.hpp>
 #include <vl53lXx/interfaces/i2cdev.hpp>
+#include <vl53lXx/interfaces/i2c_interface.hpp>
 
 #include <cerrno>
 // strerror()
@@ -36,10 +37,114 @@ uint64_t milliseconds() {
 	return (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
+/*** Register tables ***/
+
+// Register table written by VL53L0X_load_tuning_settings(), see initHardware()
+static const I2CRegisterWrite DEFAULT_TUNING_SETTINGS[] = {
+	{0xFF, 0x01},
+	{0x00, 0x00},
+
+	{0xFF, 0x00},
+	{0x09, 0x00},
+	{0x10, 0x00},
+	{0x11, 0x00},
+
+	{0x24, 0x01},
+	{0x25, 0xFF},
+	{0x75, 0x00},
+
+	{0xFF, 0x01},
+	{0x4E, 0x2C},
+	{0x48, 0x00},
+	{0x30, 0x20},
+
+	{0xFF, 0x00},
+	{0x30, 0x09},
+	{0x54, 0x00},
+	{0x31, 0x04},
+	{0x32, 0x03},
+	{0x40, 0x83},
+	{0x46, 0x25},
+	{0x60, 0x00},
+	{0x27, 0x00},
+	{0x50, 0x06},
+	{0x51, 0x00},
+	{0x52, 0x96},
+	{0x56, 0x08},
+	{0x57, 0x30},
+	{0x61, 0x00},
+	{0x62, 0x00},
+	{0x64, 0x00},
+	{0x65, 0x00},
+	{0x66, 0xA0},
+
+	{0xFF, 0x01},
+	{0x22, 0x32},
+	{0x47, 0x14},
+	{0x49, 0xFF},
+	{0x4A, 0x00},
+
+	{0xFF, 0x00},
+	{0x7A, 0x0A},
+	{0x7B, 0x00},
+	{0x78, 0x21},
+
+	{0xFF, 0x01},
+	{0x23, 0x34},
+	{0x42, 0x00},
+	{0x44, 0xFF},
+	{0x45, 0x26},
+	{0x46, 0x05},
+	{0x40, 0x40},
+	{0x0E, 0x06},
+	{0x20, 0x1A},
+	{0x43, 0x40},
+
+	{0xFF, 0x00},
+	{0x34, 0x03},
+	{0x35, 0x44},
+
+	{0xFF, 0x01},
+	{0x31, 0x04},
+	{0x4B, 0x09},
+	{0x4C, 0x05},
+	{0x4D, 0x04},
+
+	{0xFF, 0x00},
+	{0x44, 0x00},
+	{0x45, 0x20},
+	{0x47, 0x08},
+	{0x48, 0x28},
+	{0x67, 0x00},
+	{0x70, 0x04},
+	{0x71, 0x01},
+	{0x72, 0xFE},
+	{0x76, 0x00},
+	{0x77, 0x00},
+
+	{0xFF, 0x01},
+	{0x0D, 0x01},
+
+	{0xFF, 0x00},
+	{0x80, 0x01},
+	{0x01, 0xF8},
+
+	{0xFF, 0x01},
+	{0x8E, 0x01},
+	{0x00, 0x01},
+	{0xFF, 0x00},
+	{0x80, 0x00},
+};
+
 /*** Constructors ***/
 
 VL53L0X::VL53L0X(uint8_t port, const uint8_t address, const int16_t xshutGPIOPin, bool ioMode2v8, float *calib):
-    VL53LXX(port, address, xshutGPIOPin, ioMode2v8, calib)
+    VL53L0X(new I2CInterface(port, address), xshutGPIOPin, ioMode2v8, calib)
+{
+}
+
+VL53L0X::VL53L0X(I2Cgeneric *bus, const int16_t xshutGPIOPin, bool ioMode2v8, float *calib):
+    VL53LXX(bus, xshutGPIOPin, ioMode2v8, calib)
 {
 	this->xshutGPIOPin = xshutGPIOPin;
 	this->ioMode2v8 = ioMode2v8;
@@ -50,6 +155,7 @@ VL53L0X::VL53L0X(uint8_t port, const uint8_t address, const int16_t xshutGPIOPin
 
 	this->measurementTimingBudgetMicroseconds = 33000;
 	this->stopVariable = 0;
+	this->calibrationValid = false;
 	this->timeoutStartMilliseconds = milliseconds();
 }
 
@@ -61,6 +167,21 @@ bool VL53L0X::init() {
 	return true;
 }
 
+bool VL53L0X::init(const VL53L0XCalibration& calibration) {
+	this->initGPIO();
+	return this->initHardware(&calibration);
+}
+
+bool VL53L0X::getCalibration(VL53L0XCalibration* calibration) {
+	if (!this->calibrationValid) {
+		return false;
+	}
+	// VHV and phase are only read here, so that an init() nobody saves pays no extra transfers
+	this->getRefCalibration(&this->calibration.vhvSettings, &this->calibration.phaseCal);
+	*calibration = this->calibration;
+	return true;
+}
+
 void VL53L0X::setAddress(uint8_t newAddress) {
 	// Ensure power state
 	this->powerOn();
@@ -351,13 +472,16 @@ uint8_t VL53L0X::getVcselPulsePeriod(vl53l0xVcselPeriodType type) {
 }
 
 void VL53L0X::startContinuous(uint32_t periodMilliseconds) {
-	this->writeRegister(0x80, 0x01);
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x00, 0x00);
-	this->writeRegister(0x91, this->stopVariable);
-	this->writeRegister(0x00, 0x01);
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x80, 0x00);
+	const I2CRegisterWrite preamble[] = {
+		{0x80, 0x01},
+		{0xFF, 0x01},
+		{0x00, 0x00},
+		{0x91, this->stopVariable},
+		{0x00, 0x01},
+		{0xFF, 0x00},
+		{0x80, 0x00},
+	};
+	this->writeRegisterBatch(preamble, sizeof(preamble) / sizeof(preamble[0]));
 
 	if (periodMilliseconds != 0) {
 		// continuous timed mode
@@ -385,23 +509,31 @@ void VL53L0X::startContinuous(uint32_t periodMilliseconds) {
 
 void VL53L0X::stopContinuous() {
 	// VL53L0X_REG_SYSRANGE_MODE_SINGLESHOT
-	this->writeRegister(SYSRANGE_START, 0x01);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x00, 0x00);
-	this->writeRegister(0x91, 0x00);
-	this->writeRegister(0x00, 0x01);
-	this->writeRegister(0xFF, 0x00);
+	const I2CRegisterWrite sequence[] = {
+		{SYSRANGE_START, 0x01},
+		{0xFF, 0x01},
+		{0x00, 0x00},
+		{0x91, 0x00},
+		{0x00, 0x01},
+		{0xFF, 0x00},
+	};
+	this->writeRegisterBatch(sequence, sizeof(sequence) / sizeof(sequence[0]));
 }
 
 uint16_t VL53L0X::readRangeContinuousMillimeters(bool blocking) {
-	startTimeout();
-	while ((this->readRegister(RESULT_INTERRUPT_STATUS) & 0x07) == 0) {
-		if (checkTimeoutExpired()) {
-			this->didTimeout = true;
-			return 65535;
+	if (!blocking) {
+		if ((this->readRegister(RESULT_INTERRUPT_STATUS) & 0x07) == 0) {
+			return VL53L0X_RANGE_NOT_READY;
+		}
+	} else {
+		startTimeout();
+		while ((this->readRegister(RESULT_INTERRUPT_STATUS) & 0x07) == 0) {
+			if (checkTimeoutExpired()) {
+				this->didTimeout = true;
+				return 65535;
+			}
+			usleep(1);
 		}
-		usleep(1);
 	}
 
 	// assumptions: Linearity Corrective Gain is 1000 (default);
@@ -418,15 +550,21 @@ uint16_t VL53L0X::readRangeContinuousMillimeters(bool blocking) {
 }
 
 uint16_t VL53L0X::readRangeSingleMillimeters(bool blocking) {
-	this->writeRegister(0x80, 0x01);
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x00, 0x00);
-	this->writeRegister(0x91, this->stopVariable);
-	this->writeRegister(0x00, 0x01);
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x80, 0x00);
-
-	this->writeRegister(SYSRANGE_START, 0x01);
+	const I2CRegisterWrite preamble[] = {
+		{0x80, 0x01},
+		{0xFF, 0x01},
+		{0x00, 0x00},
+		{0x91, this->stopVariable},
+		{0x00, 0x01},
+		{0xFF, 0x00},
+		{0x80, 0x00},
+		{SYSRANGE_START, 0x01},
+	};
+	this->writeRegisterBatch(preamble, sizeof(preamble) / sizeof(preamble[0]));
+
+	if (!blocking) {
+		return VL53L0X_RANGE_NOT_READY;
+	}
 
 	// "Wait until start bit has been cleared"
 	startTimeout();
@@ -441,6 +579,39 @@ uint16_t VL53L0X::readRangeSingleMillimeters(bool blocking) {
 	return readRangeContinuousMillimeters();
 }
 
+bool VL53L0X::readRangingData(VL53L0XRangingData *data, bool blocking) {
+	static_assert(RESULT_RANGE_STATUS == RESULT_INTERRUPT_STATUS + 1, "burst read relies on adjacent registers");
+
+	uint8_t block[1 + VL53L0X_RESULT_BLOCK_SIZE];
+	if (!blocking) {
+		this->readRegisterMultiple(RESULT_INTERRUPT_STATUS, block, sizeof(block));
+		if ((block[0] & 0x07) == 0) {
+			return false;
+		}
+	} else {
+		// Poll the status byte alone; a 13-byte burst per poll would mostly carry stale data
+		startTimeout();
+		while ((this->readRegister(RESULT_INTERRUPT_STATUS) & 0x07) == 0) {
+			if (checkTimeoutExpired()) {
+				this->didTimeout = true;
+				return false;
+			}
+			usleep(1);
+		}
+		this->readRegisterMultiple(RESULT_RANGE_STATUS, block + 1, VL53L0X_RESULT_BLOCK_SIZE);
+	}
+
+	const uint8_t *result = block + 1;
+	data->rangeStatus = (result[0] & 0x78) >> 3;
+	data->effectiveSpadCount = (float)(((uint16_t)result[2] << 8) | result[3]) / (1 << 8);
+	data->signalRateMCPS = (float)(((uint16_t)result[6] << 8) | result[7]) / (1 << 7);
+	data->ambientRateMCPS = (float)(((uint16_t)result[8] << 8) | result[9]) / (1 << 7);
+	data->rangeMillimeters = ((uint16_t)result[10] << 8) | result[11];
+
+	this->writeRegister(SYSTEM_INTERRUPT_CLEAR, 0x01);
+	return true;
+}
+
 bool VL53L0X::timeoutOccurred() {
 	bool tmp = this->didTimeout;
 	this->didTimeout = false;
@@ -449,7 +620,9 @@ bool VL53L0X::timeoutOccurred() {
 
 /*** Private Methods ***/
 
-void VL53L0X::initHardware() {
+bool VL53L0X::initHardware(const VL53L0XCalibration* restore) {
+	this->calibrationValid = false;
+
 	// Enable the sensor
 	this->powerOn();
 
@@ -489,11 +662,19 @@ void VL53L0X::initHardware() {
 	if (!this->getSPADInfo(&spadCount, &spadTypeIsAperture)) {
 		throw(std::runtime_error("Failed retrieving SPAD info!"));
 	}
+	if (restore && (restore->spadCount != spadCount || restore->spadTypeIsAperture != spadTypeIsAperture)) {
+		// Saved for a different module
+		return false;
+	}
 
 	// The SPAD map (RefGoodSpadMap) is read by VL53L0X_get_info_from_device() in the API,
 	// but the same data seems to be more easily readable from GLOBAL_CONFIG_SPAD_ENABLES_REF_0 through _6, so read it from there
 	uint8_t refSPADMap[6];
-	this->readRegisterMultiple(GLOBAL_CONFIG_SPAD_ENABLES_REF_0, refSPADMap, 6);
+	if (restore) {
+		std::memcpy(refSPADMap, restore->refSpadMap, sizeof(refSPADMap));
+	} else {
+		this->readRegisterMultiple(GLOBAL_CONFIG_SPAD_ENABLES_REF_0, refSPADMap, 6);
+	}
 
 	// -- VL53L0X_set_reference_spads() begin (assume NVM values are valid)
 
@@ -503,119 +684,33 @@ void VL53L0X::initHardware() {
 	this->writeRegister(0xFF, 0x00);
 	this->writeRegister(GLOBAL_CONFIG_REF_EN_START_SELECT, 0xB4);
 
-	// 12 is the first aperture spad
-	uint8_t firstSPADToEnable = spadTypeIsAperture ? 12 : 0;
-	uint8_t spadsEnabled = 0;
-
-	for (uint8_t i = 0; i < 48; i++) {
-		if (i < firstSPADToEnable || spadsEnabled == spadCount) {
-			// This bit is lower than the first one that should be enabled, or (reference_spad_count) bits have already been enabled, so zero this bit
-			refSPADMap[i / 8] &= ~(1 << (i % 8));
-		} else if ((refSPADMap[i / 8] >> (i % 8)) & 0x1) {
-			spadsEnabled++;
+	if (!restore) {
+		// 12 is the first aperture spad
+		uint8_t firstSPADToEnable = spadTypeIsAperture ? 12 : 0;
+		uint8_t spadsEnabled = 0;
+
+		for (uint8_t i = 0; i < 48; i++) {
+			if (i < firstSPADToEnable || spadsEnabled == spadCount) {
+				// This bit is lower than the first one that should be enabled, or (reference_spad_count) bits have already been enabled, so zero this bit
+				refSPADMap[i / 8] &= ~(1 << (i % 8));
+			} else if ((refSPADMap[i / 8] >> (i % 8)) & 0x1) {
+				spadsEnabled++;
+			}
 		}
 	}
 
 	this->writeRegisterMultiple(GLOBAL_CONFIG_SPAD_ENABLES_REF_0, refSPADMap, 6);
 
+	this->calibration.spadCount = spadCount;
+	this->calibration.spadTypeIsAperture = spadTypeIsAperture;
+	std::memcpy(this->calibration.refSpadMap, refSPADMap, sizeof(refSPADMap));
+
 	// -- VL53L0X_set_reference_spads() end
 
 	// -- VL53L0X_load_tuning_settings() begin
 	// DefaultTuningSettings from vl53l0x_tuning.h
 
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x00, 0x00);
-
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x09, 0x00);
-	this->writeRegister(0x10, 0x00);
-	this->writeRegister(0x11, 0x00);
-
-	this->writeRegister(0x24, 0x01);
-	this->writeRegister(0x25, 0xFF);
-	this->writeRegister(0x75, 0x00);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x4E, 0x2C);
-	this->writeRegister(0x48, 0x00);
-	this->writeRegister(0x30, 0x20);
-
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x30, 0x09);
-	this->writeRegister(0x54, 0x00);
-	this->writeRegister(0x31, 0x04);
-	this->writeRegister(0x32, 0x03);
-	this->writeRegister(0x40, 0x83);
-	this->writeRegister(0x46, 0x25);
-	this->writeRegister(0x60, 0x00);
-	this->writeRegister(0x27, 0x00);
-	this->writeRegister(0x50, 0x06);
-	this->writeRegister(0x51, 0x00);
-	this->writeRegister(0x52, 0x96);
-	this->writeRegister(0x56, 0x08);
-	this->writeRegister(0x57, 0x30);
-	this->writeRegister(0x61, 0x00);
-	this->writeRegister(0x62, 0x00);
-	this->writeRegister(0x64, 0x00);
-	this->writeRegister(0x65, 0x00);
-	this->writeRegister(0x66, 0xA0);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x22, 0x32);
-	this->writeRegister(0x47, 0x14);
-	this->writeRegister(0x49, 0xFF);
-	this->writeRegister(0x4A, 0x00);
-
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x7A, 0x0A);
-	this->writeRegister(0x7B, 0x00);
-	this->writeRegister(0x78, 0x21);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x23, 0x34);
-	this->writeRegister(0x42, 0x00);
-	this->writeRegister(0x44, 0xFF);
-	this->writeRegister(0x45, 0x26);
-	this->writeRegister(0x46, 0x05);
-	this->writeRegister(0x40, 0x40);
-	this->writeRegister(0x0E, 0x06);
-	this->writeRegister(0x20, 0x1A);
-	this->writeRegister(0x43, 0x40);
-
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x34, 0x03);
-	this->writeRegister(0x35, 0x44);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x31, 0x04);
-	this->writeRegister(0x4B, 0x09);
-	this->writeRegister(0x4C, 0x05);
-	this->writeRegister(0x4D, 0x04);
-
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x44, 0x00);
-	this->writeRegister(0x45, 0x20);
-	this->writeRegister(0x47, 0x08);
-	this->writeRegister(0x48, 0x28);
-	this->writeRegister(0x67, 0x00);
-	this->writeRegister(0x70, 0x04);
-	this->writeRegister(0x71, 0x01);
-	this->writeRegister(0x72, 0xFE);
-	this->writeRegister(0x76, 0x00);
-	this->writeRegister(0x77, 0x00);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x0D, 0x01);
-
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x80, 0x01);
-	this->writeRegister(0x01, 0xF8);
-
-	this->writeRegister(0xFF, 0x01);
-	this->writeRegister(0x8E, 0x01);
-	this->writeRegister(0x00, 0x01);
-	this->writeRegister(0xFF, 0x00);
-	this->writeRegister(0x80, 0x00);
+	this->writeRegisterBatch(DEFAULT_TUNING_SETTINGS, sizeof(DEFAULT_TUNING_SETTINGS) / sizeof(DEFAULT_TUNING_SETTINGS[0]));
 
 	// -- VL53L0X_load_tuning_settings() end
 
@@ -645,6 +740,21 @@ void VL53L0X::initHardware() {
 
 	// VL53L0X_StaticInit() end
 
+	if (restore) {
+		// VL53L0X_SetRefCalibration() instead of the two calibration measurements; check that it and the SPAD map took
+		uint8_t readBack[6];
+		this->readRegisterMultiple(GLOBAL_CONFIG_SPAD_ENABLES_REF_0, readBack, 6);
+		if (!this->setRefCalibration(restore->vhvSettings, restore->phaseCal) ||
+				std::memcmp(readBack, refSPADMap, sizeof(readBack)) != 0) {
+			return false;
+		}
+		this->calibration.vhvSettings = restore->vhvSettings;
+		this->calibration.phaseCal = restore->phaseCal;
+		this->writeRegister(SYSTEM_SEQUENCE_CONFIG, 0xE8);
+		this->calibrationValid = true;
+		return true;
+	}
+
 	// VL53L0X_PerformRefCalibration() begin (VL53L0X_perform_ref_calibration())
 
 	// -- VL53L0X_perform_vhv_calibration() begin
@@ -669,6 +779,9 @@ void VL53L0X::initHardware() {
 	this->writeRegister(SYSTEM_SEQUENCE_CONFIG, 0xE8);
 
 	// VL53L0X_PerformRefCalibration() end
+
+	this->calibrationValid = true;
+	return true;
 }
 
 bool VL53L0X::getSPADInfo(uint8_t* count, bool* typeIsAperture) {
@@ -796,6 +909,38 @@ bool VL53L0X::performSingleRefCalibration(uint8_t vhvInitByte) {
 	return true;
 }
 
+void VL53L0X::getRefCalibration(uint8_t* vhvSettings, uint8_t* phaseCal) {
+	this->writeRegister(0xFF, 0x01);
+	this->writeRegister(0x00, 0x00);
+	this->writeRegister(0xFF, 0x00);
+
+	*vhvSettings = this->readRegister(0xCB);
+	*phaseCal = this->readRegister(0xEE) & 0xEF;
+
+	this->writeRegister(0xFF, 0x01);
+	this->writeRegister(0x00, 0x01);
+	this->writeRegister(0xFF, 0x00);
+}
+
+bool VL53L0X::setRefCalibration(uint8_t vhvSettings, uint8_t phaseCal) {
+	this->writeRegister(0xFF, 0x01);
+	this->writeRegister(0x00, 0x00);
+	this->writeRegister(0xFF, 0x00);
+
+	// VL53L0X_UpdateByte(..., 0x80, value): bit 7 stays as the device has it
+	uint8_t vhv = (this->readRegister(0xCB) & 0x80) | vhvSettings;
+	uint8_t phase = (this->readRegister(0xEE) & 0x80) | phaseCal;
+	this->writeRegister(0xCB, vhv);
+	this->writeRegister(0xEE, phase);
+	// Read back in the same window, compared the way getRefCalibration() would report them
+	bool ok = this->readRegister(0xCB) == vhv && (this->readRegister(0xEE) & 0xEF) == (phase & 0xEF);
+
+	this->writeRegister(0xFF, 0x01);
+	this->writeRegister(0x00, 0x01);
+	this->writeRegister(0xFF, 0x00);
+	return ok;
+}
+
 /*** I2C wrapper methods ***/
 
 void VL53L0X::writeRegister(uint8_t reg, uint8_t value) {
@@ -816,10 +961,10 @@ void VL53L0X::writeRegister16Bit(uint8_t reg, uint16_t value) {
 void VL53L0X::writeRegister32Bit(uint8_t reg, uint32_t value) {
 	// Split 32-bit word into MS ... LS bytes
 	uint8_t data[4];
-	data[0] = value & 0xFF;
-	data[1] = (value >> 8) & 0xFF;
-	data[2] = (value >> 16) & 0xFF;
-	data[3] = (value >> 24) & 0xFF;
+	data[0] = (value >> 24) & 0xFF;
+	data[1] = (value >> 16) & 0xFF;
+	data[2] = (value >> 8) & 0xFF;
+	data[3] = value & 0xFF;
 
 	bool p = this->i2c->writeBytes(reg, 4, data);
 	if (!p) {
@@ -827,9 +972,16 @@ void VL53L0X::writeRegister32Bit(uint8_t reg, uint32_t value) {
 	}
 }
 
+void VL53L0X::writeRegisterBatch(const I2CRegisterWrite* writes, uint16_t count) {
+	bool p = this->i2c->writeBatch(writes, count);
+	if (!p) {
+		throw(std::runtime_error(std::string("Error writing register batch: ") + strerror(errno)));
+	}
+}
+
 void VL53L0X::writeRegisterMultiple(uint8_t reg, const uint8_t* source, uint8_t count) {
-	uint8_t data[4];
-	for (uint8_t i = 0; i < 4; ++i) {
+	uint8_t data[count];
+	for (uint8_t i = 0; i < count; ++i) {
 		data[i] = source[i];
 	}
 	bool p = this->i2c->writeBytes(reg, count, data);
@@ -2,7 +2,12 @@
 #include <vl53lXx/interfaces/i2c_interface.hpp>
 
 VL53LXX::VL53LXX(uint8_t port, const uint8_t address, const int16_t xshutGPIOPin, bool ioMode2v8, float *calib) :
-    i2c(new I2CInterface(port, address)),
+    VL53LXX(new I2CInterface(port, address), xshutGPIOPin, ioMode2v8, calib)
+{
+}
+
+VL53LXX::VL53LXX(I2Cgeneric *bus, const int16_t xshutGPIOPin, bool ioMode2v8, float *calib) :
+    i2c(bus),
     xshutGPIOPin(xshutGPIOPin),
     ioMode2v8(ioMode2v8)
 {
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Fixed-capacity queue between pipeline stages.
+// A full queue drops its oldest item so a slow consumer sees the freshest frames,
+// and the producer (often a librealsense callback) never blocks.
+template <typename T>
+class BoundedQueue
+{
+  public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+    // Returns false when an older item had to be dropped to make room.
+    bool push(T item)
+    {
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_)
+            {
+                return true;
+            }
+            if (items_.size() >= capacity_)
+            {
+                items_.pop_front();
+                ++dropped_;
+                dropped = true;
+            }
+            items_.push_back(std::move(item));
+        }
+        ready_.notify_one();
+        return !dropped;
+    }
+
+    // Waits up to `timeout` for an item; returns false on timeout or once closed and drained.
+    bool pop(T& out, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!ready_.wait_for(lock, timeout, [this] { return !items_.empty() || closed_; }) || items_.empty())
+        {
+            return false;
+        }
+        out = std::move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+    bool closed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
+    uint64_t dropped() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+  private:
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<T> items_;
+    uint64_t dropped_ = 0;
+    bool closed_ = false;
+};
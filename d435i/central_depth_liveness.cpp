@@ -1,150 +1,907 @@
+#include "bounded_queue.hpp"
+#include "depth_engine.hpp"
+#include "depth_roi.hpp"
+#include "sensor_fusion.hpp"
+#include "stream_settle.hpp"
+#include "temporal_liveness.hpp"
+#include "tof_proximity.hpp"
+
+// controller/tof
+#include "metrics.hpp"
+#include "realtime.hpp"
+
 #include <librealsense2/rs.hpp>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <numeric>
-#include <vector>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
 
 namespace
 {
-struct Stats
+// The verdict after "->" is the smoothed window decision; frame= is this frame judged alone.
+void print_metrics(const DepthStats& stats, bool alive, const TemporalLivenessState& window)
+{
+    std::cout << "samples=" << stats.count << " min(m)=" << stats.min << " max(m)=" << stats.max << " mean(m)=" << stats.mean
+              << " median(m)=" << stats.median << " stdev(m)=" << stats.stdev
+              << " trimmed_range(m)=" << (stats.p_high - stats.p_low) << " frame=" << (alive ? "LIVE" : "FLAT")
+              << " window_frames=" << window.frames << " window_range(m)=" << window.range_mean_m
+              << " window_stdev(m)=" << window.stdev_mean_m << " depth_jitter(m)=" << window.depth_jitter_m << " -> "
+              << (window.live ? "LIVE" : "FLAT") << std::endl;
+}
+
+std::atomic<bool> g_should_exit{false};
+
+void signal_handler(int)
+{
+    g_should_exit.store(true);
+}
+
+using Clock = std::chrono::steady_clock;
+
+void report_settled(const StreamSettle& settle, Clock::time_point started)
+{
+    std::cerr << "stream settled after " << settle.frames() << " frames"
+              << (settle.timed_out() ? " (frame limit)" : "") << " in "
+              << std::chrono::duration<double, std::milli>(Clock::now() - started).count() << " ms" << std::endl;
+}
+
+// False once Ctrl+C was pressed or, when gated by the ToF (--wake-shm), the person has left.
+bool keep_streaming(ToFProximity* proximity)
+{
+    if (g_should_exit.load())
+    {
+        return false;
+    }
+    if (!proximity)
+    {
+        return true;
+    }
+    proximity->poll();
+    return proximity->present();
+}
+
+// --fuse-shm: each frame's result is joined with the ToF readings around it and printed as one JSON event.
+struct Fusion
+{
+    ToFProximity* tof = nullptr;
+    double max_skew_ms = 100.0;
+    ToFSample history[ToFProximity::kHistoryLength];
+};
+
+void print_fused_event(const FrameResult& result, const TemporalLivenessState& window, Fusion& fusion)
+{
+    const size_t count = fusion.tof->read_history(fusion.history);
+    const ToFPairing tof = pair_tof(fusion.history, count, result.host_ms, fusion.max_skew_ms);
+    std::ostringstream line;
+    line << "{";
+    write_fused_fields(line, result, window, tof);
+    line << "}";
+    std::cout << line.str() << std::endl;
+}
+
+void emit_result(const FrameResult& result, const TemporalLivenessState& window, Fusion* fusion)
+{
+    if (fusion)
+    {
+        print_fused_event(result, window, *fusion);
+    }
+    else
+    {
+        print_metrics(result.stats, result.alive, window);
+    }
+}
+
+// What the stages count for --metrics; kept in every mode, --metrics only decides whether it is written out.
+struct LivenessMetrics
+{
+    std::atomic<uint64_t> frames{0};        // decisions emitted
+    std::atomic<uint64_t> sessions{0};      // times the streams were started
+    std::atomic<uint64_t> sensor_gaps{0};   // frames librealsense dropped before we saw them
+    std::atomic<uint64_t> capture_drops{0}; // --pipeline: frames dropped between capture and processing
+    std::atomic<uint64_t> result_drops{0};  // --pipeline: results dropped between processing and output
+    std::atomic<double> processing_cpu_s{0.0}; // CPU time of the processing thread, all sessions so far
+    LatencyHistogram delivery;              // host arrival to our thread, live cameras only
+    LatencyHistogram queue;                 // --pipeline: captured to processing start
+    LatencyHistogram process;               // filters, alignment and ROI statistics of one frame
+    LatencyHistogram emit;                  // --pipeline: processed to emitted
+};
+
+int64_t micros(Clock::duration elapsed)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// Keeps LivenessMetrics::processing_cpu_s current from the thread doing the processing, which may be
+// a new one every session.
+class ProcessingCpu
+{
+  public:
+    explicit ProcessingCpu(LivenessMetrics& metrics)
+        : metrics_(metrics), base_s_(metrics.processing_cpu_s.load(std::memory_order_relaxed)),
+          start_s_(thread_cpu_seconds(pthread_self()))
+    {
+    }
+
+    void update()
+    {
+        metrics_.processing_cpu_s.store(base_s_ + thread_cpu_seconds(pthread_self()) - start_s_,
+                                        std::memory_order_relaxed);
+    }
+
+  private:
+    LivenessMetrics& metrics_;
+    double base_s_;
+    double start_s_;
+};
+
+// Per-session behaviour shared by run_blocking() and run_pipeline().
+struct SessionOptions
 {
-    double mean = 0.0;
-    double stdev = 0.0;
-    double min = 0.0;
-    double max = 0.0;
-    size_t count = 0;
+    StreamSettleConfig settle;
+    ToFProximity* gate = nullptr;  // --wake-shm: stream only while someone is there
+    Fusion* fusion = nullptr;      // --fuse-shm
+    ThreadRealtime delivery;       // librealsense's frame callback thread (--pipeline only)
+    ThreadRealtime processing;     // the processing thread, or the capture loop without --pipeline
+    bool prefault = false;         // --mlock: touch each thread's stack before its first frame
+    double latency_report_s = 0.0; // --latency-report period; 0 = off
+    LivenessMetrics* metrics = nullptr; // set by main()
+};
+
+// Latency of one pipeline stage, accumulated between reports.
+struct StageLatency
+{
+    uint64_t count = 0;
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+
+    void add(Clock::time_point begin, Clock::time_point end)
+    {
+        const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        ++count;
+        total_ms += ms;
+        max_ms = std::max(max_ms, ms);
+    }
+
+    double mean_ms() const { return count ? total_ms / static_cast<double>(count) : 0.0; }
+};
+
+// --latency-report: percentiles of one latency, printed every period_s and at the end of a session.
+struct LatencyReport
+{
+    const char* name;
+    Clock::duration period{}; // zero = off
+    Clock::time_point next{};
+    WakeLatency latency;
+
+    LatencyReport(const char* report_name, double period_s)
+        : name(report_name),
+          period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period_s)))
+    {
+    }
+
+    void record(int64_t us)
+    {
+        if (period == Clock::duration::zero())
+        {
+            return;
+        }
+        latency.record(us);
+        const auto now = Clock::now();
+        if (next == Clock::time_point{})
+        {
+            next = now + period;
+        }
+        else if (now >= next)
+        {
+            latency.report(name);
+            latency.reset();
+            next = now + period;
+        }
+    }
+
+    void finish() const
+    {
+        if (period != Clock::duration::zero() && latency.count() != 0)
+        {
+            latency.report(name);
+        }
+    }
 };
 
-Stats compute_stats(const std::vector<float>& samples)
+// Microseconds from the host receiving a frame (RS2_FRAME_METADATA_TIME_OF_ARRIVAL, system clock, whole ms)
+// to now; -1 when the backend does not report it. Meaningless for a replay, which keeps the recorded times.
+int64_t delivery_latency_us(const rs2::frameset& frames)
 {
-    Stats s;
-    s.count = samples.size();
-    if (samples.empty())
+    rs2::depth_frame depth = frames.get_depth_frame();
+    if (!depth || !depth.supports_frame_metadata(RS2_FRAME_METADATA_TIME_OF_ARRIVAL))
     {
-        return s;
+        return -1;
     }
+    const int64_t arrival_ms = depth.get_frame_metadata(RS2_FRAME_METADATA_TIME_OF_ARRIVAL);
+    const int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    return now_us - arrival_ms * 1000;
+}
+
+struct CaptureJob
+{
+    rs2::frameset frames;
+    Clock::time_point captured;
+    int64_t delivery_us = -1; // delivery_latency_us() in the callback
+};
 
-    auto minmax = std::minmax_element(samples.begin(), samples.end());
-    s.min = *minmax.first;
-    s.max = *minmax.second;
+struct ResultJob
+{
+    FrameResult result;
+    Clock::time_point captured;
+    Clock::time_point process_begin;
+    Clock::time_point process_end;
+};
 
-    double sum = std::accumulate(samples.begin(), samples.end(), 0.0);
-    s.mean = sum / static_cast<double>(samples.size());
+// Seconds between pipeline latency/drop reports on stderr.
+constexpr int kPipelineReportSeconds = 5;
 
-    double variance = 0.0;
-    for (float v : samples)
+// A non-real-time playback hands out frames as fast as we take them, so a wait this long means the file ended.
+constexpr unsigned int kReplayEndTimeoutMs = 1000;
+
+// Replays a .bag as fast as the consumer takes frames instead of at the recorded rate.
+// Returns false for a live device.
+bool start_fast_playback(const rs2::pipeline_profile& profile)
+{
+    rs2::device device = profile.get_device();
+    if (!device.is<rs2::playback>())
     {
-        double diff = v - s.mean;
-        variance += diff * diff;
+        return false;
     }
-    variance /= static_cast<double>(samples.size());
-    s.stdev = std::sqrt(variance);
-    return s;
+    device.as<rs2::playback>().set_real_time(false);
+    return true;
+}
+
+bool playback_finished(const rs2::pipeline_profile& profile)
+{
+    rs2::device device = profile.get_device();
+    return device.is<rs2::playback>() &&
+           device.as<rs2::playback>().current_status() == RS2_PLAYBACK_STATUS_STOPPED;
 }
 
-std::vector<float> sample_depth_patch(const rs2::depth_frame& depth, float roi_ratio, unsigned int stride)
+// Capture runs on the librealsense callback thread, processing on a worker and emission on the caller.
+// Each hand-off is a BoundedQueue of queue_depth entries that drops its oldest frame when full, so a fast
+// replay through this mode measures the pipeline but may skip frames; run_blocking() replays every frame.
+// With a proximity gate it returns once the person has left, so the caller can stop streaming until the next one.
+int run_pipeline(rs2::pipeline& pipe, const rs2::config& cfg, const LivenessConfig& config, bool full_align,
+                 size_t queue_depth, const SessionOptions& session)
 {
-    std::vector<float> values;
-    const int width = depth.get_width();
-    const int height = depth.get_height();
-    const int roi_w = static_cast<int>(width * roi_ratio);
-    const int roi_h = static_cast<int>(height * roi_ratio);
-    const int x0 = (width - roi_w) / 2;
-    const int y0 = (height - roi_h) / 2;
-    const float depth_unit = depth.get_units();
+    const auto started = Clock::now();
+    BoundedQueue<CaptureJob> captured(queue_depth);
+    BoundedQueue<ResultJob> results(queue_depth);
+
+    auto profile = pipe.start(cfg, [&captured, &session](rs2::frame frame) {
+        // librealsense owns this thread; tune it when it delivers its first frame
+        thread_local bool tuned = false;
+        if (!tuned)
+        {
+            tuned = true;
+            apply_thread_realtime("frame callback", session.delivery);
+            if (session.prefault)
+            {
+                prefault_stack();
+            }
+        }
+        if (auto frames = frame.as<rs2::frameset>())
+        {
+            if (!captured.push(CaptureJob{frames, Clock::now(), delivery_latency_us(frames)}))
+            {
+                session.metrics->capture_drops.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+    std::cout << "Running on device: "
+              << profile.get_device().get_info(RS2_CAMERA_INFO_NAME) << " (SN: "
+              << profile.get_device().get_info(RS2_CAMERA_INFO_SERIAL_NUMBER) << ")" << std::endl;
+    const bool replay = start_fast_playback(profile);
+    LivenessMetrics& metrics = *session.metrics;
+    metrics.sessions.fetch_add(1, std::memory_order_relaxed);
+
+    const RoiSpec depth_roi = select_depth_roi(profile, config, full_align);
+    std::atomic<uint64_t> sensor_gaps{0};
 
-    for (int y = y0; y < y0 + roi_h; y += static_cast<int>(stride))
+    std::thread processing([&] {
+        set_thread_name("d435i-process");
+        apply_thread_realtime("processing", session.processing);
+        if (session.prefault)
+        {
+            prefault_stack();
+        }
+        LatencyReport delivery_latency("frame delivery", session.latency_report_s);
+        LatencyReport wake_latency("processing wake", session.latency_report_s);
+        ProcessingCpu cpu(metrics);
+        rs2::align align_to_color(RS2_STREAM_COLOR);
+        DepthFilterChain filters(config.filters);
+        DepthHistogram histogram;
+        StreamSettle settle(session.settle);
+        ClockMapper clock;
+        unsigned long long last_frame = 0;
+        CaptureJob job;
+        for (;;)
+        {
+            if (!captured.pop(job, std::chrono::milliseconds(100)))
+            {
+                if (captured.closed())
+                {
+                    break;
+                }
+                continue;
+            }
+            wake_latency.record(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.captured).count());
+            if (!replay && job.delivery_us >= 0)
+            {
+                delivery_latency.record(job.delivery_us);
+                metrics.delivery.record(job.delivery_us);
+            }
+            if (!settle.settled())
+            {
+                if (update_settle(settle, job.frames, depth_roi))
+                {
+                    report_settled(settle, started);
+                }
+                continue;
+            }
+            ResultJob out;
+            out.captured = job.captured;
+            out.process_begin = Clock::now();
+            auto depth = prepare_depth(job.frames, config.filters.enabled() ? &filters : nullptr,
+                                       full_align ? &align_to_color : nullptr);
+            if (!depth)
+            {
+                continue;
+            }
+            out.result = evaluate_frame(depth, depth_roi, config, histogram);
+            map_frame_time(clock, out.result, job.captured);
+            out.process_end = Clock::now();
+            metrics.queue.record(micros(out.process_begin - out.captured));
+            metrics.process.record(micros(out.process_end - out.process_begin));
+            // Frames librealsense dropped before our callback ever saw them
+            if (last_frame != 0 && out.result.frame_number > last_frame + 1)
+            {
+                sensor_gaps += out.result.frame_number - last_frame - 1;
+                metrics.sensor_gaps.fetch_add(out.result.frame_number - last_frame - 1, std::memory_order_relaxed);
+            }
+            last_frame = out.result.frame_number;
+            if (!results.push(std::move(out)))
+            {
+                metrics.result_drops.fetch_add(1, std::memory_order_relaxed);
+            }
+            cpu.update();
+        }
+        delivery_latency.finish();
+        wake_latency.finish();
+        results.close();
+    });
+
+    std::cout << "Press Ctrl+C to stop. Capturing (pipeline, queue depth " << queue_depth << ")..." << std::endl;
+    StageLatency queue_wait;
+    StageLatency processing_time;
+    StageLatency emit_wait;
+    uint64_t emitted = 0;
+    auto next_report = Clock::now() + std::chrono::seconds(kPipelineReportSeconds);
+    auto report = [&] {
+        std::cerr << "pipeline: emitted=" << emitted << " sensor_gaps=" << sensor_gaps.load()
+                  << " capture_drops=" << captured.dropped() << " result_drops=" << results.dropped()
+                  << " queue_ms(avg/max)=" << queue_wait.mean_ms() << "/" << queue_wait.max_ms
+                  << " process_ms=" << processing_time.mean_ms() << "/" << processing_time.max_ms
+                  << " emit_ms=" << emit_wait.mean_ms() << "/" << emit_wait.max_ms << std::endl;
+        queue_wait = StageLatency{};
+        processing_time = StageLatency{};
+        emit_wait = StageLatency{};
+    };
+
+    TemporalLiveness window = make_temporal_liveness(config);
+    ResultJob job;
+    while (keep_streaming(session.gate))
     {
-        for (int x = x0; x < x0 + roi_w; x += static_cast<int>(stride))
+        if (results.pop(job, std::chrono::milliseconds(100)))
         {
-            float d = depth.get_distance(x, y);
-            if (d > 0.0f)
+            emit_result(job.result, update_window(window, job.result, config.min_samples), session.fusion);
+            auto emitted_at = Clock::now();
+            if (emitted == 0)
             {
-                values.push_back(d);
+                std::cerr << "first decision "
+                          << std::chrono::duration<double, std::milli>(emitted_at - started).count()
+                          << " ms after start" << std::endl;
             }
+            queue_wait.add(job.captured, job.process_begin);
+            processing_time.add(job.process_begin, job.process_end);
+            emit_wait.add(job.process_end, emitted_at);
+            metrics.emit.record(micros(emitted_at - job.process_end));
+            metrics.frames.fetch_add(1, std::memory_order_relaxed);
+            ++emitted;
+        }
+        else if (replay && playback_finished(profile))
+        {
+            break;
+        }
+        if (Clock::now() >= next_report)
+        {
+            report();
+            next_report += std::chrono::seconds(kPipelineReportSeconds);
+        }
+    }
+
+    pipe.stop();
+    captured.close();
+    processing.join();
+    report();
+    return 0;
+}
+
+int run_blocking(rs2::pipeline& pipe, const rs2::config& cfg, const LivenessConfig& config, bool full_align,
+                 const SessionOptions& session)
+{
+    const auto started = Clock::now();
+    auto profile = pipe.start(cfg);
+    // After start(), so the threads librealsense spawns there do not inherit the policy and affinity
+    apply_thread_realtime("capture loop", session.processing);
+    std::cout << "Running on device: "
+              << profile.get_device().get_info(RS2_CAMERA_INFO_NAME) << " (SN: "
+              << profile.get_device().get_info(RS2_CAMERA_INFO_SERIAL_NUMBER) << ")" << std::endl;
+
+    rs2::align align_to_color(RS2_STREAM_COLOR);
+    DepthFilterChain filters(config.filters);
+    const bool replay = start_fast_playback(profile);
+    LatencyReport delivery_latency("frame delivery", session.latency_report_s);
+    LivenessMetrics& metrics = *session.metrics;
+    metrics.sessions.fetch_add(1, std::memory_order_relaxed);
+    ProcessingCpu cpu(metrics);
+
+    DepthHistogram histogram;  // reused every frame; the loop below allocates nothing
+    const RoiSpec depth_roi = select_depth_roi(profile, config, full_align);
+    TemporalLiveness window = make_temporal_liveness(config);
+
+    StreamSettle settle(session.settle);
+    while (!settle.settled() && keep_streaming(session.gate))
+    {
+        if (update_settle(settle, pipe.wait_for_frames(), depth_roi))
+        {
+            report_settled(settle, started);
         }
     }
 
-    // Convert to meters once to avoid caller confusion even though get_distance already accounts for units.
-    for (float& v : values)
+    std::cout << "Press Ctrl+C to stop. Capturing..." << std::endl;
+    uint64_t frames_processed = 0;
+    unsigned long long last_frame = 0;
+    ClockMapper clock;
+    const auto capturing = Clock::now();
+    while (keep_streaming(session.gate))
     {
-        v *= depth_unit;
+        rs2::frameset frames;
+        if (!replay)
+        {
+            frames = pipe.wait_for_frames();
+        }
+        else if (!pipe.try_wait_for_frames(&frames, kReplayEndTimeoutMs))
+        {
+            break;  // end of the recording
+        }
+        const auto arrived = Clock::now();
+        const int64_t delivery_us = replay ? -1 : delivery_latency_us(frames);
+        if (delivery_us >= 0)
+        {
+            delivery_latency.record(delivery_us);
+            metrics.delivery.record(delivery_us);
+        }
+        auto depth = prepare_depth(frames, config.filters.enabled() ? &filters : nullptr,
+                                   full_align ? &align_to_color : nullptr);
+        if (!depth)
+        {
+            continue;
+        }
+
+        auto result = evaluate_frame(depth, depth_roi, config, histogram);
+        map_frame_time(clock, result, arrived);
+        metrics.process.record(micros(Clock::now() - arrived));
+        if (last_frame != 0 && result.frame_number > last_frame + 1)
+        {
+            metrics.sensor_gaps.fetch_add(result.frame_number - last_frame - 1, std::memory_order_relaxed);
+        }
+        last_frame = result.frame_number;
+        emit_result(result, update_window(window, result, config.min_samples), session.fusion);
+        metrics.frames.fetch_add(1, std::memory_order_relaxed);
+        cpu.update();
+        if (frames_processed == 0)
+        {
+            std::cerr << "first decision " << std::chrono::duration<double, std::milli>(Clock::now() - started).count()
+                      << " ms after start" << std::endl;
+        }
+        ++frames_processed;
+    }
+    pipe.stop();
+    delivery_latency.finish();
+    if (replay)
+    {
+        const double seconds = std::chrono::duration<double>(Clock::now() - capturing).count();
+        std::cerr << "replay: frames=" << frames_processed << " seconds=" << seconds
+                  << " fps=" << (seconds > 0.0 ? frames_processed / seconds : 0.0) << std::endl;
     }
-    return values;
+    return 0;
 }
 
-bool evaluate_liveness(const Stats& stats, double min_range_m, double min_stdev_m, size_t min_samples)
+// How often the idle loop looks at the ToF segment; the reader publishes every 50 ms by default.
+constexpr int kIdlePollMs = 20;
+
+// --wake-shm: the device stays open but not streaming until the ToF sees someone, then `run_session` streams
+// until they have left. Returns the first non-zero session result.
+template <typename Session>
+int run_gated(ToFProximity& proximity, const ProximityConfig& gate, const std::string& shm_name, Session run_session)
 {
-    if (stats.count < min_samples)
+    if (!proximity.open(shm_name))
     {
-        return false;
+        std::cerr << "ToF segment " << shm_name << " not available yet; waiting for tof-reader" << std::endl;
+    }
+    std::cout << "Idle until the ToF reads under " << gate.wake_mm << " mm. Press Ctrl+C to stop." << std::endl;
+    while (!g_should_exit.load())
+    {
+        proximity.poll();
+        if (!proximity.present())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kIdlePollMs));
+            continue;
+        }
+        std::cerr << "wake: ToF distance " << proximity.distance_mm() << " mm, starting streams" << std::endl;
+        const int rc = run_session();
+        if (rc != 0)
+        {
+            return rc;
+        }
+        if (!g_should_exit.load())
+        {
+            std::cerr << "idle: nobody within range for " << gate.idle_s << " s, streams stopped" << std::endl;
+        }
     }
-    const double range = stats.max - stats.min;
-    return (range >= min_range_m) && (stats.stdev >= min_stdev_m);
+    return 0;
 }
 
-void print_metrics(const Stats& stats, bool alive)
+// Prometheus text for --metrics. Totals are counters, so rates come from the scraper (rate() etc.).
+std::string format_metrics(const LivenessMetrics& metrics, pthread_t main_thread)
 {
-    std::cout << "samples=" << stats.count << " min(m)=" << stats.min << " max(m)=" << stats.max << " mean(m)=" << stats.mean
-              << " stdev(m)=" << stats.stdev << " -> " << (alive ? "LIVE" : "FLAT") << std::endl;
+    MetricsText text;
+    text.family("d435i_liveness_frames_total", "counter", "Frames that reached a decision.");
+    text.sample("d435i_liveness_frames_total", metrics.frames.load(std::memory_order_relaxed));
+    text.family("d435i_liveness_sessions_total", "counter", "Times the streams were started.");
+    text.sample("d435i_liveness_sessions_total", metrics.sessions.load(std::memory_order_relaxed));
+    text.family("d435i_liveness_dropped_frames_total", "counter",
+                "Frames lost: skipped by librealsense (sensor), or dropped by a full --pipeline queue.");
+    text.sample("d435i_liveness_dropped_frames_total", metrics.sensor_gaps.load(std::memory_order_relaxed),
+                "where=\"sensor\"");
+    text.sample("d435i_liveness_dropped_frames_total", metrics.capture_drops.load(std::memory_order_relaxed),
+                "where=\"capture_queue\"");
+    text.sample("d435i_liveness_dropped_frames_total", metrics.result_drops.load(std::memory_order_relaxed),
+                "where=\"result_queue\"");
+
+    text.family("d435i_liveness_stage_latency_seconds", "histogram",
+                "Per-stage frame latency: delivery (host arrival to our thread, live cameras only), queue and "
+                "emit (--pipeline hand-offs) and process (filters and ROI statistics).");
+    text.histogram("d435i_liveness_stage_latency_seconds", metrics.delivery, "stage=\"delivery\"");
+    text.histogram("d435i_liveness_stage_latency_seconds", metrics.queue, "stage=\"queue\"");
+    text.histogram("d435i_liveness_stage_latency_seconds", metrics.process, "stage=\"process\"");
+    text.histogram("d435i_liveness_stage_latency_seconds", metrics.emit, "stage=\"emit\"");
+
+    text.family("process_cpu_seconds_total", "counter", "User and system CPU time of the process.");
+    text.sample("process_cpu_seconds_total", process_cpu_seconds());
+    text.family("d435i_liveness_thread_cpu_seconds_total", "counter",
+                "CPU time of the processing thread (all sessions) and the main thread.");
+    text.sample("d435i_liveness_thread_cpu_seconds_total", metrics.processing_cpu_s.load(std::memory_order_relaxed),
+                "thread=\"processing\"");
+    text.sample("d435i_liveness_thread_cpu_seconds_total", thread_cpu_seconds(main_thread), "thread=\"main\"");
+    return text.str();
+}
+
+void usage(const char* prog)
+{
+    std::cerr << "Usage: " << prog << " [--align] [--pipeline] [--queue-depth N] [--window S] [--depth-res WxH] [--fps N]\n"
+              << "       [--stride N] [--target-samples N] [--decimate N] [--spatial] [--temporal] [--hole-fill]\n"
+              << "       [--record FILE.bag | --replay FILE.bag] [--settle-frames N]\n"
+              << "       [--wake-shm NAME [--wake-mm N] [--idle-s S]] [--fuse-shm NAME [--max-skew-ms N]]\n"
+              << "       [--sched-fifo ACQ[,PROC]] [--cpu-acquisition LIST] [--cpu-processing LIST] [--mlock]\n"
+              << "       [--latency-report S] [--metrics FILE [--metrics-interval S]]\n"
+              << "  --align          reproject every depth frame into the color frame (rs2::align) before sampling;\n"
+              << "                   by default the ROI is mapped into depth coordinates once and the native frame is sampled\n"
+              << "  --pipeline       capture, processing and output on separate threads with per-stage latency reports\n"
+              << "  --queue-depth N  frames buffered between pipeline stages (default 2)\n"
+              << "  --window S       seconds of frames behind the smoothed LIVE/FLAT decision (default 1.0)\n"
+              << "  --depth-res WxH  native depth resolution, e.g. 848x480 or 424x240 (default 640x480)\n"
+              << "  --fps N          color and depth frame rate (default 30)\n"
+              << "  --stride N       sample every Nth ROI pixel (default 4, divided by the decimation factor)\n"
+              << "  --target-samples N  pick the stride per frame so about N ROI pixels are visited (overrides --stride)\n"
+              << "  --decimate N     rs2::decimation_filter magnitude 2-8 before sampling (default off)\n"
+              << "  --spatial        apply rs2::spatial_filter\n"
+              << "  --temporal       apply rs2::temporal_filter\n"
+              << "  --hole-fill      apply rs2::hole_filling_filter\n"
+              << "  --record FILE    also write the raw color and depth streams to a librealsense .bag file\n"
+              << "  --replay FILE    read a .bag instead of a camera, as fast as frames are processed and without\n"
+              << "                   warm-up; the blocking mode processes every frame, then prints the throughput\n"
+              << "  --settle-frames N  after starting, skip frames until color exposure and depth fill stop changing,\n"
+              << "                   but at most N (default 30)\n"
+              << "  --wake-shm NAME  keep the camera idle until the tof-reader --shm segment NAME (e.g. /tof-reader)\n"
+              << "                   reports someone within --wake-mm (default 600); stream until the ToF has seen\n"
+              << "                   nobody for --idle-s seconds (default 5), then go idle again\n"
+              << "  --fuse-shm NAME  print one JSON event per frame instead of the text metrics: ROI depth stats and\n"
+              << "                   verdicts joined with the ToF distance from segment NAME at the frame's time\n"
+              << "                   (interpolated, null beyond --max-skew-ms, default 100) and the skew to it;\n"
+              << "                   other stdout lines do not start with '{'\n"
+              << "  --sched-fifo ACQ[,PROC]  SCHED_FIFO priority (1-99) for librealsense's frame callback thread\n"
+              << "                   (--pipeline) and the processing thread; without --pipeline the capture loop takes\n"
+              << "                   PROC, or ACQ when PROC is not given. Needs CAP_SYS_NICE or an RLIMIT_RTPRIO; warns\n"
+              << "                   and keeps the normal policy without\n"
+              << "  --cpu-acquisition LIST, --cpu-processing LIST  pin those threads to CPUs, e.g. 3 or 2-3\n"
+              << "  --mlock          lock all memory (mlockall), including the stacks and frame pools librealsense\n"
+              << "                   allocates later, and pre-fault our thread stacks; needs CAP_IPC_LOCK or a large\n"
+              << "                   enough RLIMIT_MEMLOCK\n"
+              << "  --latency-report S  every S seconds print to stderr the p50/p99/max of frame delivery (host\n"
+              << "                   arrival to our thread, live cameras only) and, with --pipeline, of the processing\n"
+              << "                   thread's wake-up after a frame was queued\n"
+              << "  --metrics FILE   rewrite FILE every --metrics-interval seconds (default 5) with Prometheus text:\n"
+              << "                   frame, session and drop counters, per-stage latency histograms and CPU time.\n"
+              << "                   Point node_exporter's textfile collector at it, or read it directly\n";
 }
 
 } // namespace
 
-int main()
+int main(int argc, char** argv)
 {
-    try
+    bool full_align = false;
+    bool pipeline_mode = false;
+    size_t queue_depth = 2;
+    int depth_width = 640;
+    int depth_height = 480;
+    int fps = 30;
+    std::string record_path;
+    std::string replay_path;
+    std::string wake_shm;
+    std::string fuse_shm;
+    ProximityConfig gate;
+    SessionOptions session;
+    Fusion fusion;
+    LivenessConfig config;
+    bool lock_memory = false;
+    std::string metrics_path;
+    uint64_t metrics_interval_ms = 5000;
+    for (int i = 1; i < argc; ++i)
     {
-        rs2::context ctx;
-        auto list = ctx.query_devices();
-        if (list.size() == 0)
+        if (std::strcmp(argv[i], "--align") == 0)
         {
-            std::cerr << "No RealSense devices connected." << std::endl;
-            return 1;
+            full_align = true;
         }
+        else if (std::strcmp(argv[i], "--pipeline") == 0)
+        {
+            pipeline_mode = true;
+        }
+        else if (std::strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc)
+        {
+            queue_depth = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+        {
+            config.window_s = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--depth-res") == 0 && i + 1 < argc &&
+                 parse_resolution(argv[i + 1], depth_width, depth_height))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            fps = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--stride") == 0 && i + 1 < argc)
+        {
+            config.stride = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--target-samples") == 0 && i + 1 < argc)
+        {
+            config.target_samples = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--decimate") == 0 && i + 1 < argc)
+        {
+            config.filters.decimation = std::clamp(std::atoi(argv[++i]), 1, 8);
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--settle-frames") == 0 && i + 1 < argc)
+        {
+            session.settle.max_frames = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--wake-shm") == 0 && i + 1 < argc)
+        {
+            wake_shm = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--fuse-shm") == 0 && i + 1 < argc)
+        {
+            fuse_shm = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--max-skew-ms") == 0 && i + 1 < argc)
+        {
+            fusion.max_skew_ms = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--wake-mm") == 0 && i + 1 < argc)
+        {
+            gate.wake_mm = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--idle-s") == 0 && i + 1 < argc)
+        {
+            gate.idle_s = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--sched-fifo") == 0 && i + 1 < argc)
+        {
+            char* end = nullptr;
+            session.delivery.fifo_priority = static_cast<int>(std::clamp(std::strtol(argv[++i], &end, 0), 0L, 99L));
+            if (*end == ',')
+            {
+                session.processing.fifo_priority = static_cast<int>(std::clamp(std::strtol(end + 1, nullptr, 0), 0L, 99L));
+            }
+        }
+        else if (std::strcmp(argv[i], "--cpu-acquisition") == 0 && i + 1 < argc)
+        {
+            if (!parse_cpu_list(argv[++i], session.delivery.cpus))
+            {
+                std::cerr << "Invalid CPU list: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--cpu-processing") == 0 && i + 1 < argc)
+        {
+            if (!parse_cpu_list(argv[++i], session.processing.cpus))
+            {
+                std::cerr << "Invalid CPU list: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--mlock") == 0)
+        {
+            lock_memory = true;
+        }
+        else if (std::strcmp(argv[i], "--latency-report") == 0 && i + 1 < argc)
+        {
+            session.latency_report_s = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+        {
+            metrics_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc)
+        {
+            metrics_interval_ms = static_cast<uint64_t>(std::max(0.1, std::atof(argv[++i])) * 1000.0);
+        }
+        else if (std::strcmp(argv[i], "--spatial") == 0)
+        {
+            config.filters.spatial = true;
+        }
+        else if (std::strcmp(argv[i], "--temporal") == 0)
+        {
+            config.filters.temporal = true;
+        }
+        else if (std::strcmp(argv[i], "--hole-fill") == 0)
+        {
+            config.filters.hole_fill = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return (std::strcmp(argv[i], "--help") == 0) ? 0 : 1;
+        }
+    }
 
-        rs2::config cfg;
-        cfg.enable_stream(RS2_STREAM_COLOR, 640, 480, RS2_FORMAT_BGR8, 30);
-        cfg.enable_stream(RS2_STREAM_DEPTH, 640, 480, RS2_FORMAT_Z16, 30);
-
-        rs2::pipeline pipe;
-        auto profile = pipe.start(cfg);
-        std::cout << "Running on device: "
-                  << profile.get_device().get_info(RS2_CAMERA_INFO_NAME) << " (SN: "
-                  << profile.get_device().get_info(RS2_CAMERA_INFO_SERIAL_NUMBER) << ")" << std::endl;
+    if (!wake_shm.empty() && !replay_path.empty())
+    {
+        std::cerr << "--wake-shm needs a live camera, not --replay" << std::endl;
+        return 1;
+    }
+    if (!wake_shm.empty() && !fuse_shm.empty() && wake_shm != fuse_shm)
+    {
+        std::cerr << "--wake-shm and --fuse-shm read one tof-reader segment; give them the same name" << std::endl;
+        return 1;
+    }
 
-        rs2::align align_to_color(RS2_STREAM_COLOR);
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
 
-        constexpr int warmup_frames = 30;
-        for (int i = 0; i < warmup_frames; ++i)
+    if (!pipeline_mode)
+    {
+        // One thread waits for and processes every frame
+        if (session.processing.fifo_priority == 0)
+        {
+            session.processing.fifo_priority = session.delivery.fifo_priority;
+        }
+        if (session.processing.cpus.empty())
         {
-            pipe.wait_for_frames();
+            session.processing.cpus = session.delivery.cpus;
         }
+    }
+    if (lock_memory)
+    {
+        lock_process_memory();
+        prefault_stack();
+        session.prefault = true;
+    }
 
-        constexpr float roi_ratio = 0.4f;      // central 40% area
-        constexpr unsigned int stride = 4;      // subsample to reduce work
-        constexpr double min_range_m = 0.04;    // reject flats with <4 cm depth variation
-        constexpr double min_stdev_m = 0.01;    // require 1 cm standard deviation
-        constexpr size_t min_samples = 250;     // minimum valid depth samples in ROI
+    LivenessMetrics metrics;
+    session.metrics = &metrics;
+    // Destroyed before `metrics`, after a final write
+    std::unique_ptr<MetricsFile> metrics_file;
+    if (!metrics_path.empty())
+    {
+        metrics_file = std::make_unique<MetricsFile>(
+            metrics_path, metrics_interval_ms,
+            [&metrics, main_thread = pthread_self()] { return format_metrics(metrics, main_thread); });
+        metrics_file->start();
+    }
 
-        std::cout << "Press Ctrl+C to stop. Capturing..." << std::endl;
-        while (true)
+    try
+    {
+        rs2::context ctx;
+        rs2::config cfg;
+        if (!replay_path.empty())
         {
-            rs2::frameset frames = pipe.wait_for_frames();
-            frames = align_to_color.process(frames);
-            auto depth = frames.get_depth_frame();
-            if (!depth)
+            // Streams, resolution and frame rate come from the recording
+            cfg.enable_device_from_file(replay_path, false);
+            session.settle.max_frames = 0;
+        }
+        else
+        {
+            auto list = ctx.query_devices();
+            if (list.size() == 0)
             {
-                continue;
+                std::cerr << "No RealSense devices connected." << std::endl;
+                return 1;
             }
+            cfg.enable_stream(RS2_STREAM_COLOR, 640, 480, RS2_FORMAT_BGR8, fps);
+            cfg.enable_stream(RS2_STREAM_DEPTH, depth_width, depth_height, RS2_FORMAT_Z16, fps);
+            if (!record_path.empty())
+            {
+                cfg.enable_record_to_file(record_path);
+            }
+        }
 
-            auto samples = sample_depth_patch(depth, roi_ratio, stride);
-            auto stats = compute_stats(samples);
-            bool alive = evaluate_liveness(stats, min_range_m, min_stdev_m, min_samples);
-            print_metrics(stats, alive);
+        rs2::pipeline pipe(ctx);
+        ToFProximity tof(gate);
+        if (!fuse_shm.empty())
+        {
+            if (!tof.open(fuse_shm))
+            {
+                std::cerr << "ToF segment " << fuse_shm << " not available yet; events carry no ToF until it is" << std::endl;
+            }
+            fusion.tof = &tof;
+            session.fusion = &fusion;
+        }
+        auto run_session = [&] {
+            return pipeline_mode ? run_pipeline(pipe, cfg, config, full_align, queue_depth, session)
+                                 : run_blocking(pipe, cfg, config, full_align, session);
+        };
+        if (!wake_shm.empty())
+        {
+            // Resolve once up front: the device is opened and the stream profiles checked while idle,
+            // so a wake-up only has to start streaming
+            const rs2::pipeline_profile resolved = cfg.resolve(pipe);
+            std::cout << "Waiting on device: " << resolved.get_device().get_info(RS2_CAMERA_INFO_NAME) << std::endl;
+            session.gate = &tof;
+            return run_gated(tof, gate, wake_shm, run_session);
         }
+        return run_session();
     }
     catch (const rs2::error& e)
     {
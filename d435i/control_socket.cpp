@@ -0,0 +1,588 @@
+#include "control_socket.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+// Longest run() goes without looking at its stop flag.
+constexpr int kPollMs = 100;
+
+void skip_space(const std::string& text, size_t& i)
+{
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r' || text[i] == '\n'))
+    {
+        ++i;
+    }
+}
+
+void append_utf8(std::string& out, unsigned int code)
+{
+    if (code < 0x80)
+    {
+        out.push_back(static_cast<char>(code));
+    }
+    else if (code < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// text[i] is the opening quote; leaves i after the closing one. \u escapes outside the BMP are rejected.
+bool parse_string(const std::string& text, size_t& i, std::string& out)
+{
+    out.clear();
+    ++i;
+    while (i < text.size())
+    {
+        const char c = text[i++];
+        if (c == '"')
+        {
+            return true;
+        }
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            return false;
+        }
+        if (c != '\\')
+        {
+            out.push_back(c);
+            continue;
+        }
+        if (i >= text.size())
+        {
+            return false;
+        }
+        const char escape = text[i++];
+        switch (escape)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            out.push_back(escape);
+            break;
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'u':
+        {
+            if (i + 4 > text.size())
+            {
+                return false;
+            }
+            const std::string hex = text.substr(i, 4);
+            i += 4;
+            const auto is_hex = [](char h) { return std::isxdigit(static_cast<unsigned char>(h)) != 0; };
+            if (!std::all_of(hex.begin(), hex.end(), is_hex))
+            {
+                return false;
+            }
+            const auto code = static_cast<unsigned int>(std::strtoul(hex.c_str(), nullptr, 16));
+            if (code >= 0xD800 && code <= 0xDFFF)
+            {
+                return false;
+            }
+            append_utf8(out, code);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+// A number, true, false or null, copied as written.
+bool parse_scalar(const std::string& text, size_t& i, std::string& out)
+{
+    const size_t start = i;
+    while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '-' ||
+                               text[i] == '+' || text[i] == '.'))
+    {
+        ++i;
+    }
+    out = text.substr(start, i - start);
+    if (out == "true" || out == "false" || out == "null")
+    {
+        return true;
+    }
+    if (out.empty() || !(out[0] == '-' || std::isdigit(static_cast<unsigned char>(out[0]))))
+    {
+        return false;
+    }
+    char* end = nullptr;
+    std::strtod(out.c_str(), &end);
+    return *end == '\0';
+}
+
+std::string error_reply(const std::string& error)
+{
+    return "{\"reply\":null,\"ok\":false,\"error\":" + json_string(error) + "}";
+}
+
+bool would_block(int err)
+{
+    return err == EAGAIN || err == EWOULDBLOCK;
+}
+} // namespace
+
+const std::string* ControlRequest::find(const char* key) const
+{
+    for (const auto& field : fields)
+    {
+        if (field.first == key)
+        {
+            return &field.second;
+        }
+    }
+    return nullptr;
+}
+
+bool parse_control_request(const std::string& line, ControlRequest& request, std::string& error)
+{
+    request = ControlRequest{};
+    size_t i = 0;
+    skip_space(line, i);
+    if (i >= line.size() || line[i] != '{')
+    {
+        error = "expected a JSON object";
+        return false;
+    }
+    ++i;
+    skip_space(line, i);
+    bool have_cmd = false;
+    if (i < line.size() && line[i] == '}')
+    {
+        ++i;
+    }
+    else
+    {
+        for (;;)
+        {
+            skip_space(line, i);
+            std::string key;
+            if (i >= line.size() || line[i] != '"' || !parse_string(line, i, key))
+            {
+                error = "expected a member name";
+                return false;
+            }
+            skip_space(line, i);
+            if (i >= line.size() || line[i] != ':')
+            {
+                error = "expected ':' after \"" + key + "\"";
+                return false;
+            }
+            ++i;
+            skip_space(line, i);
+            std::string value;
+            const bool is_string = i < line.size() && line[i] == '"';
+            if (i < line.size() && (line[i] == '{' || line[i] == '['))
+            {
+                error = "\"" + key + "\": objects and arrays are not supported";
+                return false;
+            }
+            if (is_string ? !parse_string(line, i, value) : !parse_scalar(line, i, value))
+            {
+                error = "\"" + key + "\": malformed value";
+                return false;
+            }
+            if (key == "cmd")
+            {
+                if (!is_string)
+                {
+                    error = "\"cmd\" must be a string";
+                    return false;
+                }
+                request.cmd = value;
+                have_cmd = true;
+            }
+            else
+            {
+                request.fields.emplace_back(std::move(key), std::move(value));
+            }
+            skip_space(line, i);
+            if (i < line.size() && line[i] == ',')
+            {
+                ++i;
+                continue;
+            }
+            if (i < line.size() && line[i] == '}')
+            {
+                ++i;
+                break;
+            }
+            error = "expected ',' or '}'";
+            return false;
+        }
+    }
+    skip_space(line, i);
+    if (i != line.size())
+    {
+        error = "trailing characters after the object";
+        return false;
+    }
+    if (!have_cmd)
+    {
+        error = "missing \"cmd\"";
+        return false;
+    }
+    return true;
+}
+
+std::string json_string(const std::string& text)
+{
+    std::string out;
+    out.reserve(text.size() + 2);
+    out.push_back('"');
+    for (const char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                out += escaped;
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+ControlSocket::~ControlSocket()
+{
+    close();
+}
+
+bool ControlSocket::open(const std::string& path)
+{
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "sensor-daemon: control socket path must be 1-" << sizeof(addr.sun_path) - 1 << " characters"
+                  << std::endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    const auto* address = reinterpret_cast<const sockaddr*>(&addr);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+    {
+        std::cerr << "sensor-daemon: socket failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int rc = bind(listen_fd_, address, sizeof(addr));
+    if (rc != 0 && errno == EADDRINUSE)
+    {
+        // Left behind by a daemon that did not shut down cleanly, unless one still answers on it
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool answered = probe >= 0 && connect(probe, address, sizeof(addr)) == 0;
+        if (probe >= 0)
+        {
+            ::close(probe);
+        }
+        if (answered)
+        {
+            std::cerr << "sensor-daemon: another daemon is listening on " << path << std::endl;
+            close();
+            return false;
+        }
+        unlink(path.c_str());
+        rc = bind(listen_fd_, address, sizeof(addr));
+    }
+    if (rc != 0 || listen(listen_fd_, static_cast<int>(kMaxClients)) != 0)
+    {
+        std::cerr << "sensor-daemon: cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    path_ = path;
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0)
+    {
+        std::cerr << "sensor-daemon: eventfd failed: " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ControlSocket::close()
+{
+    for (Client& client : clients_)
+    {
+        ::close(client.fd);
+    }
+    clients_.clear();
+    client_count_.store(0, std::memory_order_relaxed);
+    if (listen_fd_ >= 0)
+    {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    if (!path_.empty())
+    {
+        unlink(path_.c_str());
+        path_.clear();
+    }
+    if (wake_fd_ >= 0)
+    {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void ControlSocket::broadcast(std::string line)
+{
+    if (client_count_.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() >= kMaxPendingLines)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pending_.push_back(std::move(line));
+    }
+    const uint64_t one = 1;
+    (void)write(wake_fd_, &one, sizeof(one));
+}
+
+void ControlSocket::run(const std::atomic<bool>& stop, const Handler& handler)
+{
+    std::vector<pollfd> fds;
+    std::vector<std::string> lines;
+    while (!stop.load())
+    {
+        fds.clear();
+        fds.push_back(pollfd{listen_fd_, POLLIN, 0});
+        fds.push_back(pollfd{wake_fd_, POLLIN, 0});
+        for (const Client& client : clients_)
+        {
+            // A client at EOF stays readable; only wait for room to write to it
+            const short events = static_cast<short>((client.closing ? 0 : POLLIN) | (client.out.empty() ? 0 : POLLOUT));
+            fds.push_back(pollfd{client.fd, events, 0});
+        }
+        if (poll(fds.data(), fds.size(), kPollMs) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "sensor-daemon: poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            uint64_t count;
+            (void)read(wake_fd_, &count, sizeof(count));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            lines.swap(pending_);
+        }
+        for (const std::string& line : lines)
+        {
+            for (Client& client : clients_)
+            {
+                queue(client, line, false);
+            }
+        }
+        lines.clear();
+
+        for (size_t k = 0; k < clients_.size(); ++k)
+        {
+            if (fds[k + 2].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                read_requests(clients_[k], handler);
+            }
+        }
+        // After the loop above, whose indices follow the clients polled
+        if (fds[0].revents & POLLIN)
+        {
+            accept_clients();
+        }
+        for (Client& client : clients_)
+        {
+            flush(client);
+        }
+        for (size_t k = clients_.size(); k-- > 0;)
+        {
+            const Client& client = clients_[k];
+            if (client.failed || (client.closing && client.out.empty()))
+            {
+                ::close(client.fd);
+                clients_.erase(clients_.begin() + static_cast<std::ptrdiff_t>(k));
+            }
+        }
+        client_count_.store(clients_.size(), std::memory_order_relaxed);
+    }
+}
+
+void ControlSocket::accept_clients()
+{
+    for (;;)
+    {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (!would_block(errno))
+            {
+                std::cerr << "sensor-daemon: accept failed: " << std::strerror(errno) << std::endl;
+            }
+            break;
+        }
+        if (clients_.size() >= kMaxClients)
+        {
+            const std::string busy = error_reply("too many clients") + "\n";
+            (void)send(fd, busy.data(), busy.size(), MSG_NOSIGNAL);
+            ::close(fd);
+            continue;
+        }
+        Client client;
+        client.fd = fd;
+        clients_.push_back(std::move(client));
+    }
+    client_count_.store(clients_.size(), std::memory_order_relaxed);
+}
+
+void ControlSocket::read_requests(Client& client, const Handler& handler)
+{
+    // One read per wake-up, so a client that floods requests shares the thread with the others
+    char buffer[4096];
+    const ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (n == 0)
+    {
+        client.closing = true;
+    }
+    else if (n < 0)
+    {
+        if (errno != EINTR && !would_block(errno))
+        {
+            client.failed = true;
+        }
+        return;
+    }
+    client.in.append(buffer, static_cast<size_t>(n));
+
+    size_t start = 0;
+    size_t newline;
+    while ((newline = client.in.find('\n', start)) != std::string::npos)
+    {
+        std::string line = client.in.substr(start, newline - start);
+        start = newline + 1;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        ControlRequest request;
+        std::string error;
+        queue(client, parse_control_request(line, request, error) ? handler(request) : error_reply(error), true);
+    }
+    client.in.erase(0, start);
+    if (client.in.size() > kMaxLineBytes)
+    {
+        queue(client, error_reply("request longer than " + std::to_string(kMaxLineBytes) + " bytes"), true);
+        client.in.clear();
+        client.closing = true;
+    }
+}
+
+void ControlSocket::queue(Client& client, const std::string& line, bool reply)
+{
+    if (client.failed || (client.closing && !reply))
+    {
+        return;
+    }
+    // Replies always go out; events only while the client keeps up
+    if (!reply && client.out.size() + line.size() + 1 > kMaxBacklogBytes)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    client.out += line;
+    client.out.push_back('\n');
+}
+
+void ControlSocket::flush(Client& client)
+{
+    while (!client.out.empty() && !client.failed)
+    {
+        const ssize_t n = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            client.out.erase(0, static_cast<size_t>(n));
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n < 0 && would_block(errno))
+        {
+            break;
+        }
+        else
+        {
+            client.failed = true;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Control and event socket of sensor-daemon: an AF_UNIX stream socket carrying one JSON object per line in
+// both directions. Clients send requests, {"cmd":"start"} and the like; each gets one reply line, and every
+// client also receives every event line. A client that stops reading loses events (counted in dropped())
+// once its backlog is full, so a stuck reader never holds up the sensor threads or the other clients.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One request line, {"cmd":"reconfigure","wake_mm":500,...}. Values are flat: strings, numbers, booleans
+// and null; arrays and objects are rejected, so lists travel as strings ("300,600") like on the command line.
+struct ControlRequest
+{
+    std::string cmd;
+    // Every other member in order, as text: strings unescaped, numbers, true/false and null as written.
+    std::vector<std::pair<std::string, std::string>> fields;
+
+    // Null when the request has no such member.
+    const std::string* find(const char* key) const;
+};
+
+// False, with `error` set, for anything but a flat JSON object with a string "cmd".
+bool parse_control_request(const std::string& line, ControlRequest& request, std::string& error);
+
+// `text` as a quoted JSON string.
+std::string json_string(const std::string& text);
+
+class ControlSocket
+{
+  public:
+    // Gets every well-formed request and returns its reply, one JSON object without the newline.
+    using Handler = std::function<std::string(const ControlRequest&)>;
+
+    static constexpr size_t kMaxClients = 16;
+    static constexpr size_t kMaxLineBytes = 4096;           // longer requests close the connection
+    static constexpr size_t kMaxBacklogBytes = 256 * 1024;  // per client: unsent replies and events
+    static constexpr size_t kMaxPendingLines = 4096;        // broadcast lines the serving thread has not taken yet
+
+    ControlSocket() = default;
+    ~ControlSocket();
+
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    // Listens on `path`. A socket file nobody answers on is replaced; one a live daemon answers on is not.
+    // Failures are reported on stderr.
+    bool open(const std::string& path);
+    // Disconnects every client and removes the socket file.
+    void close();
+
+    // Any thread: queues one event line (no newline) for every connected client. Cheap without clients.
+    void broadcast(std::string line);
+
+    // Accepts clients, answers their requests through `handler` (on this thread) and sends the queued events
+    // until `stop` turns true; checks it at least every 100 ms.
+    void run(const std::atomic<bool>& stop, const Handler& handler);
+
+    size_t clients() const { return client_count_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  private:
+    struct Client
+    {
+        int fd = -1;
+        std::string in;        // bytes of an unfinished request line
+        std::string out;       // not yet written
+        bool closing = false;  // reached EOF: still gets its replies, no more events
+        bool failed = false;   // gone; dropped without flushing
+    };
+
+    void accept_clients();
+    void read_requests(Client& client, const Handler& handler);
+    void queue(Client& client, const std::string& line, bool reply);
+    void flush(Client& client);
+
+    std::string path_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;  // eventfd: broadcast() wakes run()
+    std::vector<Client> clients_;  // run() only
+    std::mutex mutex_;
+    std::vector<std::string> pending_;  // guarded by mutex_
+    std::atomic<size_t> client_count_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
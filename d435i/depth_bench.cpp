@@ -0,0 +1,251 @@
+// Microbenchmarks for d435i_liveness_core: ROI sampling (SIMD and scalar), the statistics on top of it
+// and the per-frame liveness math, plus the preview encoder when it is built.
+// Build the `bench` target to run them and write d435i-bench.json.
+
+#include "depth_roi.hpp"
+#include "liveness_core.hpp"
+#include "temporal_liveness.hpp"
+#ifdef D435I_HAVE_PREVIEW
+#include "preview_encoder.hpp"
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+constexpr int kWidth = 640;
+constexpr int kHeight = 480;
+
+// A face-like bump on a flat background with ~3% holes, so zero-skipping and the histogram see real data.
+const std::vector<uint16_t>& synthetic_depth()
+{
+    static const std::vector<uint16_t> frame = [] {
+        std::vector<uint16_t> d(static_cast<size_t>(kWidth) * kHeight);
+        uint32_t seed = 12345;
+        for (int y = 0; y < kHeight; ++y)
+        {
+            for (int x = 0; x < kWidth; ++x)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                const double r = std::hypot(x - kWidth / 2.0, y - kHeight / 2.0);
+                const double depth = 600.0 + r * r * 0.002 + static_cast<double>(seed >> 28);
+                d[static_cast<size_t>(y) * kWidth + x] = ((seed >> 8) % 32 == 0) ? 0 : static_cast<uint16_t>(depth);
+            }
+        }
+        return d;
+    }();
+    return frame;
+}
+
+DepthRoi bench_roi(const benchmark::State& state)
+{
+    return central_roi(kWidth, kHeight, static_cast<float>(state.range(1)) / 100.0f);
+}
+
+void set_pixel_counters(benchmark::State& state, const DepthRoi& roi, unsigned int step, uint64_t samples)
+{
+    const uint64_t visited = static_cast<uint64_t>((roi.width + step - 1) / step) * ((roi.height + step - 1) / step);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * visited));
+    state.counters["valid_samples"] = static_cast<double>(samples);
+}
+
+// Args: {step, ROI percent of each dimension}
+void step_and_roi_args(benchmark::internal::Benchmark* b)
+{
+    for (int step : {1, 2, 4, 8})
+    {
+        for (int roi_percent : {20, 40, 100})
+        {
+            b->Args({step, roi_percent});
+        }
+    }
+}
+
+void BM_AccumulateDepthRoi(benchmark::State& state)
+{
+    const auto& frame = synthetic_depth();
+    const unsigned int step = static_cast<unsigned int>(state.range(0));
+    const DepthRoi roi = bench_roi(state);
+    DepthRoiSums sums;
+    for (auto _ : state)
+    {
+        sums = accumulate_depth_roi(frame.data(), kWidth * sizeof(uint16_t), roi, step);
+        benchmark::DoNotOptimize(sums);
+    }
+    set_pixel_counters(state, roi, step, sums.count);
+}
+BENCHMARK(BM_AccumulateDepthRoi)->Apply(step_and_roi_args);
+
+void BM_AccumulateDepthRoiScalar(benchmark::State& state)
+{
+    const auto& frame = synthetic_depth();
+    const unsigned int step = static_cast<unsigned int>(state.range(0));
+    const DepthRoi roi = bench_roi(state);
+    DepthRoiSums sums;
+    for (auto _ : state)
+    {
+        sums = accumulate_depth_roi_scalar(frame.data(), kWidth * sizeof(uint16_t), roi, step);
+        benchmark::DoNotOptimize(sums);
+    }
+    set_pixel_counters(state, roi, step, sums.count);
+}
+BENCHMARK(BM_AccumulateDepthRoiScalar)->Apply(step_and_roi_args);
+
+// What d435i-liveness does per frame: sample_depth_patch() with the histogram, then compute_stats().
+void BM_DepthRoiStats(benchmark::State& state)
+{
+    const auto& frame = synthetic_depth();
+    const unsigned int step = static_cast<unsigned int>(state.range(0));
+    const DepthRoi roi = bench_roi(state);
+    DepthHistogram histogram;
+    DepthRoiSums sums;
+    for (auto _ : state)
+    {
+        sums = accumulate_depth_roi(frame.data(), kWidth * sizeof(uint16_t), roi, step, &histogram);
+        DepthStats stats = compute_depth_stats(sums, histogram, 0.001f, 0.05);
+        benchmark::DoNotOptimize(stats);
+    }
+    set_pixel_counters(state, roi, step, sums.count);
+}
+BENCHMARK(BM_DepthRoiStats)->Apply(step_and_roi_args);
+
+// compute_stats() alone: percentile lookups over a filled histogram.
+void BM_ComputeDepthStats(benchmark::State& state)
+{
+    const auto& frame = synthetic_depth();
+    const DepthRoi roi = central_roi(kWidth, kHeight, 0.4f);
+    DepthHistogram histogram;
+    const DepthRoiSums sums = accumulate_depth_roi(frame.data(), kWidth * sizeof(uint16_t), roi, 4, &histogram);
+    for (auto _ : state)
+    {
+        DepthStats stats = compute_depth_stats(sums, histogram, 0.001f, 0.05);
+        benchmark::DoNotOptimize(stats);
+    }
+}
+BENCHMARK(BM_ComputeDepthStats);
+
+// Face-sized ROI at a fixed sample budget; the cost should stay flat as the face grows.
+void BM_AdaptiveStrideFace(benchmark::State& state)
+{
+    const auto& frame = synthetic_depth();
+    const int side = static_cast<int>(state.range(0));
+    const DepthRoi roi{(kWidth - side) / 2, (kHeight - side) / 2, side, side};
+    const unsigned int step = adaptive_step(roi, 1500);
+    DepthHistogram histogram;
+    DepthRoiSums sums;
+    for (auto _ : state)
+    {
+        sums = accumulate_depth_roi(frame.data(), kWidth * sizeof(uint16_t), roi, adaptive_step(roi, 1500),
+                                    &histogram);
+        benchmark::DoNotOptimize(sums);
+    }
+    state.counters["step"] = step;
+    state.counters["valid_samples"] = static_cast<double>(sums.count);
+}
+BENCHMARK(BM_AdaptiveStrideFace)->Arg(80)->Arg(160)->Arg(320)->Arg(480);
+
+void BM_ComputeDepthMetrics(benchmark::State& state)
+{
+    const auto& frame = synthetic_depth();
+    const LivenessThresholds thresholds;
+    const FaceBox box{220, 140, 420, 340};
+    const int stride = static_cast<int>(state.range(0));
+    for (auto _ : state)
+    {
+        auto metrics = compute_depth_metrics(frame.data(), kWidth, kHeight, kWidth * sizeof(uint16_t), 0.001f, box,
+                                             stride, thresholds);
+        benchmark::DoNotOptimize(metrics);
+    }
+}
+BENCHMARK(BM_ComputeDepthMetrics)->Arg(1)->Arg(3)->Arg(6);
+
+void BM_TemporalLivenessUpdate(benchmark::State& state)
+{
+    TemporalLivenessConfig config;
+    config.window_s = static_cast<double>(state.range(0));
+    TemporalLiveness window(config);
+    double t = 0.0;
+    uint32_t seed = 1;
+    for (auto _ : state)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        t += 1.0 / 30.0;
+        const double jitter = static_cast<double>(seed >> 24) * 1e-4;
+        benchmark::DoNotOptimize(window.update(t, true, 0.04 + jitter, 0.01 + jitter, 0.6 + jitter));
+    }
+}
+BENCHMARK(BM_TemporalLivenessUpdate)->Arg(1)->Arg(4);
+
+#ifdef D435I_HAVE_PREVIEW
+// Smooth gradients with some noise, about what a preview JPEG of a face in a room compresses like.
+const std::vector<uint8_t>& synthetic_color()
+{
+    static const std::vector<uint8_t> frame = [] {
+        std::vector<uint8_t> c(static_cast<size_t>(kWidth) * kHeight * 3);
+        uint32_t seed = 54321;
+        for (int y = 0; y < kHeight; ++y)
+        {
+            for (int x = 0; x < kWidth; ++x)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                uint8_t* p = &c[(static_cast<size_t>(y) * kWidth + x) * 3];
+                const uint8_t noise = static_cast<uint8_t>(seed >> 29);
+                p[0] = static_cast<uint8_t>(x / 3 + noise);
+                p[1] = static_cast<uint8_t>(y / 2 + noise);
+                p[2] = static_cast<uint8_t>((x + y) / 5 + noise);
+            }
+        }
+        return c;
+    }();
+    return frame;
+}
+
+void BM_DownscaleBgr(benchmark::State& state)
+{
+    const auto& frame = synthetic_color();
+    const int width = static_cast<int>(state.range(0));
+    const int height = width * kHeight / kWidth;
+    std::vector<uint8_t> out(static_cast<size_t>(width) * height * 3);
+    for (auto _ : state)
+    {
+        downscale_bgr(frame.data(), kWidth, kHeight, kWidth * 3, out.data(), width, height);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK(BM_DownscaleBgr)->Arg(320)->Arg(256);
+
+// submit() plus the wait for its JPEG, i.e. end-to-end preview latency per frame; Arg = output width.
+void BM_PreviewEncode(benchmark::State& state)
+{
+    const auto& frame = synthetic_color();
+    PreviewEncoderConfig config;
+    config.width = static_cast<int>(state.range(0));
+    config.nice = 0;
+    PreviewEncoder encoder(config);
+    uint64_t sequence = 0;
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        encoder.submit(frame.data(), kWidth, kHeight, kWidth * 3);
+        auto jpeg = encoder.wait_newer(sequence, std::chrono::milliseconds(1000));
+        if (!jpeg)
+        {
+            state.SkipWithError("encoder produced no frame");
+            break;
+        }
+        sequence = jpeg->sequence;
+        bytes = jpeg->jpeg.size();
+    }
+    state.counters["jpeg_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_PreviewEncode)->Arg(640)->Arg(320)->UseRealTime();
+#endif
+
+} // namespace
+
+BENCHMARK_MAIN();
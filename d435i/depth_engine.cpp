@@ -0,0 +1,226 @@
+#include "depth_engine.hpp"
+
+#include <librealsense2/rsutil.h>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+// Maps a box given in color pixels onto the native depth image, assuming the target sits at assumed_depth_m.
+// The parallax between the two imagers only shifts the box by a few pixels over the working range,
+// so one mapping at startup replaces reprojecting the whole depth frame with rs2::align every frame.
+DepthRoi map_color_roi_to_depth(const DepthRoi& color_box, const rs2_intrinsics& color_intrin,
+                                const rs2_intrinsics& depth_intrin, const rs2_extrinsics& color_to_depth,
+                                float assumed_depth_m)
+{
+    float min_x = static_cast<float>(depth_intrin.width);
+    float min_y = static_cast<float>(depth_intrin.height);
+    float max_x = 0.0f;
+    float max_y = 0.0f;
+    const float xs[2] = {static_cast<float>(color_box.x0), static_cast<float>(color_box.x0 + color_box.width)};
+    const float ys[2] = {static_cast<float>(color_box.y0), static_cast<float>(color_box.y0 + color_box.height)};
+    for (float cx : xs)
+    {
+        for (float cy : ys)
+        {
+            const float color_pixel[2] = {cx, cy};
+            float color_point[3];
+            float depth_point[3];
+            float depth_pixel[2];
+            rs2_deproject_pixel_to_point(color_point, &color_intrin, color_pixel, assumed_depth_m);
+            rs2_transform_point_to_point(depth_point, &color_to_depth, color_point);
+            rs2_project_point_to_pixel(depth_pixel, &depth_intrin, depth_point);
+            min_x = std::min(min_x, depth_pixel[0]);
+            min_y = std::min(min_y, depth_pixel[1]);
+            max_x = std::max(max_x, depth_pixel[0]);
+            max_y = std::max(max_y, depth_pixel[1]);
+        }
+    }
+
+    DepthRoi roi;
+    roi.x0 = std::clamp(static_cast<int>(std::floor(min_x)), 0, depth_intrin.width);
+    roi.y0 = std::clamp(static_cast<int>(std::floor(min_y)), 0, depth_intrin.height);
+    roi.width = std::clamp(static_cast<int>(std::ceil(max_x)), roi.x0, depth_intrin.width) - roi.x0;
+    roi.height = std::clamp(static_cast<int>(std::ceil(max_y)), roi.y0, depth_intrin.height) - roi.y0;
+    return roi;
+}
+
+// Samples the ROI straight from the Z16 buffer instead of calling get_distance() per pixel.
+DepthRoiSums sample_depth_patch(const rs2::depth_frame& depth, const DepthRoi& roi, unsigned int stride,
+                                DepthHistogram& histogram)
+{
+    const auto* data = static_cast<const uint16_t*>(depth.get_data());
+    return accumulate_depth_roi(data, static_cast<size_t>(depth.get_stride_in_bytes()), roi, stride, &histogram);
+}
+
+bool evaluate_liveness(const DepthStats& stats, double min_range_m, double min_stdev_m, size_t min_samples)
+{
+    if (stats.count < min_samples)
+    {
+        return false;
+    }
+    // Trimmed range so a few flying pixels at depth edges cannot fake relief on a flat target
+    const double range = stats.p_high - stats.p_low;
+    return (range >= min_range_m) && (stats.stdev >= min_stdev_m);
+}
+
+// Pixels apart, in both directions, that the settle check samples the ROI at; it only needs the fill fraction.
+constexpr unsigned int kSettleStep = 8;
+
+} // namespace
+
+TemporalLiveness make_temporal_liveness(const LivenessConfig& config)
+{
+    TemporalLivenessConfig window;
+    window.window_s = config.window_s;
+    window.min_range_m = config.min_range_m;
+    window.min_stdev_m = config.min_stdev_m;
+    return TemporalLiveness(window);
+}
+
+DepthRoi fit_roi(const RoiSpec& spec, int width, int height)
+{
+    if ((width == spec.width && height == spec.height) || spec.width <= 0 || spec.height <= 0)
+    {
+        return spec.roi;
+    }
+    const double sx = static_cast<double>(width) / spec.width;
+    const double sy = static_cast<double>(height) / spec.height;
+    DepthRoi roi;
+    roi.x0 = std::clamp(static_cast<int>(std::floor(spec.roi.x0 * sx)), 0, width);
+    roi.y0 = std::clamp(static_cast<int>(std::floor(spec.roi.y0 * sy)), 0, height);
+    roi.width = std::clamp(static_cast<int>(std::ceil((spec.roi.x0 + spec.roi.width) * sx)), roi.x0, width) - roi.x0;
+    roi.height =
+        std::clamp(static_cast<int>(std::ceil((spec.roi.y0 + spec.roi.height) * sy)), roi.y0, height) - roi.y0;
+    return roi;
+}
+
+RoiSpec select_depth_roi(const rs2::pipeline_profile& profile, const LivenessConfig& config, bool full_align)
+{
+    auto color_profile = profile.get_stream(RS2_STREAM_COLOR).as<rs2::video_stream_profile>();
+    auto depth_profile = profile.get_stream(RS2_STREAM_DEPTH).as<rs2::video_stream_profile>();
+    const rs2_intrinsics color_intrin = color_profile.get_intrinsics();
+    const DepthRoi color_roi = central_roi(color_intrin.width, color_intrin.height, config.roi_ratio);
+    if (full_align)
+    {
+        return RoiSpec{color_roi, color_intrin.width, color_intrin.height};
+    }
+    const rs2_intrinsics depth_intrin = depth_profile.get_intrinsics();
+    DepthRoi depth_roi = map_color_roi_to_depth(color_roi, color_intrin, depth_intrin,
+                                                color_profile.get_extrinsics_to(depth_profile),
+                                                config.assumed_depth_m);
+    std::cout << "Sampling native depth ROI x=" << depth_roi.x0 << " y=" << depth_roi.y0
+              << " w=" << depth_roi.width << " h=" << depth_roi.height << std::endl;
+    return RoiSpec{depth_roi, depth_intrin.width, depth_intrin.height};
+}
+
+rs2::depth_frame prepare_depth(const rs2::frameset& frames, DepthFilterChain* filters, rs2::align* align_to_color)
+{
+    rs2::frameset prepared = frames;
+    if (filters)
+    {
+        prepared = filters->process(prepared).as<rs2::frameset>();
+    }
+    if (align_to_color)
+    {
+        prepared = align_to_color->process(prepared);
+    }
+    return prepared.get_depth_frame();
+}
+
+const TemporalLivenessState& update_window(TemporalLiveness& window, const FrameResult& result, size_t min_samples)
+{
+    const DepthStats& stats = result.stats;
+    return window.update(result.timestamp_s, stats.count >= min_samples, stats.p_high - stats.p_low, stats.stdev,
+                         stats.mean);
+}
+
+FrameResult evaluate_frame(const rs2::depth_frame& depth, const RoiSpec& spec, const LivenessConfig& config,
+                           DepthHistogram& histogram)
+{
+    FrameResult result;
+    const int width = depth.get_width();
+    const int height = depth.get_height();
+    const DepthRoi roi = fit_roi(spec, width, height);
+    // A decimated frame already dropped the pixels the software stride would have skipped
+    const unsigned int shrink =
+        (width > 0 && spec.width > width) ? static_cast<unsigned int>((spec.width + width / 2) / width) : 1;
+    const unsigned int stride = config.target_samples ? adaptive_step(roi, config.target_samples)
+                                                      : std::max(1u, config.stride / shrink);
+    auto sums = sample_depth_patch(depth, roi, stride, histogram);
+    result.stats = compute_depth_stats(sums, histogram, depth.get_units(), config.outlier_fraction);
+    result.alive = evaluate_liveness(result.stats, config.min_range_m, config.min_stdev_m, config.min_samples);
+    result.frame_number = depth.get_frame_number();
+    result.timestamp_s = depth.get_timestamp() / 1000.0;
+    return result;
+}
+
+bool update_settle(StreamSettle& settle, const rs2::frameset& frames, const RoiSpec& spec)
+{
+    double exposure = -1.0;
+    if (auto color = frames.get_color_frame())
+    {
+        if (color.supports_frame_metadata(RS2_FRAME_METADATA_ACTUAL_EXPOSURE))
+        {
+            exposure = static_cast<double>(color.get_frame_metadata(RS2_FRAME_METADATA_ACTUAL_EXPOSURE));
+        }
+    }
+    double fill = 0.0;
+    if (auto depth = frames.get_depth_frame())
+    {
+        const DepthRoi roi = fit_roi(spec, depth.get_width(), depth.get_height());
+        const auto* data = static_cast<const uint16_t*>(depth.get_data());
+        const DepthRoiSums sums =
+            accumulate_depth_roi(data, static_cast<size_t>(depth.get_stride_in_bytes()), roi, kSettleStep);
+        const uint64_t visited = static_cast<uint64_t>((roi.width + kSettleStep - 1) / kSettleStep) *
+                                 ((roi.height + kSettleStep - 1) / kSettleStep);
+        fill = visited ? static_cast<double>(sums.count) / static_cast<double>(visited) : 0.0;
+    }
+    return settle.update(exposure, fill);
+}
+
+double host_ms(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double, std::milli>(t.time_since_epoch()).count();
+}
+
+void map_frame_time(ClockMapper& clock, FrameResult& result, std::chrono::steady_clock::time_point arrived)
+{
+    clock.observe(result.timestamp_s * 1000.0, host_ms(arrived));
+    result.host_ms = clock.to_host_ms(result.timestamp_s * 1000.0);
+}
+
+void write_fused_fields(std::ostream& out, const FrameResult& result, const TemporalLivenessState& window,
+                        const ToFPairing& tof)
+{
+    const DepthStats& stats = result.stats;
+    out << std::fixed << std::setprecision(1) << "\"frame\":" << result.frame_number << ",\"t_ms\":" << result.host_ms;
+    if (tof.found)
+    {
+        out << ",\"tof_mm\":" << tof.distance_mm << ",\"tof_seq\":" << tof.sequence << ",\"skew_ms\":" << tof.skew_ms;
+    }
+    else
+    {
+        out << ",\"tof_mm\":null,\"tof_seq\":null,\"skew_ms\":null";
+    }
+    out << std::setprecision(4) << ",\"samples\":" << stats.count << ",\"mean_m\":" << stats.mean
+        << ",\"median_m\":" << stats.median << ",\"stdev_m\":" << stats.stdev
+        << ",\"range_m\":" << (stats.p_high - stats.p_low) << ",\"frame_live\":" << (result.alive ? "true" : "false")
+        << ",\"live\":" << (window.live ? "true" : "false");
+}
+
+bool parse_resolution(const char* text, int& width, int& height)
+{
+    int w = 0;
+    int h = 0;
+    char sep = 0;
+    if (std::sscanf(text, "%d%c%d", &w, &sep, &h) != 3 || (sep != 'x' && sep != 'X') || w <= 0 || h <= 0)
+    {
+        return false;
+    }
+    width = w;
+    height = h;
+    return true;
+}
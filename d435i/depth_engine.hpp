@@ -0,0 +1,143 @@
+#pragma once
+
+// Per-frame depth processing shared by d435i-liveness and sensor-daemon: the ROI on native depth pixels,
+// librealsense post-processing, the per-frame statistics and verdict, the settle check and the fused
+// ToF + depth event line.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#include <librealsense2/rs.hpp>
+
+#include "depth_roi.hpp"
+#include "sensor_fusion.hpp"
+#include "stream_settle.hpp"
+#include "temporal_liveness.hpp"
+
+// librealsense post-processing ahead of ROI sampling. Decimation shrinks the frame before anything
+// else touches it, so the optional smoothing filters and the ROI kernel only see 1/magnitude^2 of the pixels.
+struct DepthFilterConfig
+{
+    int decimation = 1;      // rs2::decimation_filter magnitude (2-8); 1 disables
+    bool spatial = false;    // edge-preserving spatial smoothing
+    bool temporal = false;   // per-pixel smoothing across frames
+    bool hole_fill = false;  // fill invalid pixels from their neighbours
+
+    bool enabled() const { return decimation > 1 || spatial || temporal || hole_fill; }
+};
+
+// Filters keep per-stream state (temporal history), so each processing thread owns its own chain.
+// Order follows the librealsense post-processing guide: decimation, spatial and temporal in the
+// disparity domain, then hole filling.
+class DepthFilterChain
+{
+  public:
+    explicit DepthFilterChain(const DepthFilterConfig& config)
+        : config_(config), decimation_(static_cast<float>(std::max(config.decimation, 1)))
+    {
+    }
+
+    // Accepts a depth frame or a frameset; a frameset comes back as a frameset with its depth filtered.
+    rs2::frame process(rs2::frame frame)
+    {
+        if (config_.decimation > 1)
+        {
+            frame = decimation_.process(frame);
+        }
+        if (config_.spatial || config_.temporal)
+        {
+            frame = to_disparity_.process(frame);
+            if (config_.spatial)
+            {
+                frame = spatial_.process(frame);
+            }
+            if (config_.temporal)
+            {
+                frame = temporal_.process(frame);
+            }
+            frame = to_depth_.process(frame);
+        }
+        if (config_.hole_fill)
+        {
+            frame = hole_fill_.process(frame);
+        }
+        return frame;
+    }
+
+  private:
+    DepthFilterConfig config_;
+    rs2::decimation_filter decimation_;
+    rs2::disparity_transform to_disparity_{true};
+    rs2::spatial_filter spatial_;
+    rs2::temporal_filter temporal_;
+    rs2::disparity_transform to_depth_{false};
+    rs2::hole_filling_filter hole_fill_;
+};
+
+// Tuning shared by the blocking loop, the pipeline mode and sensor-daemon.
+struct LivenessConfig
+{
+    float roi_ratio = 0.4f;          // central 40% area
+    float assumed_depth_m = 0.6f;    // typical kiosk working distance for mapping the ROI
+    unsigned int stride = 4;         // subsample to reduce work; divided by the decimation factor
+    double min_range_m = 0.04;       // reject flats with <4 cm depth variation
+    double min_stdev_m = 0.01;       // require 1 cm standard deviation
+    size_t min_samples = 250;        // minimum valid depth samples in ROI
+    double outlier_fraction = 0.05;  // ignore the nearest and farthest 5% for the range check
+    double window_s = 1.0;           // temporal window behind the printed LIVE/FLAT decision
+    size_t target_samples = 0;       // when set, replaces stride with one that visits about this many pixels
+    DepthFilterConfig filters;
+};
+
+TemporalLiveness make_temporal_liveness(const LivenessConfig& config);
+
+// A ROI together with the size of the image it was defined on, so it can follow decimated frames.
+struct RoiSpec
+{
+    DepthRoi roi;
+    int width = 0;
+    int height = 0;
+};
+
+// Rescales the ROI onto a frame of width x height; a no-op for frames of the original size.
+DepthRoi fit_roi(const RoiSpec& spec, int width, int height);
+
+// The ROI is defined on the color image; without alignment it is mapped to native depth pixels once.
+RoiSpec select_depth_roi(const rs2::pipeline_profile& profile, const LivenessConfig& config, bool full_align);
+
+// Filters (when configured) and optional alignment, in the order the ROI mapping expects.
+rs2::depth_frame prepare_depth(const rs2::frameset& frames, DepthFilterChain* filters, rs2::align* align_to_color);
+
+struct FrameResult
+{
+    DepthStats stats;
+    bool alive = false;
+    unsigned long long frame_number = 0;
+    double timestamp_s = 0.0;  // device frame timestamp
+    double host_ms = 0.0;      // the same instant on the host steady clock, the ToF's timeline
+};
+
+// Folds one per-frame result into the window; O(1) regardless of the window length.
+const TemporalLivenessState& update_window(TemporalLiveness& window, const FrameResult& result, size_t min_samples);
+
+FrameResult evaluate_frame(const rs2::depth_frame& depth, const RoiSpec& spec, const LivenessConfig& config,
+                           DepthHistogram& histogram);
+
+// Feeds one raw frameset to the settle detector: the color frame's actual exposure (when the camera reports
+// it) and the fraction of ROI pixels with depth. Returns true once the stream has settled.
+bool update_settle(StreamSettle& settle, const rs2::frameset& frames, const RoiSpec& spec);
+
+double host_ms(std::chrono::steady_clock::time_point t);
+
+// Puts the frame on the host clock, learning the camera-to-host offset from its arrival time.
+void map_frame_time(ClockMapper& clock, FrameResult& result, std::chrono::steady_clock::time_point arrived);
+
+// The members (no braces) of one fused event: frame, host time, the paired ToF reading or nulls, the ROI
+// statistics and both verdicts. d435i-liveness --fuse-shm prints them as one JSON object per frame.
+void write_fused_fields(std::ostream& out, const FrameResult& result, const TemporalLivenessState& window,
+                        const ToFPairing& tof);
+
+// Parses "WxH", e.g. "424x240".
+bool parse_resolution(const char* text, int& width, int& height);
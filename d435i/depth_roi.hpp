@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Integer accumulators over the valid (non-zero) Z16 samples of a depth ROI.
+// Values are in raw depth units; multiply by rs2::depth_frame::get_units() to get meters.
+struct DepthRoiSums
+{
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint16_t min = 0;  // 0 when count == 0
+    uint16_t max = 0;
+};
+
+struct DepthRoi
+{
+    int x0 = 0;
+    int y0 = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Per-value counts of raw Z16 samples for percentiles without sorting.
+// The 65536 bins are allocated once; clear() only touches the range seen since the last clear.
+class DepthHistogram
+{
+  public:
+    DepthHistogram();
+
+    void add(uint16_t value)
+    {
+        ++bins_[value];
+        ++total_;
+        lo_ = (value < lo_) ? value : lo_;
+        hi_ = (value > hi_) ? value : hi_;
+    }
+    void clear();
+    uint64_t total() const { return total_; }
+
+    // Smallest value with at least `fraction` (0..1) of the samples at or below it; 0 when empty.
+    uint16_t percentile(double fraction) const;
+    uint16_t median() const { return percentile(0.5); }
+
+  private:
+    std::vector<uint32_t> bins_;
+    uint64_t total_ = 0;
+    uint16_t lo_ = UINT16_MAX;
+    uint16_t hi_ = 0;
+};
+
+// ROI statistics in meters.
+struct DepthStats
+{
+    double mean = 0.0;
+    double stdev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double median = 0.0;
+    double p_low = 0.0;   // outlier-trimmed bounds, see compute_depth_stats()
+    double p_high = 0.0;
+    size_t count = 0;
+};
+
+// Converts integer ROI sums to meters; depth units are applied exactly once here.
+// p_low/p_high are the outlier_fraction and 1 - outlier_fraction percentiles of the histogram.
+DepthStats compute_depth_stats(const DepthRoiSums& sums, const DepthHistogram& histogram, float depth_unit,
+                               double outlier_fraction);
+
+// Central ROI covering roi_ratio of each image dimension.
+DepthRoi central_roi(int image_width, int image_height, float roi_ratio);
+
+// The box [x0, x1) x [y0, y1) clipped to the image.
+DepthRoi clip_roi(int x0, int y0, int x1, int y1, int image_width, int image_height);
+
+// Bounding box of `count` interleaved (x, y) pixel points, e.g. face landmarks projected into the depth image,
+// grown by margin_ratio of its size on every side and clipped to the image. Empty when count == 0.
+DepthRoi roi_from_points(const float* xy, size_t count, int image_width, int image_height, float margin_ratio = 0.1f);
+
+// Smallest step at which a step-strided scan of `roi` visits at most target_samples pixels, so the cost
+// of sampling a face stays roughly constant whether it fills the frame or sits far from the camera.
+// Returns 1 when target_samples is 0 or the ROI is already small enough.
+unsigned int adaptive_step(const DepthRoi& roi, size_t target_samples);
+
+// Accumulates every `step`-th pixel of every `step`-th row of `roi`, skipping zeros (no depth).
+// `data` points at the first pixel of a Z16 image whose rows are `stride_bytes` apart.
+// Uses SSE2 or NEON when available for steps of 1 and 2, and a scalar loop otherwise.
+// When `histogram` is given it is cleared and filled with the same samples in the same scan.
+DepthRoiSums accumulate_depth_roi(const uint16_t* data, size_t stride_bytes, const DepthRoi& roi, unsigned int step,
+                                  DepthHistogram* histogram = nullptr);
+
+// Portable reference implementation of accumulate_depth_roi().
+DepthRoiSums accumulate_depth_roi_scalar(const uint16_t* data, size_t stride_bytes, const DepthRoi& roi,
+                                         unsigned int step, DepthHistogram* histogram = nullptr);
@@ -0,0 +1,434 @@
+// Python bindings for d435i_liveness_core.
+//
+// Frames are read through the buffer protocol, so a NumPy array or a pyrealsense2 frame
+// (anything with get_data()) is used in place without a copy. All per-frame math runs with
+// the GIL released. PreviewEncoder is included when d435i_preview was built (libjpeg found).
+
+#include "depth_roi.hpp"
+#include "liveness_core.hpp"
+#ifdef D435I_HAVE_PREVIEW
+#include "preview_encoder.hpp"
+#endif
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace
+{
+// A borrowed 2-D (or HxWx3) pixel buffer; `owner` keeps the exporting object alive while we read it.
+struct FrameView
+{
+    py::object owner;
+    py::buffer_info info;
+    int width = 0;
+    int height = 0;
+    size_t stride_bytes = 0;
+};
+
+FrameView view_frame(const py::object& frame, const char* what, char format, size_t itemsize, int channels)
+{
+    FrameView view;
+    view.owner = py::hasattr(frame, "get_data") ? frame.attr("get_data")() : frame;
+    view.info = py::reinterpret_borrow<py::buffer>(view.owner).request();
+
+    const py::buffer_info& info = view.info;
+    const py::ssize_t expected_ndim = (channels == 1) ? 2 : 3;
+    if (info.itemsize != static_cast<py::ssize_t>(itemsize) || info.format.empty() ||
+        info.format.back() != format)
+    {
+        throw py::type_error(std::string(what) + " must be a " + (format == 'H' ? "uint16" : "uint8") + " buffer");
+    }
+    if (info.ndim != expected_ndim || (channels != 1 && info.shape[2] != channels))
+    {
+        throw py::value_error(std::string(what) + " has an unexpected shape");
+    }
+    // Rows may be padded, but pixels within a row must be packed.
+    if (info.strides[1] != static_cast<py::ssize_t>(itemsize) * channels ||
+        (channels != 1 && info.strides[2] != static_cast<py::ssize_t>(itemsize)) || info.strides[0] <= 0)
+    {
+        throw py::value_error(std::string(what) + " rows must be contiguous");
+    }
+    view.height = static_cast<int>(info.shape[0]);
+    view.width = static_cast<int>(info.shape[1]);
+    view.stride_bytes = static_cast<size_t>(info.strides[0]);
+    return view;
+}
+
+float resolve_depth_unit(const py::object& frame, const py::object& depth_unit)
+{
+    if (!depth_unit.is_none())
+    {
+        return depth_unit.cast<float>();
+    }
+    if (py::hasattr(frame, "get_units"))
+    {
+        return frame.attr("get_units")().cast<float>();
+    }
+    return 0.001f;
+}
+
+FaceBox to_face_box(const py::sequence& bbox)
+{
+    if (py::len(bbox) != 4)
+    {
+        throw py::value_error("bbox must be (x0, y0, x1, y1)");
+    }
+    return FaceBox{bbox[0].cast<int>(), bbox[1].cast<int>(), bbox[2].cast<int>(), bbox[3].cast<int>()};
+}
+
+// Accepts the bound LivenessThresholds or any object with the same attribute names
+// (e.g. the mediapipe_liveness.LivenessThresholds dataclass).
+LivenessThresholds to_thresholds(const py::object& obj)
+{
+    if (obj.is_none())
+    {
+        return LivenessThresholds{};
+    }
+    if (py::isinstance<LivenessThresholds>(obj))
+    {
+        return obj.cast<LivenessThresholds>();
+    }
+    LivenessThresholds t;
+#define COPY_THRESHOLD(name)                                   \
+    if (py::hasattr(obj, #name))                               \
+    {                                                          \
+        t.name = obj.attr(#name).cast<decltype(t.name)>();     \
+    }
+    COPY_THRESHOLD(min_depth_range_m)
+    COPY_THRESHOLD(min_depth_stdev_m)
+    COPY_THRESHOLD(min_samples)
+    COPY_THRESHOLD(max_depth_m)
+    COPY_THRESHOLD(min_center_prominence_m)
+    COPY_THRESHOLD(min_center_prominence_ratio)
+    COPY_THRESHOLD(max_horizontal_asymmetry_m)
+    COPY_THRESHOLD(color_mean_high)
+    COPY_THRESHOLD(color_uniformity_std_max)
+    COPY_THRESHOLD(color_saturation_fraction_max)
+    COPY_THRESHOLD(color_dark_fraction_max)
+    COPY_THRESHOLD(color_flicker_peak_to_peak)
+    COPY_THRESHOLD(flicker_window_s)
+    COPY_THRESHOLD(min_eye_change)
+    COPY_THRESHOLD(min_mouth_change)
+    COPY_THRESHOLD(min_nose_depth_change_m)
+    COPY_THRESHOLD(min_center_shift_px)
+    COPY_THRESHOLD(movement_window_s)
+    COPY_THRESHOLD(min_movement_samples)
+#undef COPY_THRESHOLD
+    return t;
+}
+
+// Result of depth_roi_stats() and face_depth_stats(), in meters.
+struct RoiStats
+{
+    size_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double stdev = 0.0;
+    double median = 0.0;
+    double p_low = 0.0;
+    double p_high = 0.0;
+    unsigned int stride = 1;  // sampling step actually used
+    DepthRoi roi;             // clipped region actually sampled
+};
+
+// Releases the GIL; `view` must outlive the call.
+RoiStats roi_stats(const FrameView& view, float unit, const DepthRoi& roi, unsigned int stride,
+                   double outlier_fraction)
+{
+    RoiStats out;
+    out.stride = std::max(1u, stride);
+    out.roi = roi;
+    py::gil_scoped_release release;
+    // One histogram per thread; allocated on first use and reused afterwards.
+    thread_local DepthHistogram histogram;
+    const DepthRoiSums sums = accumulate_depth_roi(static_cast<const uint16_t*>(view.info.ptr), view.stride_bytes,
+                                                   roi, out.stride, &histogram);
+    const DepthStats stats = compute_depth_stats(sums, histogram, unit, outlier_fraction);
+    out.count = stats.count;
+    out.min = stats.min;
+    out.max = stats.max;
+    out.mean = stats.mean;
+    out.stdev = stats.stdev;
+    out.median = stats.median;
+    out.p_low = stats.p_low;
+    out.p_high = stats.p_high;
+    return out;
+}
+
+// Landmarks as an iterable of (x, y) pixel pairs, e.g. FaceMesh points already scaled to the depth image.
+std::vector<float> to_points(const py::iterable& landmarks)
+{
+    std::vector<float> xy;
+    for (const py::handle& point : landmarks)
+    {
+        const py::sequence p = py::reinterpret_borrow<py::sequence>(point);
+        if (p.size() < 2)
+        {
+            throw py::value_error("landmarks must be (x, y) pairs");
+        }
+        xy.push_back(p[0].cast<float>());
+        xy.push_back(p[1].cast<float>());
+    }
+    return xy;
+}
+
+py::dict depth_metrics_dict(const DepthProfileMetrics& m)
+{
+    // Same keys as the stats dict built by mediapipe_liveness.compute_depth_metrics()
+    py::dict d;
+    d["count"] = static_cast<double>(m.count);
+    d["min"] = m.min;
+    d["max"] = m.max;
+    d["mean"] = m.mean;
+    d["stdev"] = m.stdev;
+    d["range"] = m.range;
+    d["center_mean"] = m.center_mean;
+    d["outer_mean"] = m.outer_mean;
+    d["left_mean"] = m.left_mean;
+    d["right_mean"] = m.right_mean;
+    return d;
+}
+
+py::dict color_metrics_dict(const ColorMetrics& m)
+{
+    py::dict d;
+    d["mean"] = m.mean;
+    d["stdev"] = m.stdev;
+    d["saturation_fraction"] = m.saturation_fraction;
+    d["dark_fraction"] = m.dark_fraction;
+    return d;
+}
+
+#ifdef D435I_HAVE_PREVIEW
+// (sequence, jpeg bytes) or None; the bytes are the one copy made per frame for all subscribers.
+py::object preview_frame_tuple(const std::shared_ptr<const PreviewFrame>& frame)
+{
+    if (!frame)
+    {
+        return py::none();
+    }
+    return py::make_tuple(frame->sequence,
+                          py::bytes(reinterpret_cast<const char*>(frame->jpeg.data()), frame->jpeg.size()));
+}
+
+py::dict preview_stats_dict(const PreviewEncoder& encoder)
+{
+    const PreviewEncoderStats s = encoder.stats();
+    py::dict d;
+    d["submitted"] = s.submitted;
+    d["encoded"] = s.encoded;
+    d["replaced"] = s.replaced;
+    d["pool_exhausted"] = s.pool_exhausted;
+    d["failed"] = s.failed;
+    const std::shared_ptr<const PreviewFrame> latest = encoder.latest();
+    d["encode_ms"] = latest ? latest->encode_ms : 0.0;
+    return d;
+}
+#endif
+
+} // namespace
+
+PYBIND11_MODULE(_liveness_core, m)
+{
+    m.doc() = "Native depth/color liveness math from d435i_liveness_core";
+
+    py::class_<LivenessThresholds>(m, "LivenessThresholds")
+        .def(py::init<>())
+        .def_readwrite("min_depth_range_m", &LivenessThresholds::min_depth_range_m)
+        .def_readwrite("min_depth_stdev_m", &LivenessThresholds::min_depth_stdev_m)
+        .def_readwrite("min_samples", &LivenessThresholds::min_samples)
+        .def_readwrite("max_depth_m", &LivenessThresholds::max_depth_m)
+        .def_readwrite("min_center_prominence_m", &LivenessThresholds::min_center_prominence_m)
+        .def_readwrite("min_center_prominence_ratio", &LivenessThresholds::min_center_prominence_ratio)
+        .def_readwrite("max_horizontal_asymmetry_m", &LivenessThresholds::max_horizontal_asymmetry_m)
+        .def_readwrite("color_mean_high", &LivenessThresholds::color_mean_high)
+        .def_readwrite("color_uniformity_std_max", &LivenessThresholds::color_uniformity_std_max)
+        .def_readwrite("color_saturation_fraction_max", &LivenessThresholds::color_saturation_fraction_max)
+        .def_readwrite("color_dark_fraction_max", &LivenessThresholds::color_dark_fraction_max)
+        .def_readwrite("color_flicker_peak_to_peak", &LivenessThresholds::color_flicker_peak_to_peak)
+        .def_readwrite("flicker_window_s", &LivenessThresholds::flicker_window_s)
+        .def_readwrite("min_eye_change", &LivenessThresholds::min_eye_change)
+        .def_readwrite("min_mouth_change", &LivenessThresholds::min_mouth_change)
+        .def_readwrite("min_nose_depth_change_m", &LivenessThresholds::min_nose_depth_change_m)
+        .def_readwrite("min_center_shift_px", &LivenessThresholds::min_center_shift_px)
+        .def_readwrite("movement_window_s", &LivenessThresholds::movement_window_s)
+        .def_readwrite("min_movement_samples", &LivenessThresholds::min_movement_samples);
+
+    py::class_<DepthProfileMetrics>(m, "DepthProfileMetrics")
+        .def_readonly("count", &DepthProfileMetrics::count)
+        .def_readonly("min", &DepthProfileMetrics::min)
+        .def_readonly("max", &DepthProfileMetrics::max)
+        .def_readonly("mean", &DepthProfileMetrics::mean)
+        .def_readonly("stdev", &DepthProfileMetrics::stdev)
+        .def_readonly("range", &DepthProfileMetrics::range)
+        .def_readonly("center_mean", &DepthProfileMetrics::center_mean)
+        .def_readonly("outer_mean", &DepthProfileMetrics::outer_mean)
+        .def_readonly("left_mean", &DepthProfileMetrics::left_mean)
+        .def_readonly("right_mean", &DepthProfileMetrics::right_mean)
+        .def("as_dict", &depth_metrics_dict);
+
+    py::class_<ColorMetrics>(m, "ColorMetrics")
+        .def_readonly("mean", &ColorMetrics::mean)
+        .def_readonly("stdev", &ColorMetrics::stdev)
+        .def_readonly("saturation_fraction", &ColorMetrics::saturation_fraction)
+        .def_readonly("dark_fraction", &ColorMetrics::dark_fraction)
+        .def("as_dict", &color_metrics_dict);
+
+    py::class_<RoiStats>(m, "RoiStats")
+        .def_readonly("count", &RoiStats::count)
+        .def_readonly("min", &RoiStats::min)
+        .def_readonly("max", &RoiStats::max)
+        .def_readonly("mean", &RoiStats::mean)
+        .def_readonly("stdev", &RoiStats::stdev)
+        .def_readonly("median", &RoiStats::median)
+        .def_readonly("p_low", &RoiStats::p_low)
+        .def_readonly("p_high", &RoiStats::p_high)
+        .def_readonly("stride", &RoiStats::stride)
+        .def_property_readonly("roi", [](const RoiStats& r) {
+            return py::make_tuple(r.roi.x0, r.roi.y0, r.roi.x0 + r.roi.width, r.roi.y0 + r.roi.height);
+        });
+
+    m.def(
+        "compute_depth_metrics",
+        [](const py::object& depth, const py::sequence& bbox, int stride, const py::object& thresholds,
+           const py::object& depth_unit) -> std::optional<DepthProfileMetrics> {
+            FrameView view = view_frame(depth, "depth", 'H', sizeof(uint16_t), 1);
+            const float unit = resolve_depth_unit(depth, depth_unit);
+            const FaceBox box = to_face_box(bbox);
+            const LivenessThresholds t = to_thresholds(thresholds);
+            py::gil_scoped_release release;
+            return compute_depth_metrics(static_cast<const uint16_t*>(view.info.ptr), view.width, view.height,
+                                         view.stride_bytes, unit, box, stride, t);
+        },
+        py::arg("depth"), py::arg("bbox"), py::arg("stride") = 3, py::arg("thresholds") = py::none(),
+        py::arg("depth_unit") = py::none(),
+        "Ellipse depth profile of a face box, or None with too few valid samples. "
+        "`depth` is a pyrealsense2 depth frame or an HxW uint16 array.");
+
+    m.def(
+        "sample_color_metrics",
+        [](const py::object& color, const py::sequence& bbox, int stride) -> std::optional<ColorMetrics> {
+            FrameView view = view_frame(color, "color", 'B', sizeof(uint8_t), 3);
+            const FaceBox box = to_face_box(bbox);
+            py::gil_scoped_release release;
+            return sample_color_metrics(static_cast<const uint8_t*>(view.info.ptr), view.width, view.height,
+                                        view.stride_bytes, box, stride);
+        },
+        py::arg("color"), py::arg("bbox"), py::arg("stride") = 3,
+        "Grayscale statistics over the face ellipse of an HxWx3 BGR8 image or pyrealsense2 color frame.");
+
+    m.def(
+        "depth_roi_stats",
+        [](const py::object& depth, const py::sequence& roi, unsigned int stride, double outlier_fraction,
+           const py::object& depth_unit) {
+            FrameView view = view_frame(depth, "depth", 'H', sizeof(uint16_t), 1);
+            const float unit = resolve_depth_unit(depth, depth_unit);
+            const FaceBox box = to_face_box(roi);
+            const DepthRoi r = clip_roi(box.x0, box.y0, box.x1, box.y1, view.width, view.height);
+            return roi_stats(view, unit, r, stride, outlier_fraction);
+        },
+        py::arg("depth"), py::arg("roi"), py::arg("stride") = 4, py::arg("outlier_fraction") = 0.05,
+        py::arg("depth_unit") = py::none(),
+        "Count/min/max/mean/stdev and percentiles of the non-zero samples in roi=(x0, y0, x1, y1).");
+
+    m.def(
+        "face_depth_stats",
+        [](const py::object& depth, const py::object& bbox, const py::object& landmarks, size_t target_samples,
+           double margin, double outlier_fraction, const py::object& depth_unit) {
+            FrameView view = view_frame(depth, "depth", 'H', sizeof(uint16_t), 1);
+            const float unit = resolve_depth_unit(depth, depth_unit);
+            DepthRoi r;
+            if (!landmarks.is_none())
+            {
+                const std::vector<float> xy = to_points(py::reinterpret_borrow<py::iterable>(landmarks));
+                r = roi_from_points(xy.data(), xy.size() / 2, view.width, view.height, static_cast<float>(margin));
+            }
+            else if (!bbox.is_none())
+            {
+                const FaceBox box = to_face_box(bbox);
+                r = clip_roi(box.x0, box.y0, box.x1, box.y1, view.width, view.height);
+            }
+            else
+            {
+                throw py::value_error("face_depth_stats needs bbox or landmarks");
+            }
+            return roi_stats(view, unit, r, adaptive_step(r, target_samples), outlier_fraction);
+        },
+        py::arg("depth"), py::arg("bbox") = py::none(), py::arg("landmarks") = py::none(),
+        py::arg("target_samples") = 1500, py::arg("margin") = 0.1, py::arg("outlier_fraction") = 0.05,
+        py::arg("depth_unit") = py::none(),
+        "depth_roi_stats() over a face given as bbox=(x0, y0, x1, y1) or as landmark (x, y) pixels, with the\n"
+        "stride chosen so about target_samples pixels are visited whatever the face size. For landmarks the\n"
+        "box is grown by `margin` of its size on each side.");
+
+    m.def(
+        "adaptive_stride",
+        [](const py::sequence& roi, size_t target_samples) {
+            const FaceBox box = to_face_box(roi);
+            DepthRoi r;
+            r.width = std::max(0, box.x1 - box.x0);
+            r.height = std::max(0, box.y1 - box.y0);
+            return adaptive_step(r, target_samples);
+        },
+        py::arg("roi"), py::arg("target_samples"), "Stride face_depth_stats() would use for roi=(x0, y0, x1, y1).");
+
+#ifdef D435I_HAVE_PREVIEW
+    py::class_<PreviewEncoder>(m, "PreviewEncoder")
+        .def(py::init([](int width, int height, int quality, size_t pool_size, int nice) {
+                 PreviewEncoderConfig config;
+                 config.width = width;
+                 config.height = height;
+                 config.quality = quality;
+                 config.pool_size = pool_size;
+                 config.nice = nice;
+                 return std::make_unique<PreviewEncoder>(config);
+             }),
+             py::arg("width") = 0, py::arg("height") = 0, py::arg("quality") = 80, py::arg("pool_size") = 3,
+             py::arg("nice") = 10,
+             "JPEG preview encoder with its own thread; width/height 0 keep the source size (or its aspect).")
+        .def(
+            "submit",
+            [](PreviewEncoder& encoder, const py::object& color) {
+                FrameView view = view_frame(color, "color", 'B', sizeof(uint8_t), 3);
+                py::gil_scoped_release release;
+                return encoder.submit(static_cast<const uint8_t*>(view.info.ptr), view.width, view.height,
+                                      view.stride_bytes);
+            },
+            py::arg("color"),
+            "Queues an HxWx3 BGR8 image or pyrealsense2 color frame for encoding and returns at once; False if\n"
+            "it replaced a frame the encoder had not got to yet.")
+        .def(
+            "latest", [](const PreviewEncoder& encoder) { return preview_frame_tuple(encoder.latest()); },
+            "(sequence, jpeg) of the newest encoded frame, or None.")
+        .def(
+            "wait_newer",
+            [](const PreviewEncoder& encoder, uint64_t after_sequence, double timeout_s) {
+                std::shared_ptr<const PreviewFrame> frame;
+                {
+                    py::gil_scoped_release release;
+                    frame = encoder.wait_newer(after_sequence,
+                                               std::chrono::milliseconds(static_cast<int64_t>(timeout_s * 1000.0)));
+                }
+                return preview_frame_tuple(frame);
+            },
+            py::arg("after_sequence"), py::arg("timeout_s") = 0.1,
+            "Like latest(), but waits for a frame newer than after_sequence; None on timeout.")
+        .def("stats", &preview_stats_dict)
+        .def(
+            "close",
+            [](PreviewEncoder& encoder) {
+                py::gil_scoped_release release;
+                encoder.close();
+            },
+            "Stops the encoder thread.");
+#endif
+}
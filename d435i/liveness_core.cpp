@@ -0,0 +1,464 @@
+#include "liveness_core.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+double clamp(double value, double lo, double hi)
+{
+    return std::max(lo, std::min(hi, value));
+}
+
+// Face box clipped to the image, the way NumPy slicing clips it.
+struct Patch
+{
+    int x0 = 0;
+    int y0 = 0;
+    int rows = 0;  // strided patch size
+    int cols = 0;
+};
+
+Patch clip_patch(const FaceBox& box, int width, int height, int stride)
+{
+    Patch p;
+    const int x0 = std::clamp(box.x0, 0, width);
+    const int y0 = std::clamp(box.y0, 0, height);
+    const int x1 = std::clamp(box.x1, x0, width);
+    const int y1 = std::clamp(box.y1, y0, height);
+    p.x0 = x0;
+    p.y0 = y0;
+    p.cols = (x1 - x0 + stride - 1) / stride;
+    p.rows = (y1 - y0 + stride - 1) / stride;
+    return p;
+}
+
+// Normalized ellipse coordinates for _ellipse_masks(); the patch is too small when rows or cols < 2.
+struct EllipseGeometry
+{
+    double cx;
+    double cy;
+    double inv_rx;
+    double inv_ry;
+
+    explicit EllipseGeometry(const Patch& p)
+        : cx((p.cols - 1) / 2.0),
+          cy((p.rows - 1) / 2.0),
+          inv_rx(1.0 / std::max(cx, 1.0)),
+          inv_ry(1.0 / std::max(cy, 1.0))
+    {
+    }
+
+    double row_term(int i) const
+    {
+        const double dy = (i - cy) * inv_ry;
+        return dy * dy;
+    }
+
+    double norm(double row_term, int j) const
+    {
+        const double dx = (j - cx) * inv_rx;
+        return dx * dx + row_term;
+    }
+};
+
+constexpr double kInnerNorm = 0.5 * 0.5;
+
+struct MeanAccumulator
+{
+    double sum = 0.0;
+    size_t count = 0;
+
+    void add(double v)
+    {
+        sum += v;
+        ++count;
+    }
+
+    std::optional<double> mean() const
+    {
+        if (count == 0)
+        {
+            return std::nullopt;
+        }
+        return sum / static_cast<double>(count);
+    }
+};
+
+// Peak-to-peak of the present values; 0 with fewer than two, like _variation().
+template <size_t Capacity>
+double variation(const SlidingWindow<Capacity>& window)
+{
+    return (window.size() < 2) ? 0.0 : window.peak_to_peak();
+}
+
+// cv2.COLOR_BGR2GRAY for 8-bit input: fixed-point weights with 14 fractional bits, rounded.
+inline int bgr_to_gray(const uint8_t* px)
+{
+    return (px[0] * 1868 + px[1] * 9617 + px[2] * 4899 + (1 << 13)) >> 14;
+}
+
+} // namespace
+
+std::optional<FaceBox> face_box_from_relative(double x, double y, double w, double h, int width, int height,
+                                              double expansion)
+{
+    if (w <= 0.0 || h <= 0.0)
+    {
+        return std::nullopt;
+    }
+    const double cx = x + w / 2.0;
+    const double cy = y + h / 2.0;
+    w *= (1.0 + expansion);
+    h *= (1.0 + expansion);
+    x = cx - w / 2.0;
+    y = cy - h / 2.0;
+
+    FaceBox box;
+    box.x0 = static_cast<int>(clamp(x * width, 0, width - 1));
+    box.y0 = static_cast<int>(clamp(y * height, 0, height - 1));
+    box.x1 = static_cast<int>(clamp((x + w) * width, 0, width));
+    box.y1 = static_cast<int>(clamp((y + h) * height, 0, height));
+    if (box.x1 <= box.x0 || box.y1 <= box.y0)
+    {
+        return std::nullopt;
+    }
+    return box;
+}
+
+std::optional<DepthProfileMetrics> compute_depth_metrics(const uint16_t* depth, int width, int height,
+                                                         size_t stride_bytes, float depth_unit, const FaceBox& box,
+                                                         int stride, const LivenessThresholds& thresholds)
+{
+    stride = std::max(stride, 1);
+    const Patch patch = clip_patch(box, width, height, stride);
+    if (patch.rows < 2 || patch.cols < 2)
+    {
+        return std::nullopt;
+    }
+    const EllipseGeometry ellipse(patch);
+    const double half_cols = patch.cols / 2.0;
+    const float max_depth = static_cast<float>(thresholds.max_depth_m);
+
+    // Integer sums in depth units keep the variance exact; everything is scaled to meters once.
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint16_t lo = UINT16_MAX;
+    uint16_t hi = 0;
+    uint64_t region_sum[4] = {0, 0, 0, 0};  // inner, outer, left, right
+    size_t region_count[4] = {0, 0, 0, 0};
+
+    for (int i = 0; i < patch.rows; ++i)
+    {
+        const auto* row = reinterpret_cast<const uint16_t*>(reinterpret_cast<const uint8_t*>(depth) +
+                                                            stride_bytes * static_cast<size_t>(patch.y0 + i * stride));
+        const double row_term = ellipse.row_term(i);
+        if (row_term > 1.0)
+        {
+            continue;
+        }
+        for (int j = 0; j < patch.cols; ++j)
+        {
+            const uint16_t raw = row[patch.x0 + j * stride];
+            if (raw == 0 || !(static_cast<float>(raw) * depth_unit < max_depth))
+            {
+                continue;
+            }
+            const double norm = ellipse.norm(row_term, j);
+            if (norm > 1.0)
+            {
+                continue;
+            }
+            ++count;
+            sum += raw;
+            sum_sq += static_cast<uint64_t>(raw) * raw;
+            lo = std::min(lo, raw);
+            hi = std::max(hi, raw);
+            const int ring = (norm <= kInnerNorm) ? 0 : 1;
+            const int side = (j < half_cols) ? 2 : 3;
+            region_sum[ring] += raw;
+            ++region_count[ring];
+            region_sum[side] += raw;
+            ++region_count[side];
+        }
+    }
+
+    if (count < thresholds.min_samples || count == 0)
+    {
+        return std::nullopt;
+    }
+
+    const double unit = depth_unit;
+    const double n = static_cast<double>(count);
+    const double mean_units = static_cast<double>(sum) / n;
+    const double variance_units = std::max(0.0, static_cast<double>(sum_sq) / n - mean_units * mean_units);
+
+    DepthProfileMetrics m;
+    m.count = static_cast<size_t>(count);
+    m.min = lo * unit;
+    m.max = hi * unit;
+    m.mean = mean_units * unit;
+    m.stdev = std::sqrt(variance_units) * unit;
+    m.range = m.max - m.min;
+    std::optional<double>* regions[4] = {&m.center_mean, &m.outer_mean, &m.left_mean, &m.right_mean};
+    for (int r = 0; r < 4; ++r)
+    {
+        if (region_count[r] != 0)
+        {
+            *regions[r] = static_cast<double>(region_sum[r]) / static_cast<double>(region_count[r]) * unit;
+        }
+    }
+    return m;
+}
+
+DepthProfileResult evaluate_depth_profile(const DepthProfileMetrics& metrics, const LivenessThresholds& thresholds)
+{
+    DepthProfileResult result;
+    if (metrics.range < thresholds.min_depth_range_m)
+    {
+        result.reason = "depth_range_too_small";
+        return result;
+    }
+    if (metrics.stdev < thresholds.min_depth_stdev_m)
+    {
+        result.reason = "depth_stdev_too_small";
+        return result;
+    }
+
+    if (!metrics.center_mean || !metrics.outer_mean)
+    {
+        result.reason = "missing_center_outer";
+        return result;
+    }
+    result.prominence = *metrics.outer_mean - *metrics.center_mean;
+    result.prominence_ratio = (metrics.range > 1e-6) ? result.prominence / metrics.range : 0.0;
+    const double min_required_prominence =
+        std::max(thresholds.min_center_prominence_m, thresholds.min_center_prominence_ratio * metrics.range);
+    if (result.prominence < min_required_prominence ||
+        result.prominence_ratio < thresholds.min_center_prominence_ratio)
+    {
+        result.reason = "nose_not_prominent";
+        return result;
+    }
+
+    if (!metrics.left_mean || !metrics.right_mean)
+    {
+        result.reason = "missing_cheeks";
+        return result;
+    }
+    result.asymmetry = std::fabs(*metrics.left_mean - *metrics.right_mean);
+    if (result.asymmetry > thresholds.max_horizontal_asymmetry_m)
+    {
+        result.reason = "cheeks_unbalanced";
+        return result;
+    }
+
+    result.ok = true;
+    result.reason = "depth_ok";
+    return result;
+}
+
+std::optional<ColorMetrics> sample_color_metrics(const uint8_t* bgr, int width, int height, size_t stride_bytes,
+                                                 const FaceBox& box, int stride)
+{
+    stride = std::max(stride, 1);
+    const Patch patch = clip_patch(box, width, height, stride);
+    if (patch.rows < 2 || patch.cols < 2)
+    {
+        return std::nullopt;
+    }
+    const EllipseGeometry ellipse(patch);
+
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint64_t saturated = 0;
+    uint64_t dark = 0;
+    for (int i = 0; i < patch.rows; ++i)
+    {
+        const uint8_t* row = bgr + stride_bytes * static_cast<size_t>(patch.y0 + i * stride);
+        const double row_term = ellipse.row_term(i);
+        if (row_term > 1.0)
+        {
+            continue;
+        }
+        for (int j = 0; j < patch.cols; ++j)
+        {
+            if (ellipse.norm(row_term, j) > 1.0)
+            {
+                continue;
+            }
+            const int gray = bgr_to_gray(row + 3 * static_cast<size_t>(patch.x0 + j * stride));
+            ++count;
+            sum += static_cast<uint64_t>(gray);
+            sum_sq += static_cast<uint64_t>(gray * gray);
+            saturated += (gray >= 240);
+            dark += (gray <= 30);
+        }
+    }
+    if (count == 0)
+    {
+        return std::nullopt;
+    }
+
+    const double n = static_cast<double>(count);
+    ColorMetrics m;
+    m.mean = static_cast<double>(sum) / n;
+    m.stdev = std::sqrt(std::max(0.0, static_cast<double>(sum_sq) / n - m.mean * m.mean));
+    m.saturation_fraction = static_cast<double>(saturated) / n;
+    m.dark_fraction = static_cast<double>(dark) / n;
+    return m;
+}
+
+ScreenResult evaluate_screen_suspect(const std::optional<ColorMetrics>& metrics, const FlickerHistory& history,
+                                     const LivenessThresholds& thresholds)
+{
+    ScreenResult result;
+    if (!metrics)
+    {
+        result.no_color_metrics = true;
+        return result;
+    }
+
+    result.bright_uniform = metrics->mean > thresholds.color_mean_high &&
+                            metrics->stdev < thresholds.color_uniformity_std_max &&
+                            metrics->saturation_fraction > 0.2;
+    result.high_saturation = metrics->saturation_fraction > thresholds.color_saturation_fraction_max;
+    result.very_dark = metrics->dark_fraction > thresholds.color_dark_fraction_max;
+
+    // flicker detection using recent brightness history
+    result.flicker_pp = history.peak_to_peak();
+    result.flicker = result.flicker_pp >= thresholds.color_flicker_peak_to_peak;
+
+    result.ok = !(result.bright_uniform || result.high_saturation || result.very_dark || result.flicker);
+    return result;
+}
+
+MovementTracker::MovementTracker(double window_s)
+    : center_x_(window_s), center_y_(window_s), eye_(window_s), mouth_(window_s), nose_(window_s)
+{
+}
+
+void MovementTracker::update(double now, const FaceBox& box, const LandmarkMetrics& metrics)
+{
+    center_x_.push(now, (box.x0 + box.x1) / 2.0);
+    center_y_.push(now, (box.y0 + box.y1) / 2.0);
+
+    // Optional values leave with the update they arrived in, by age or by the shared capacity
+    const double oldest = center_x_.oldest_t();
+    SlidingWindow<kCapacity>* windows[] = {&eye_, &mouth_, &nose_};
+    const std::optional<double>* values[] = {&metrics.eye_ratio, &metrics.mouth_ratio, &metrics.nose_depth};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        windows[i]->evict(now);
+        windows[i]->discard_before(oldest);
+        if (*values[i])
+        {
+            windows[i]->push(now, **values[i]);
+        }
+    }
+}
+
+void MovementTracker::clear()
+{
+    center_x_.clear();
+    center_y_.clear();
+    eye_.clear();
+    mouth_.clear();
+    nose_.clear();
+}
+
+MovementResult MovementTracker::evaluate(const LivenessThresholds& thresholds) const
+{
+    MovementResult result;
+    result.samples = center_x_.size();
+    if (result.samples < thresholds.min_movement_samples)
+    {
+        result.reason = "insufficient_samples";
+        return result;
+    }
+
+    result.eye_var = variation(eye_);
+    result.mouth_var = variation(mouth_);
+    result.nose_var = variation(nose_);
+    result.center_shift = std::hypot(variation(center_x_), variation(center_y_));
+
+    result.ok = result.eye_var >= thresholds.min_eye_change || result.mouth_var >= thresholds.min_mouth_change ||
+                result.nose_var >= thresholds.min_nose_depth_change_m ||
+                result.center_shift >= thresholds.min_center_shift_px;
+    result.reason = result.ok ? "movement_ok" : "movement_static";
+    return result;
+}
+
+bool DecisionAccumulator::update(bool positive)
+{
+    const double delta = positive ? pos_gain : -neg_gain;
+    value = clamp(value + delta, 0.0, 1.0);
+    if (state)
+    {
+        if (value <= off_threshold)
+        {
+            state = false;
+        }
+    }
+    else if (value >= on_threshold)
+    {
+        state = true;
+    }
+    return state;
+}
+
+LivenessEngine::LivenessEngine(const LivenessThresholds& thresholds, int stride)
+    : thresholds_(thresholds),
+      stride_(std::max(stride, 1)),
+      color_history_(thresholds.flicker_window_s),
+      movement_history_(thresholds.movement_window_s)
+{
+}
+
+void LivenessEngine::reset()
+{
+    color_history_.clear();
+    movement_history_.clear();
+    decision_ = DecisionAccumulator{};
+}
+
+LivenessDecision LivenessEngine::process(const LivenessFrame& frame)
+{
+    LivenessDecision decision;
+    decision.face = frame.face.has_value();
+    if (frame.face && frame.depth)
+    {
+        decision.depth_metrics = compute_depth_metrics(frame.depth, frame.width, frame.height,
+                                                       frame.depth_stride_bytes, frame.depth_unit, *frame.face,
+                                                       stride_, thresholds_);
+    }
+
+    if (decision.depth_metrics)
+    {
+        const double now = frame.timestamp_s;
+        decision.depth = evaluate_depth_profile(*decision.depth_metrics, thresholds_);
+
+        std::optional<ColorMetrics> color;
+        if (frame.bgr)
+        {
+            color = sample_color_metrics(frame.bgr, frame.width, frame.height, frame.color_stride_bytes, *frame.face,
+                                         stride_);
+        }
+        if (color)
+        {
+            color_history_.add(now, color->mean);
+        }
+        decision.screen = evaluate_screen_suspect(color, color_history_, thresholds_);
+
+        movement_history_.update(now, *frame.face, frame.landmarks.value_or(LandmarkMetrics{}));
+        decision.movement = movement_history_.evaluate(thresholds_);
+
+        decision.instant_alive = decision.depth.ok && decision.screen.ok && decision.movement.ok;
+    }
+
+    decision.stable_alive = decision_.update(decision.instant_alive);
+    decision.stability_score = decision_.value;
+    return decision;
+}
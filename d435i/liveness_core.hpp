@@ -0,0 +1,229 @@
+#pragma once
+
+// Native port of the per-frame math in mediapipe_liveness.py: depth profile, screen heuristics,
+// flicker and movement checks plus the hysteresis accumulator. Works on raw frame buffers so it
+// can be driven from C++ or from Python without NumPy temporaries; face detection and landmarks
+// stay with the caller. Thresholds and reasons match the Python implementation.
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "sliding_window.hpp"
+
+struct LivenessThresholds
+{
+    double min_depth_range_m = 0.022;
+    double min_depth_stdev_m = 0.007;
+    size_t min_samples = 120;
+    double max_depth_m = 3.0;
+
+    double min_center_prominence_m = 0.0035;   // absolute floor (meters)
+    double min_center_prominence_ratio = 0.05; // relative to total range inside ROI
+    double max_horizontal_asymmetry_m = 0.12;  // cheeks tolerance widened to ~12 cm
+
+    double color_mean_high = 235.0;
+    double color_uniformity_std_max = 26.0;
+    double color_saturation_fraction_max = 0.90;
+    double color_dark_fraction_max = 0.95;
+    double color_flicker_peak_to_peak = 70.0;
+    double flicker_window_s = 2.0;
+
+    double min_eye_change = 0.009;
+    double min_mouth_change = 0.012;
+    double min_nose_depth_change_m = 0.003;
+    double min_center_shift_px = 2.0;
+    double movement_window_s = 3.0;
+    size_t min_movement_samples = 3;
+};
+
+// Pixel box [x0, x1) x [y0, y1) in the (color-aligned) image.
+struct FaceBox
+{
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+};
+
+// Same as bbox_from_detection(): grows a relative detection box by `expansion` and clamps it to the image.
+std::optional<FaceBox> face_box_from_relative(double x, double y, double w, double h, int width, int height,
+                                              double expansion = 0.2);
+
+// Depth statistics over the ellipse inscribed in the strided face box, in meters.
+// Optional fields are empty when their region had no valid samples.
+struct DepthProfileMetrics
+{
+    size_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double stdev = 0.0;
+    double range = 0.0;
+    std::optional<double> center_mean;
+    std::optional<double> outer_mean;
+    std::optional<double> left_mean;
+    std::optional<double> right_mean;
+};
+
+// `depth` is a width x height Z16 image with rows stride_bytes apart; the box is clipped to it.
+// Returns nothing when the box is empty or has fewer than thresholds.min_samples valid samples.
+std::optional<DepthProfileMetrics> compute_depth_metrics(const uint16_t* depth, int width, int height,
+                                                         size_t stride_bytes, float depth_unit, const FaceBox& box,
+                                                         int stride, const LivenessThresholds& thresholds);
+
+struct DepthProfileResult
+{
+    bool ok = false;
+    const char* reason = "no_depth";
+    double prominence = 0.0;
+    double prominence_ratio = 0.0;
+    double asymmetry = 0.0;
+};
+
+DepthProfileResult evaluate_depth_profile(const DepthProfileMetrics& metrics, const LivenessThresholds& thresholds);
+
+// Grayscale statistics over the same ellipse as compute_depth_metrics(), from a BGR8 image.
+struct ColorMetrics
+{
+    double mean = 0.0;
+    double stdev = 0.0;
+    double saturation_fraction = 0.0;
+    double dark_fraction = 0.0;
+};
+
+std::optional<ColorMetrics> sample_color_metrics(const uint8_t* bgr, int width, int height, size_t stride_bytes,
+                                                 const FaceBox& box, int stride);
+
+// Brightness samples for flicker detection over the last window_s seconds, capped at kCapacity entries
+// like the Python deque. add() is O(1) amortized and peak_to_peak() is O(1).
+class FlickerHistory
+{
+  public:
+    static constexpr size_t kCapacity = 180;
+
+    explicit FlickerHistory(double window_s = 2.0) : window_(window_s) {}
+
+    void add(double t, double mean) { window_.push(t, mean); }
+    // Peak-to-peak brightness over the window ending at the latest add(); 0 with fewer than two entries.
+    double peak_to_peak() const { return (window_.size() >= 2) ? window_.peak_to_peak() : 0.0; }
+    void clear() { window_.clear(); }
+
+  private:
+    SlidingWindow<kCapacity> window_;
+};
+
+struct ScreenResult
+{
+    bool ok = true;
+    bool bright_uniform = false;
+    bool high_saturation = false;
+    bool very_dark = false;
+    bool flicker = false;
+    bool no_color_metrics = false;
+    double flicker_pp = 0.0;
+};
+
+ScreenResult evaluate_screen_suspect(const std::optional<ColorMetrics>& metrics, const FlickerHistory& history,
+                                     const LivenessThresholds& thresholds);
+
+// Landmark-derived values supplied by the caller (e.g. from MediaPipe FaceMesh); any may be missing.
+struct LandmarkMetrics
+{
+    std::optional<double> eye_ratio;
+    std::optional<double> mouth_ratio;
+    std::optional<double> nose_depth;
+};
+
+struct MovementResult
+{
+    bool ok = false;
+    const char* reason = "not_evaluated";
+    size_t samples = 0;
+    double eye_var = 0.0;
+    double mouth_var = 0.0;
+    double nose_var = 0.0;
+    double center_shift = 0.0;
+};
+
+// Fixed-capacity history behind movement_liveness_ok(), kept as one sliding window per tracked value so
+// each update and evaluation is O(1) instead of a rescan of the whole history.
+class MovementTracker
+{
+  public:
+    static constexpr size_t kCapacity = 180;
+
+    explicit MovementTracker(double window_s = 3.0);
+
+    void update(double now, const FaceBox& box, const LandmarkMetrics& metrics);
+    // Evaluates the window ending at the latest update().
+    MovementResult evaluate(const LivenessThresholds& thresholds) const;
+    void clear();
+
+  private:
+    SlidingWindow<kCapacity> center_x_;  // one entry per update; the other windows follow its eviction
+    SlidingWindow<kCapacity> center_y_;
+    SlidingWindow<kCapacity> eye_;
+    SlidingWindow<kCapacity> mouth_;
+    SlidingWindow<kCapacity> nose_;
+};
+
+// Asymmetric gain with on/off thresholds so single-frame flips do not toggle the decision.
+struct DecisionAccumulator
+{
+    double pos_gain = 0.25;
+    double neg_gain = 0.18;
+    double on_threshold = 0.65;
+    double off_threshold = 0.35;
+    double value = 0.0;
+    bool state = false;
+
+    bool update(bool positive);
+};
+
+// One frame's inputs. Buffers must stay valid for the duration of LivenessEngine::process().
+struct LivenessFrame
+{
+    double timestamp_s = 0.0;
+    int width = 0;                    // shared by the depth and color images
+    int height = 0;
+    const uint16_t* depth = nullptr;  // Z16 aligned to the color image
+    size_t depth_stride_bytes = 0;
+    float depth_unit = 0.001f;
+    const uint8_t* bgr = nullptr;     // optional BGR8 color image
+    size_t color_stride_bytes = 0;
+    std::optional<FaceBox> face;      // empty when no face was detected
+    std::optional<LandmarkMetrics> landmarks;
+};
+
+struct LivenessDecision
+{
+    bool face = false;
+    std::optional<DepthProfileMetrics> depth_metrics;
+    DepthProfileResult depth;
+    ScreenResult screen;
+    MovementResult movement;
+    bool instant_alive = false;
+    bool stable_alive = false;
+    double stability_score = 0.0;
+};
+
+// Stateful equivalent of MediaPipeLiveness.process() minus capture and detection. Allocation-free per frame.
+class LivenessEngine
+{
+  public:
+    explicit LivenessEngine(const LivenessThresholds& thresholds = LivenessThresholds{}, int stride = 3);
+
+    LivenessDecision process(const LivenessFrame& frame);
+    void reset();
+
+    const LivenessThresholds& thresholds() const { return thresholds_; }
+    int stride() const { return stride_; }
+
+  private:
+    LivenessThresholds thresholds_;
+    int stride_;
+    FlickerHistory color_history_;
+    MovementTracker movement_history_;
+    DecisionAccumulator decision_;
+};
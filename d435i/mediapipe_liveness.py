@@ -19,6 +19,14 @@ import mediapipe as mp
 import numpy as np
 import pyrealsense2 as rs
 
+try:  # Optional native core (d435i/liveness_bindings.cpp); falls back to the NumPy path below.
+    from . import _liveness_core as _native
+except ImportError:
+    try:
+        import _liveness_core as _native  # type: ignore[no-redef]
+    except ImportError:
+        _native = None
+
 
 @dataclass
 class LivenessThresholds:
@@ -201,6 +209,28 @@ def compute_depth_metrics(
     return stats, mask_info
 
 
+def compute_face_metrics(
+    depth_frame: rs.depth_frame,
+    color_image: np.ndarray,
+    bbox: Tuple[int, int, int, int],
+    stride: int,
+    thresholds: LivenessThresholds,
+) -> Tuple[Optional[Dict[str, float]], Optional[Dict[str, float]]]:
+    """Depth stats and color metrics for one face box, using the native core when it is built."""
+
+    if _native is not None:
+        native_stats = _native.compute_depth_metrics(depth_frame, bbox, stride, thresholds)
+        if native_stats is None:
+            return None, None
+        native_color = _native.sample_color_metrics(color_image, bbox, stride)
+        return native_stats.as_dict(), native_color.as_dict() if native_color is not None else None
+
+    stats, mask_info = compute_depth_metrics(depth_frame, bbox, stride, thresholds)
+    if not stats or not mask_info:
+        return None, None
+    return stats, sample_color_metrics(color_image, mask_info)
+
+
 def evaluate_depth_profile(stats: Dict[str, float], thresholds: LivenessThresholds) -> Tuple[bool, Dict[str, float]]:
     info = {
         "range": stats["range"],
@@ -533,7 +563,6 @@ class MediaPipeLiveness:
         mesh_result = self.face_mesh.process(rgb_image)
 
         stats: Optional[Dict[str, float]] = None
-        mask_info: Optional[MaskInfo] = None
         bbox_px: Optional[Tuple[int, int, int, int]] = None
         depth_ok = False
         depth_info: Dict[str, float | int | str] = {"reason": "no_depth"}
@@ -550,10 +579,11 @@ class MediaPipeLiveness:
             height = color_frame.get_height()
             bbox_px = bbox_from_detection(det, width, height)
             if bbox_px:
-                stats, mask_info = compute_depth_metrics(depth_frame, bbox_px, self.config.stride, self.thresholds)
-                if stats and mask_info:
+                stats, color_metrics = compute_face_metrics(
+                    depth_frame, color_image, bbox_px, self.config.stride, self.thresholds
+                )
+                if stats:
                     depth_ok, depth_info = evaluate_depth_profile(stats, self.thresholds)
-                    color_metrics = sample_color_metrics(color_image, mask_info)
                     now = time.time()
                     if color_metrics:
                         self.color_history.append((now, color_metrics["mean"]))
@@ -0,0 +1,424 @@
+#include "preview_encoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include <jpeglib.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// libjpeg reports errors through a callback that must not return; it longjmps back into compress().
+struct PreviewJpegState
+{
+    struct ErrorManager
+    {
+        jpeg_error_mgr pub;
+        std::jmp_buf jump;
+    };
+
+    // Writes into a std::vector that only ever grows, so a pooled frame stops allocating after a few frames.
+    struct Destination
+    {
+        jpeg_destination_mgr pub;
+        std::vector<uint8_t>* out = nullptr;
+    };
+
+    jpeg_compress_struct cinfo;
+    ErrorManager error;
+    Destination destination;
+    bool created = false;
+
+    PreviewJpegState();
+    ~PreviewJpegState();
+};
+
+namespace
+{
+constexpr size_t kInitialJpegBytes = 64 * 1024;
+
+void on_error(j_common_ptr cinfo)
+{
+    auto* error = reinterpret_cast<PreviewJpegState::ErrorManager*>(cinfo->err);
+    std::longjmp(error->jump, 1);
+}
+
+void on_message(j_common_ptr) {}
+
+void init_destination(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<PreviewJpegState::Destination*>(cinfo->dest);
+    std::vector<uint8_t>& out = *dest->out;
+    out.resize(std::max(out.capacity(), kInitialJpegBytes));
+    dest->pub.next_output_byte = out.data();
+    dest->pub.free_in_buffer = out.size();
+}
+
+// Called when the buffer is full, whatever free_in_buffer says
+boolean empty_output_buffer(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<PreviewJpegState::Destination*>(cinfo->dest);
+    std::vector<uint8_t>& out = *dest->out;
+    const size_t used = out.size();
+    out.resize(used * 2);
+    dest->pub.next_output_byte = out.data() + used;
+    dest->pub.free_in_buffer = out.size() - used;
+    return TRUE;
+}
+
+void term_destination(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<PreviewJpegState::Destination*>(cinfo->dest);
+    dest->out->resize(dest->out->size() - dest->pub.free_in_buffer);
+}
+
+// No object with a destructor may live between the setjmp() and a longjmp() out of libjpeg.
+bool compress(PreviewJpegState& state, const uint8_t* pixels, int width, int height, size_t stride, int quality,
+              std::vector<uint8_t>& out, std::vector<uint8_t>& row)
+{
+    if (!state.created)
+    {
+        return false;
+    }
+#ifndef JCS_EXTENSIONS
+    row.resize(static_cast<size_t>(width) * 3);
+#else
+    (void)row;
+#endif
+    jpeg_compress_struct& cinfo = state.cinfo;
+    state.destination.out = &out;
+    if (setjmp(state.error.jump))
+    {
+        jpeg_abort_compress(&cinfo);
+        return false;
+    }
+    cinfo.image_width = static_cast<JDIMENSION>(width);
+    cinfo.image_height = static_cast<JDIMENSION>(height);
+    cinfo.input_components = 3;
+#ifdef JCS_EXTENSIONS
+    cinfo.in_color_space = JCS_EXT_BGR;
+#else
+    cinfo.in_color_space = JCS_RGB;
+#endif
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, std::clamp(quality, 1, 100), TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height)
+    {
+        const uint8_t* src = pixels + static_cast<size_t>(cinfo.next_scanline) * stride;
+#ifdef JCS_EXTENSIONS
+        JSAMPROW line = const_cast<JSAMPROW>(src);
+#else
+        for (int x = 0; x < width; ++x)
+        {
+            row[x * 3] = src[x * 3 + 2];
+            row[x * 3 + 1] = src[x * 3 + 1];
+            row[x * 3 + 2] = src[x * 3];
+        }
+        JSAMPROW line = row.data();
+#endif
+        jpeg_write_scanlines(&cinfo, &line, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    return true;
+}
+
+void output_size(const PreviewEncoderConfig& config, int src_width, int src_height, int& width, int& height)
+{
+    width = config.width;
+    height = config.height;
+    if (width <= 0 && height <= 0)
+    {
+        width = src_width;
+        height = src_height;
+    }
+    else if (width <= 0)
+    {
+        width = static_cast<int>(static_cast<int64_t>(height) * src_width / src_height);
+    }
+    else if (height <= 0)
+    {
+        height = static_cast<int>(static_cast<int64_t>(width) * src_height / src_width);
+    }
+    width = std::clamp(width, 1, src_width);
+    height = std::clamp(height, 1, src_height);
+}
+
+void lower_thread_priority(int nice)
+{
+#ifdef __linux__
+    if (nice == 0)
+    {
+        return;
+    }
+    // Linux applies setpriority() to a single thread when given its tid
+    const id_t tid = static_cast<id_t>(syscall(SYS_gettid));
+    errno = 0;
+    const int current = getpriority(PRIO_PROCESS, tid);
+    if (errno == 0 && setpriority(PRIO_PROCESS, tid, std::min(19, current + nice)) != 0)
+    {
+        std::perror("preview encoder: setpriority");
+    }
+#else
+    (void)nice;
+#endif
+}
+} // namespace
+
+PreviewJpegState::PreviewJpegState()
+{
+    std::memset(&cinfo, 0, sizeof(cinfo));
+    cinfo.err = jpeg_std_error(&error.pub);
+    error.pub.error_exit = on_error;
+    error.pub.output_message = on_message;
+    if (setjmp(error.jump))
+    {
+        return;
+    }
+    jpeg_create_compress(&cinfo);
+    destination.pub.init_destination = init_destination;
+    destination.pub.empty_output_buffer = empty_output_buffer;
+    destination.pub.term_destination = term_destination;
+    cinfo.dest = &destination.pub;
+    created = true;
+}
+
+PreviewJpegState::~PreviewJpegState()
+{
+    if (created)
+    {
+        jpeg_destroy_compress(&cinfo);
+    }
+}
+
+void downscale_bgr(const uint8_t* src, int src_width, int src_height, size_t src_stride, uint8_t* dst, int dst_width,
+                   int dst_height)
+{
+    if (src_width == dst_width * 2 && src_height == dst_height * 2)
+    {
+        // The usual preview case (640x480 to 320x240): fixed 2x2 boxes
+        for (int y = 0; y < dst_height; ++y)
+        {
+            const uint8_t* top = src + static_cast<size_t>(y) * 2 * src_stride;
+            const uint8_t* bottom = top + src_stride;
+            uint8_t* out = dst + static_cast<size_t>(y) * dst_width * 3;
+            for (int i = 0; i < dst_width * 3; i += 3)
+            {
+                const int s = i * 2;
+                out[i] = static_cast<uint8_t>((top[s] + top[s + 3] + bottom[s] + bottom[s + 3] + 2) >> 2);
+                out[i + 1] = static_cast<uint8_t>((top[s + 1] + top[s + 4] + bottom[s + 1] + bottom[s + 4] + 2) >> 2);
+                out[i + 2] = static_cast<uint8_t>((top[s + 2] + top[s + 5] + bottom[s + 2] + bottom[s + 5] + 2) >> 2);
+            }
+        }
+        return;
+    }
+    for (int y = 0; y < dst_height; ++y)
+    {
+        const int y0 = static_cast<int>(static_cast<int64_t>(y) * src_height / dst_height);
+        const int y1 = std::max(y0 + 1, static_cast<int>(static_cast<int64_t>(y + 1) * src_height / dst_height));
+        uint8_t* out = dst + static_cast<size_t>(y) * dst_width * 3;
+        for (int x = 0; x < dst_width; ++x)
+        {
+            const int x0 = static_cast<int>(static_cast<int64_t>(x) * src_width / dst_width);
+            const int x1 = std::max(x0 + 1, static_cast<int>(static_cast<int64_t>(x + 1) * src_width / dst_width));
+            uint32_t b = 0;
+            uint32_t g = 0;
+            uint32_t r = 0;
+            for (int sy = y0; sy < y1; ++sy)
+            {
+                const uint8_t* p = src + static_cast<size_t>(sy) * src_stride + static_cast<size_t>(x0) * 3;
+                for (int sx = x0; sx < x1; ++sx, p += 3)
+                {
+                    b += p[0];
+                    g += p[1];
+                    r += p[2];
+                }
+            }
+            const uint32_t n = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+            out[x * 3] = static_cast<uint8_t>((b + n / 2) / n);
+            out[x * 3 + 1] = static_cast<uint8_t>((g + n / 2) / n);
+            out[x * 3 + 2] = static_cast<uint8_t>((r + n / 2) / n);
+        }
+    }
+}
+
+PreviewEncoder::PreviewEncoder(const PreviewEncoderConfig& config)
+    : config_(config), jpeg_(std::make_unique<PreviewJpegState>())
+{
+    config_.pool_size = std::max<size_t>(1, config_.pool_size);
+    pool_.reserve(config_.pool_size);
+    thread_ = std::thread(&PreviewEncoder::run, this);
+}
+
+PreviewEncoder::~PreviewEncoder()
+{
+    close();
+}
+
+bool PreviewEncoder::submit(const uint8_t* bgr, int width, int height, size_t stride_bytes)
+{
+    if (!bgr || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+    const size_t row_bytes = static_cast<size_t>(width) * 3;
+    bool replaced = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return false;
+        }
+        replaced = has_pending_;
+        pending_.pixels.resize(row_bytes * height);
+        for (int y = 0; y < height; ++y)
+        {
+            std::memcpy(pending_.pixels.data() + y * row_bytes, bgr + y * stride_bytes, row_bytes);
+        }
+        pending_.width = width;
+        pending_.height = height;
+        pending_.sequence = ++sequence_;
+        has_pending_ = true;
+        ++stats_.submitted;
+        if (replaced)
+        {
+            ++stats_.replaced;
+        }
+    }
+    submitted_.notify_one();
+    return !replaced;
+}
+
+std::shared_ptr<const PreviewFrame> PreviewEncoder::latest() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+}
+
+std::shared_ptr<const PreviewFrame> PreviewEncoder::wait_newer(uint64_t after_sequence,
+                                                               std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const bool ready = encoded_.wait_for(lock, timeout, [&] {
+        return closed_ || (latest_ && latest_->sequence > after_sequence);
+    });
+    if (!ready || closed_)
+    {
+        return nullptr;
+    }
+    return latest_;
+}
+
+PreviewEncoderStats PreviewEncoder::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PreviewEncoder::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    submitted_.notify_all();
+    encoded_.notify_all();
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id())
+    {
+        thread_.join();
+    }
+}
+
+// A pooled frame nobody but the pool references (latest_ counts as a reference), or a new one while the
+// pool is not full.
+std::shared_ptr<PreviewFrame> PreviewEncoder::free_frame()
+{
+    for (const auto& frame : pool_)
+    {
+        if (frame.use_count() == 1)
+        {
+            // Pairs with the release in the last holder's shared_ptr destructor
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return frame;
+        }
+    }
+    if (pool_.size() < config_.pool_size)
+    {
+        pool_.push_back(std::make_shared<PreviewFrame>());
+        return pool_.back();
+    }
+    return nullptr;
+}
+
+bool PreviewEncoder::encode(const Input& input, PreviewFrame& frame)
+{
+    const auto start = std::chrono::steady_clock::now();
+    int width = 0;
+    int height = 0;
+    output_size(config_, input.width, input.height, width, height);
+    const uint8_t* pixels = input.pixels.data();
+    size_t stride = static_cast<size_t>(input.width) * 3;
+    if (width != input.width || height != input.height)
+    {
+        scaled_.resize(static_cast<size_t>(width) * height * 3);
+        downscale_bgr(pixels, input.width, input.height, stride, scaled_.data(), width, height);
+        pixels = scaled_.data();
+        stride = static_cast<size_t>(width) * 3;
+    }
+    if (!compress(*jpeg_, pixels, width, height, stride, config_.quality, frame.jpeg, row_))
+    {
+        return false;
+    }
+    frame.width = width;
+    frame.height = height;
+    frame.encode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void PreviewEncoder::run()
+{
+    lower_thread_priority(config_.nice);
+    Input work;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            submitted_.wait(lock, [this] { return has_pending_ || closed_; });
+            if (closed_)
+            {
+                return;
+            }
+            // Hands the previous frame's buffer back to submit() for reuse
+            std::swap(work, pending_);
+            has_pending_ = false;
+        }
+
+        std::shared_ptr<PreviewFrame> frame = free_frame();
+        const bool ok = frame && encode(work, *frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!frame)
+            {
+                ++stats_.pool_exhausted;
+                continue;
+            }
+            if (!ok)
+            {
+                ++stats_.failed;
+                continue;
+            }
+            frame->sequence = work.sequence;
+            latest_ = frame;
+            ++stats_.encoded;
+        }
+        encoded_.notify_all();
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+// JPEG preview of the color stream, encoded once per frame on a thread of its own for every subscriber.
+// submit() copies the BGR frame and returns at once; the encoder thread (niced, so it yields to the
+// liveness math) downscales and encodes the newest submitted frame into a buffer from a small pool.
+// A frame that arrives while the previous one is still waiting is replaced, not queued, and subscribers
+// always get the newest encoded frame, so a slow encoder or a slow reader skips frames instead of
+// adding latency.
+// Needs libjpeg-turbo (BGR input without a conversion pass); plain libjpeg works with a per-row swap.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct PreviewEncoderConfig
+{
+    int width = 0;         // output size; 0 = source size, or scaled to keep the aspect when the other is set
+    int height = 0;        // never larger than the source
+    int quality = 80;      // libjpeg quality, 1-100
+    size_t pool_size = 3;  // encoded frames in flight: the newest plus ones subscribers still hold
+    int nice = 10;         // added to the encoder thread's nice value (Linux); 0 = leave it
+};
+
+struct PreviewFrame
+{
+    std::vector<uint8_t> jpeg;  // capacity is kept across reuse
+    uint64_t sequence = 0;      // of the submitted frame, counting from 1
+    int width = 0;
+    int height = 0;
+    double encode_ms = 0.0;     // downscale and encode
+};
+
+struct PreviewEncoderStats
+{
+    uint64_t submitted = 0;
+    uint64_t encoded = 0;
+    uint64_t replaced = 0;       // submitted frames dropped for a newer one before they were encoded
+    uint64_t pool_exhausted = 0; // frames skipped because subscribers held every pooled buffer
+    uint64_t failed = 0;
+};
+
+class PreviewEncoder
+{
+  public:
+    explicit PreviewEncoder(const PreviewEncoderConfig& config = PreviewEncoderConfig{});
+    ~PreviewEncoder();
+
+    PreviewEncoder(const PreviewEncoder&) = delete;
+    PreviewEncoder& operator=(const PreviewEncoder&) = delete;
+
+    // Copies a packed BGR8 frame (rows `stride_bytes` apart) for encoding. Returns false if it replaced a
+    // frame that had not been encoded yet, or after close().
+    bool submit(const uint8_t* bgr, int width, int height, size_t stride_bytes);
+
+    // Newest encoded frame, or null before the first one.
+    std::shared_ptr<const PreviewFrame> latest() const;
+    // Waits up to `timeout` for a frame newer than `after_sequence`; null on timeout or after close().
+    std::shared_ptr<const PreviewFrame> wait_newer(uint64_t after_sequence, std::chrono::milliseconds timeout) const;
+
+    PreviewEncoderStats stats() const;
+    // Stops the encoder thread and wakes every waiter; further submit() calls are ignored.
+    void close();
+
+  private:
+    struct Input
+    {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+        uint64_t sequence = 0;
+    };
+
+    void run();
+    std::shared_ptr<PreviewFrame> free_frame();
+    bool encode(const Input& input, PreviewFrame& frame);
+
+    PreviewEncoderConfig config_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable submitted_;
+    mutable std::condition_variable encoded_;
+    Input pending_;            // written by submit(), swapped out by the encoder thread
+    bool has_pending_ = false;
+    bool closed_ = false;
+    uint64_t sequence_ = 0;
+    std::shared_ptr<PreviewFrame> latest_;
+    PreviewEncoderStats stats_;
+
+    // Encoder thread only
+    std::vector<std::shared_ptr<PreviewFrame>> pool_;
+    std::vector<uint8_t> scaled_;
+    std::vector<uint8_t> row_;
+    std::unique_ptr<struct PreviewJpegState> jpeg_;
+    std::thread thread_;
+};
+
+// Box-filter downscale of packed BGR8; dst is dst_width * dst_height * 3 bytes, dst size <= src size.
+void downscale_bgr(const uint8_t* src, int src_width, int src_height, size_t src_stride, uint8_t* dst, int dst_width,
+                   int dst_height);
@@ -0,0 +1,1258 @@
+#include "control_socket.hpp"
+#include "depth_engine.hpp"
+#include "sensor_fusion.hpp"
+#include "stream_settle.hpp"
+#include "temporal_liveness.hpp"
+#include "tof_proximity.hpp"
+
+// controller/tof
+#include "distance_filter.hpp"
+#include "event_gate.hpp"
+#include "metrics.hpp"
+#include "realtime.hpp"
+#include "shm_channel.hpp"
+#include "timing_profile.hpp"
+#include "tof_reader.hpp"
+
+#include <librealsense2/rs.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+std::atomic<bool> g_should_exit{false};
+
+void signal_handler(int)
+{
+    g_should_exit.store(true);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Longest the sensor threads go without looking at a stop request or, idle, at the mode and the ToF.
+constexpr uint64_t kPollMs = 20;
+// Longest the depth thread waits on one frame.
+constexpr unsigned int kFrameWaitMs = 100;
+// Pause before a sensor that failed to start (not plugged in yet, bus error) is tried again.
+constexpr uint64_t kRetryMs = 1000;
+
+enum class DepthMode
+{
+    Off,   // cameras closed
+    On,    // streaming
+    Auto,  // streaming while the ToF sees someone, like d435i-liveness --wake-shm
+};
+
+const char* depth_mode_name(DepthMode mode)
+{
+    switch (mode)
+    {
+    case DepthMode::On:
+        return "on";
+    case DepthMode::Auto:
+        return "auto";
+    case DepthMode::Off:
+        break;
+    }
+    return "off";
+}
+
+bool parse_depth_mode(const std::string& text, DepthMode& mode)
+{
+    if (text == "on")
+    {
+        mode = DepthMode::On;
+    }
+    else if (text == "auto")
+    {
+        mode = DepthMode::Auto;
+    }
+    else if (text == "off")
+    {
+        mode = DepthMode::Off;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// Everything reconfigure can change; the ToF thread and each depth session work on their own copy.
+struct DaemonConfig
+{
+    ToFConfig tof;
+    FilterConfig filter;
+    EventConfig events;  // without thresholds or delta_mm every sample is an event
+    ProximityConfig gate;
+    LivenessConfig liveness;
+    StreamSettleConfig settle;
+    int depth_width = 640;
+    int depth_height = 480;
+    int fps = 30;
+    double max_skew_ms = 100.0;
+    ThreadRealtime tof_rt;
+    ThreadRealtime depth_rt;
+    bool prefault = false;  // --mlock: touch each thread's stack before it starts working
+};
+
+// The ToFConfig fields tof-reader's main() derives from --hz and the timing budget.
+void finish_tof_config(ToFConfig& tof)
+{
+    if (tof.simulate)
+    {
+        // The model does not follow the budget; with --adaptive the shortest preset never caps the fast period
+        tof.sim.measurementMicroseconds = tof.adaptive_timing ? timing_preset(TimingProfile::Fast).budget_us
+                                                              : static_cast<uint32_t>(tof.timing_budget_ms) * 1000U;
+    }
+    if (tof.continuous)
+    {
+        tof.inter_measurement_ms = std::max({1, tof.timing_budget_ms, 1000 / std::max(1, tof.output_hz)});
+    }
+}
+
+// The ToF thread's filtered samples for the depth thread: the newest kLength for pair_tof() and the presence
+// decision behind DepthMode::Auto. Takes the place of the tof-reader --shm segment d435i-liveness reads;
+// a mutex is plenty at tens of samples per second.
+class ToFHistory
+{
+  public:
+    static constexpr size_t kLength = ToFProximity::kHistoryLength;
+
+    explicit ToFHistory(const ProximityConfig& gate) : presence_(gate) {}
+
+    void push(const ToFMeasurement& m)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples_[count_ % kLength] = ToFSample{m.timestamp_ms, m.sequence, m.distance_mm, m.status};
+        ++count_;
+    }
+
+    // Oldest first; returns how many were copied.
+    size_t copy(ToFSample* out) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(count_, kLength));
+        for (size_t k = 0; k < n; ++k)
+        {
+            out[k] = samples_[(count_ - n + k) % kLength];
+        }
+        return n;
+    }
+
+    // Brings the presence decision up to date with the newest sample; `distance_mm` gets the latest fresh
+    // valid range, or -1.
+    bool present(int* distance_mm = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        presence_.update(count_ ? &samples_[(count_ - 1) % kLength] : nullptr, monotonic_millis());
+        if (distance_mm)
+        {
+            *distance_mm = presence_.distance_mm();
+        }
+        return presence_.present();
+    }
+
+    void set_gate(const ProximityConfig& gate)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        presence_ = PresenceDetector(gate);
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    ToFSample samples_[kLength] = {};
+    uint64_t count_ = 0;
+    PresenceDetector presence_;
+};
+
+// What the threads count for --metrics and the status reply; totals over every ToF and depth session.
+struct DaemonMetrics
+{
+    std::atomic<uint64_t> tof_samples{0};     // read from the sensor, valid range or not
+    std::atomic<uint64_t> tof_events{0};      // ToF events broadcast, after the event gate
+    std::atomic<uint64_t> tof_starts{0};      // sensor initialisations that succeeded
+    std::atomic<uint64_t> i2c_errors{0};
+    std::atomic<uint64_t> depth_frames{0};    // fused events broadcast
+    std::atomic<uint64_t> depth_sessions{0};  // times the streams were started
+    std::atomic<uint64_t> sensor_gaps{0};     // frames librealsense dropped before we saw them
+    LatencyHistogram tof_read;                // one read that returned a sample
+    LatencyHistogram depth_process;           // frame arrival to its fused event
+};
+
+int64_t micros(Clock::duration elapsed)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// Same field names as tof-reader's JSON lines, so a client parses both alike.
+std::string format_tof_event(const ToFMeasurement& m)
+{
+    char line[224];
+    const int n = std::snprintf(line, sizeof(line),
+                                "{\"event\":\"tof\",\"distance_mm\":%u,\"status\":%u,\"signal\":%g,\"ambient\":%g,"
+                                "\"timestamp_ms\":%llu,\"sensor\":%u,\"seq\":%u}",
+                                static_cast<unsigned>(m.distance_mm), static_cast<unsigned>(m.status),
+                                static_cast<double>(m.signal_rate), static_cast<double>(m.ambient_rate),
+                                static_cast<unsigned long long>(m.timestamp_ms), static_cast<unsigned>(m.sensor_id),
+                                static_cast<unsigned>(m.sequence));
+    return std::string(line, static_cast<size_t>(std::clamp(n, 0, static_cast<int>(sizeof(line)) - 1)));
+}
+
+bool parse_integer(const std::string& text, long low, long high, long& value)
+{
+    char* end = nullptr;
+    const long parsed = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || parsed < low || parsed > high)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parse_real(const std::string& text, double low, double high, double& value)
+{
+    char* end = nullptr;
+    const double parsed = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || !(parsed >= low && parsed <= high))
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parse_flag(const std::string& text, bool& value)
+{
+    if (text != "true" && text != "false")
+    {
+        return false;
+    }
+    value = text == "true";
+    return true;
+}
+
+bool parse_filter_kind(const std::string& text, FilterKind& kind)
+{
+    if (text == "none")
+    {
+        kind = FilterKind::None;
+    }
+    else if (text == "median")
+    {
+        kind = FilterKind::Median;
+    }
+    else if (text == "ema")
+    {
+        kind = FilterKind::Ema;
+    }
+    else if (text == "kalman")
+    {
+        kind = FilterKind::Kalman;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// "300,600"; empty for none.
+bool parse_mm_list(const std::string& text, std::vector<uint16_t>& values)
+{
+    values.clear();
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        long mm = 0;
+        if (!parse_integer(item, 1, 65535, mm))
+        {
+            return false;
+        }
+        values.push_back(static_cast<uint16_t>(mm));
+    }
+    return true;
+}
+
+// One reconfigure member. `config` is a copy: nothing is applied unless every member is valid.
+bool apply_setting(DaemonConfig& config, const std::string& key, const std::string& value, std::string& error)
+{
+    long integer = 0;
+    double real = 0.0;
+    bool flag = false;
+    bool ok = true;
+    if (key == "hz")
+    {
+        ok = parse_integer(value, 1, 100, integer);
+        config.tof.output_hz = static_cast<int>(integer);
+    }
+    else if (key == "continuous" || key == "adaptive")
+    {
+        ok = parse_flag(value, flag);
+        (key == "continuous" ? config.tof.continuous : config.tof.adaptive_timing) = flag;
+    }
+    else if (key == "filter")
+    {
+        ok = parse_filter_kind(value, config.filter.kind);
+    }
+    else if (key == "thresholds")
+    {
+        ok = parse_mm_list(value, config.events.thresholds_mm);
+    }
+    else if (key == "delta_mm" || key == "hysteresis_mm")
+    {
+        ok = parse_integer(value, 0, 65535, integer);
+        (key == "delta_mm" ? config.events.delta_mm : config.events.hysteresis_mm) = static_cast<uint16_t>(integer);
+    }
+    else if (key == "heartbeat_ms")
+    {
+        ok = parse_integer(value, 0, 3600 * 1000, integer);
+        config.events.heartbeat_ms = static_cast<uint64_t>(integer);
+    }
+    else if (key == "wake_mm")
+    {
+        ok = parse_integer(value, 1, 65535, integer);
+        config.gate.wake_mm = static_cast<int>(integer);
+    }
+    else if (key == "idle_s")
+    {
+        ok = parse_real(value, 0.0, 3600.0, config.gate.idle_s);
+    }
+    else if (key == "window_s")
+    {
+        ok = parse_real(value, 0.0, 60.0, config.liveness.window_s);
+    }
+    else if (key == "min_range_m" || key == "min_stdev_m")
+    {
+        ok = parse_real(value, 0.0, 10.0, real);
+        (key == "min_range_m" ? config.liveness.min_range_m : config.liveness.min_stdev_m) = real;
+    }
+    else if (key == "min_samples")
+    {
+        ok = parse_integer(value, 1, 10000000, integer);
+        config.liveness.min_samples = static_cast<size_t>(integer);
+    }
+    else if (key == "roi_ratio")
+    {
+        ok = parse_real(value, 0.01, 1.0, real);
+        config.liveness.roi_ratio = static_cast<float>(real);
+    }
+    else if (key == "stride")
+    {
+        ok = parse_integer(value, 1, 64, integer);
+        config.liveness.stride = static_cast<unsigned int>(integer);
+    }
+    else if (key == "decimate")
+    {
+        ok = parse_integer(value, 1, 8, integer);
+        config.liveness.filters.decimation = static_cast<int>(integer);
+    }
+    else if (key == "spatial" || key == "temporal" || key == "hole_fill")
+    {
+        ok = parse_flag(value, flag);
+        DepthFilterConfig& filters = config.liveness.filters;
+        (key == "spatial" ? filters.spatial : key == "temporal" ? filters.temporal : filters.hole_fill) = flag;
+    }
+    else if (key == "depth_res")
+    {
+        ok = parse_resolution(value.c_str(), config.depth_width, config.depth_height);
+    }
+    else if (key == "fps")
+    {
+        ok = parse_integer(value, 1, 300, integer);
+        config.fps = static_cast<int>(integer);
+    }
+    else if (key == "max_skew_ms")
+    {
+        ok = parse_real(value, 0.0, 10000.0, config.max_skew_ms);
+    }
+    else
+    {
+        error = "unknown setting \"" + key + "\"";
+        return false;
+    }
+    if (!ok)
+    {
+        error = "\"" + key + "\": invalid value \"" + value + "\"";
+    }
+    return ok;
+}
+
+// Which parts of the daemon a reconfigure has to restart.
+struct Restarts
+{
+    bool tof = false;    // the ToF thread, with a freshly initialised sensor
+    bool depth = false;  // the depth session: at once while streaming, else the next one picks it up
+    bool gate = false;   // the presence decision, from the next sample
+};
+
+// Compares every setting apply_setting() can change, so a reconfigure that repeats the current values (each
+// controller sends its settings on connect) restarts nothing under the other clients.
+Restarts changed_parts(const DaemonConfig& before, const DaemonConfig& after)
+{
+    const ToFConfig& t0 = before.tof;
+    const ToFConfig& t1 = after.tof;
+    const EventConfig& e0 = before.events;
+    const EventConfig& e1 = after.events;
+    const LivenessConfig& l0 = before.liveness;
+    const LivenessConfig& l1 = after.liveness;
+    const DepthFilterConfig& f0 = l0.filters;
+    const DepthFilterConfig& f1 = l1.filters;
+    Restarts restarts;
+    restarts.tof = t0.output_hz != t1.output_hz || t0.continuous != t1.continuous ||
+                   t0.adaptive_timing != t1.adaptive_timing || before.filter.kind != after.filter.kind ||
+                   e0.thresholds_mm != e1.thresholds_mm || e0.hysteresis_mm != e1.hysteresis_mm ||
+                   e0.delta_mm != e1.delta_mm || e0.heartbeat_ms != e1.heartbeat_ms;
+    restarts.gate = before.gate.wake_mm != after.gate.wake_mm || before.gate.idle_s != after.gate.idle_s;
+    restarts.depth = l0.window_s != l1.window_s || l0.min_range_m != l1.min_range_m ||
+                     l0.min_stdev_m != l1.min_stdev_m || l0.min_samples != l1.min_samples ||
+                     l0.roi_ratio != l1.roi_ratio || l0.stride != l1.stride || f0.decimation != f1.decimation ||
+                     f0.spatial != f1.spatial || f0.temporal != f1.temporal || f0.hole_fill != f1.hole_fill ||
+                     before.depth_width != after.depth_width || before.depth_height != after.depth_height ||
+                     before.fps != after.fps || before.max_skew_ms != after.max_skew_ms;
+    return restarts;
+}
+
+// The ToF reader, the depth liveness engine and their fusion as threads of one process, driven through the
+// control socket (control_socket.hpp) instead of one tof-reader and one d435i-liveness subprocess each.
+//   ToF thread    reads the sensor, filters, fills ToFHistory (and --shm for other readers) and broadcasts
+//                 ToF events through the event gate
+//   depth thread  streams the camera while the depth mode asks for it, evaluates every frame and broadcasts
+//                 it fused with the ToF readings around it, plus the smoothed verdict whenever it flips
+//   main thread   serves the socket; handle() runs there
+class SensorDaemon
+{
+  public:
+    SensorDaemon(const DaemonConfig& config, DepthMode mode, std::string shm_name, ControlSocket& socket,
+                 DaemonMetrics& metrics)
+        : socket_(socket), metrics_(metrics), shm_name_(std::move(shm_name)), history_(config.gate),
+          config_(config), depth_mode_(mode)
+    {
+    }
+
+    ~SensorDaemon() { shutdown(); }
+
+    SensorDaemon(const SensorDaemon&) = delete;
+    SensorDaemon& operator=(const SensorDaemon&) = delete;
+
+    void start(bool tof)
+    {
+        if (tof)
+        {
+            start_tof();
+        }
+        depth_thread_ = std::thread(&SensorDaemon::depth_loop, this);
+    }
+
+    void shutdown()
+    {
+        stop_tof();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        depth_wake_.notify_all();
+        if (depth_thread_.joinable())
+        {
+            depth_thread_.join();
+        }
+    }
+
+    std::string handle(const ControlRequest& request);
+
+  private:
+    void start_tof();
+    void stop_tof();
+    void tof_loop(DaemonConfig config);
+    bool run_tof(ToFReader& reader, const DaemonConfig& config, ShmPublisher& shm);
+    void depth_loop();
+    void stream_depth(rs2::pipeline& pipe, const DaemonConfig& config);
+    bool should_stream_locked();
+    bool keep_streaming();
+    void set_state(const char* sensor, std::atomic<const char*>& current, const char* state);
+    void report_error(const char* sensor, const std::string& message);
+    // true while stop_tof() was not called
+    bool sleep_unless_stopped(uint64_t ms) const;
+    std::string status_fields();
+
+    ControlSocket& socket_;
+    DaemonMetrics& metrics_;
+    const std::string shm_name_;
+    ToFHistory history_;
+
+    std::mutex mutex_;  // config_, depth_mode_, depth_restart_, stopping_
+    std::condition_variable depth_wake_;
+    DaemonConfig config_;
+    DepthMode depth_mode_;
+    bool depth_restart_ = false;  // reconfigured: the next (or current) session takes the new config_
+    bool stopping_ = false;
+
+    std::thread tof_thread_;  // started and stopped from the main thread only
+    std::atomic<bool> tof_stop_{false};
+    std::atomic<const char*> tof_state_{"stopped"};   // stopped, starting, running, failed
+    std::thread depth_thread_;
+    std::atomic<const char*> depth_state_{"idle"};    // idle, starting, settling, streaming, failed
+};
+
+void SensorDaemon::set_state(const char* sensor, std::atomic<const char*>& current, const char* state)
+{
+    if (current.exchange(state) != state)
+    {
+        socket_.broadcast(std::string("{\"event\":\"state\",\"sensor\":\"") + sensor + "\",\"state\":\"" + state +
+                          "\"}");
+    }
+}
+
+void SensorDaemon::report_error(const char* sensor, const std::string& message)
+{
+    std::cerr << "sensor-daemon " << sensor << ": " << message << std::endl;
+    socket_.broadcast(std::string("{\"event\":\"error\",\"sensor\":\"") + sensor +
+                      "\",\"message\":" + json_string(message) + "}");
+}
+
+bool SensorDaemon::sleep_unless_stopped(uint64_t ms) const
+{
+    for (uint64_t slept = 0; slept < ms && !tof_stop_.load(std::memory_order_relaxed); slept += kPollMs)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(kPollMs, ms - slept)));
+    }
+    return !tof_stop_.load(std::memory_order_relaxed);
+}
+
+void SensorDaemon::start_tof()
+{
+    if (tof_thread_.joinable())
+    {
+        return;
+    }
+    DaemonConfig config;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config = config_;
+    }
+    tof_stop_.store(false);
+    // Here rather than only in the thread, so the reply to start (or reconfigure) already shows it
+    set_state("tof", tof_state_, "starting");
+    tof_thread_ = std::thread(&SensorDaemon::tof_loop, this, std::move(config));
+}
+
+void SensorDaemon::stop_tof()
+{
+    if (!tof_thread_.joinable())
+    {
+        return;
+    }
+    tof_stop_.store(true);
+    tof_thread_.join();
+}
+
+// Keeps a sensor running until stop_tof(): initialises it, reads until it fails, then tries again.
+void SensorDaemon::tof_loop(DaemonConfig config)
+{
+    set_thread_name("daemon-tof");
+    apply_thread_realtime("tof", config.tof_rt);
+    if (config.prefault)
+    {
+        prefault_stack();
+    }
+    finish_tof_config(config.tof);
+    ShmPublisher shm;
+    if (!shm_name_.empty() && !shm.open(shm_name_))
+    {
+        report_error("tof", "cannot publish to shared memory " + shm_name_);
+    }
+    while (!tof_stop_.load(std::memory_order_relaxed))
+    {
+        set_state("tof", tof_state_, "starting");
+        ToFReader reader(config.tof);
+        bool ok = false;
+        try
+        {
+            if (reader.init())
+            {
+                ok = run_tof(reader, config, shm);
+            }
+            else
+            {
+                report_error("tof", "failed to initialize VL53L0X");
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            report_error("tof", std::string("VL53L0X I/O error: ") + ex.what());
+        }
+        if (!ok && !tof_stop_.load(std::memory_order_relaxed))
+        {
+            set_state("tof", tof_state_, "failed");
+            sleep_unless_stopped(kRetryMs);
+        }
+    }
+    set_state("tof", tof_state_, "stopped");
+}
+
+// tof-reader's acquisition loop for one sensor, with the emitter's filter and event gate inline: a mutex
+// and an eventfd write per sample are cheap enough not to need the hand-off to a second thread.
+// Returns true once stopped.
+bool SensorDaemon::run_tof(ToFReader& reader, const DaemonConfig& config, ShmPublisher& shm)
+{
+    metrics_.tof_starts.fetch_add(1, std::memory_order_relaxed);
+    set_state("tof", tof_state_, "running");
+    DistanceFilter filter(config.filter);
+    EventGate gate(config.events);
+    const bool every_sample = config.events.thresholds_mm.empty() && config.events.delta_mm == 0;
+    const uint64_t i2c_errors_base = metrics_.i2c_errors.load(std::memory_order_relaxed);
+    const bool poll_ready = config.tof.continuous && !reader.has_data_ready_irq();
+    uint64_t next_deadline = monotonic_millis();
+    uint32_t sequence = 0;
+    std::vector<ToFMeasurement> heartbeats;
+
+    while (!tof_stop_.load(std::memory_order_relaxed))
+    {
+        const auto read_start = Clock::now();
+        std::optional<ToFMeasurement> measurement = poll_ready ? reader.try_read() : reader.read_once();
+        metrics_.i2c_errors.store(i2c_errors_base + reader.counters().i2c_errors.load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+        if (measurement)
+        {
+            metrics_.tof_read.record(micros(Clock::now() - read_start));
+            metrics_.tof_samples.fetch_add(1, std::memory_order_relaxed);
+            measurement->sequence = sequence++;
+            const ToFMeasurement filtered = filter.apply(*measurement);
+            history_.push(filtered);
+            if (shm.is_open())
+            {
+                shm.publish(filtered);
+            }
+            if (every_sample || gate.should_emit(filtered, filtered.timestamp_ms))
+            {
+                socket_.broadcast(format_tof_event(filtered));
+                metrics_.tof_events.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (!every_sample)
+        {
+            // Keeps the heartbeat going while the reader delivers nothing at all
+            heartbeats.clear();
+            gate.heartbeat(monotonic_millis(), heartbeats);
+            for (const ToFMeasurement& silent : heartbeats)
+            {
+                socket_.broadcast(format_tof_event(silent));
+                metrics_.tof_events.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t now = monotonic_millis();
+        if (config.tof.continuous)
+        {
+            if (!poll_ready)
+            {
+                continue;  // read_once() already blocks on the data-ready edge
+            }
+            // Sleep until just before the next sample is due, then poll for it
+            next_deadline = reader.next_poll_ms(now);
+        }
+        else
+        {
+            next_deadline = std::max(next_deadline + reader.period_ms(), now);
+        }
+        if (next_deadline > now)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(next_deadline - now, kPollMs * 10)));
+        }
+    }
+    return true;
+}
+
+bool SensorDaemon::should_stream_locked()
+{
+    switch (depth_mode_)
+    {
+    case DepthMode::On:
+        return true;
+    case DepthMode::Auto:
+        return history_.present();
+    case DepthMode::Off:
+        break;
+    }
+    return false;
+}
+
+bool SensorDaemon::keep_streaming()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !stopping_ && !depth_restart_ && should_stream_locked();
+}
+
+// Waits for the depth mode (and, in auto, the ToF) to ask for streams, then runs sessions until shutdown().
+void SensorDaemon::depth_loop()
+{
+    set_thread_name("daemon-depth");
+    DaemonConfig config;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config = config_;
+    }
+    if (config.prefault)
+    {
+        prefault_stack();
+    }
+    std::unique_ptr<rs2::context> ctx;
+    std::unique_ptr<rs2::pipeline> pipe;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            depth_wake_.wait_for(lock, std::chrono::milliseconds(kPollMs),
+                                 [this] { return stopping_ || depth_mode_ == DepthMode::On; });
+            if (stopping_)
+            {
+                break;
+            }
+            depth_restart_ = false;
+            if (!should_stream_locked())
+            {
+                continue;
+            }
+            config = config_;
+        }
+        try
+        {
+            if (!pipe)
+            {
+                ctx = std::make_unique<rs2::context>();
+                pipe = std::make_unique<rs2::pipeline>(*ctx);
+            }
+            stream_depth(*pipe, config);
+        }
+        catch (const rs2::error& e)
+        {
+            report_error("depth", std::string("RealSense error: ") + e.get_failed_function() + ": " + e.what());
+            // Start over with a new pipeline: this one may still hold the device
+            pipe.reset();
+            ctx.reset();
+            set_state("depth", depth_state_, "failed");
+            // Until the retry is due, or sooner on shutdown(), a start/stop or a reconfigure
+            std::unique_lock<std::mutex> lock(mutex_);
+            const DepthMode mode = depth_mode_;
+            depth_wake_.wait_for(lock, std::chrono::milliseconds(kRetryMs),
+                                 [this, mode] { return stopping_ || depth_restart_ || depth_mode_ != mode; });
+        }
+    }
+    set_state("depth", depth_state_, "idle");
+}
+
+// One streaming session, run_blocking() of d435i-liveness with the fused event as its output.
+void SensorDaemon::stream_depth(rs2::pipeline& pipe, const DaemonConfig& config)
+{
+    int distance_mm = -1;
+    history_.present(&distance_mm);
+    std::cerr << "sensor-daemon depth: starting streams (ToF " << distance_mm << " mm)" << std::endl;
+    set_state("depth", depth_state_, "starting");
+    const auto started = Clock::now();
+    rs2::config cfg;
+    cfg.enable_stream(RS2_STREAM_COLOR, 640, 480, RS2_FORMAT_BGR8, config.fps);
+    cfg.enable_stream(RS2_STREAM_DEPTH, config.depth_width, config.depth_height, RS2_FORMAT_Z16, config.fps);
+    const rs2::pipeline_profile profile = pipe.start(cfg);
+    // After start(), so the threads librealsense spawns there do not inherit the policy and affinity
+    apply_thread_realtime("depth", config.depth_rt);
+    metrics_.depth_sessions.fetch_add(1, std::memory_order_relaxed);
+
+    const RoiSpec depth_roi = select_depth_roi(profile, config.liveness, false);
+    DepthFilterChain filters(config.liveness.filters);
+    DepthHistogram histogram;
+    TemporalLiveness window = make_temporal_liveness(config.liveness);
+    StreamSettle settle(config.settle);
+    ClockMapper clock;
+    ToFSample tof[ToFHistory::kLength];
+    unsigned long long last_frame = 0;
+    bool reported = false;
+    bool live = false;
+    set_state("depth", depth_state_, settle.settled() ? "streaming" : "settling");
+
+    while (keep_streaming())
+    {
+        rs2::frameset frames;
+        if (!pipe.try_wait_for_frames(&frames, kFrameWaitMs))
+        {
+            continue;
+        }
+        const auto arrived = Clock::now();
+        if (!settle.settled())
+        {
+            if (update_settle(settle, frames, depth_roi))
+            {
+                std::cerr << "sensor-daemon depth: settled after " << settle.frames() << " frames"
+                          << (settle.timed_out() ? " (frame limit)" : "") << " in "
+                          << std::chrono::duration<double, std::milli>(Clock::now() - started).count() << " ms"
+                          << std::endl;
+                set_state("depth", depth_state_, "streaming");
+            }
+            continue;
+        }
+        auto depth = prepare_depth(frames, config.liveness.filters.enabled() ? &filters : nullptr, nullptr);
+        if (!depth)
+        {
+            continue;
+        }
+        FrameResult result = evaluate_frame(depth, depth_roi, config.liveness, histogram);
+        map_frame_time(clock, result, arrived);
+        if (last_frame != 0 && result.frame_number > last_frame + 1)
+        {
+            metrics_.sensor_gaps.fetch_add(result.frame_number - last_frame - 1, std::memory_order_relaxed);
+        }
+        last_frame = result.frame_number;
+
+        const TemporalLivenessState& state = update_window(window, result, config.liveness.min_samples);
+        const ToFPairing pairing = pair_tof(tof, history_.copy(tof), result.host_ms, config.max_skew_ms);
+        std::ostringstream line;
+        line << "{\"event\":\"depth\",";
+        write_fused_fields(line, result, state, pairing);
+        line << "}";
+        socket_.broadcast(line.str());
+        if (!reported || state.live != live)
+        {
+            std::ostringstream flip;
+            flip << std::fixed << std::setprecision(1) << "{\"event\":\"liveness\",\"live\":"
+                 << (state.live ? "true" : "false") << ",\"t_ms\":" << result.host_ms << ",\"frame\":"
+                 << result.frame_number << "}";
+            socket_.broadcast(flip.str());
+            reported = true;
+            live = state.live;
+        }
+        metrics_.depth_process.record(micros(Clock::now() - arrived));
+        metrics_.depth_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    pipe.stop();
+    std::cerr << "sensor-daemon depth: streams stopped after "
+              << std::chrono::duration<double>(Clock::now() - started).count() << " s" << std::endl;
+    set_state("depth", depth_state_, "idle");
+}
+
+std::string SensorDaemon::status_fields()
+{
+    int distance_mm = -1;
+    const bool present = history_.present(&distance_mm);
+    DaemonConfig config;
+    DepthMode mode;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config = config_;
+        mode = depth_mode_;
+    }
+    std::ostringstream out;
+    out << "\"tof\":\"" << tof_state_.load() << "\",\"depth\":\"" << depth_state_.load() << "\",\"depth_mode\":\""
+        << depth_mode_name(mode) << "\",\"present\":" << (present ? "true" : "false") << ",\"distance_mm\":";
+    if (distance_mm >= 0)
+    {
+        out << distance_mm;
+    }
+    else
+    {
+        out << "null";
+    }
+    out << ",\"clients\":" << socket_.clients() << ",\"events_dropped\":" << socket_.dropped()
+        << ",\"tof_samples\":" << metrics_.tof_samples.load(std::memory_order_relaxed)
+        << ",\"depth_frames\":" << metrics_.depth_frames.load(std::memory_order_relaxed)
+        << ",\"hz\":" << config.tof.output_hz << ",\"wake_mm\":" << config.gate.wake_mm
+        << ",\"depth_res\":\"" << config.depth_width << "x" << config.depth_height << "\",\"fps\":" << config.fps;
+    return out.str();
+}
+
+std::string SensorDaemon::handle(const ControlRequest& request)
+{
+    const std::string reply = "{\"reply\":" + json_string(request.cmd);
+    const auto failed = [&reply](const std::string& error) {
+        return reply + ",\"ok\":false,\"error\":" + json_string(error) + "}";
+    };
+    if (request.cmd == "status")
+    {
+        return reply + ",\"ok\":true," + status_fields() + "}";
+    }
+    if (request.cmd == "start" || request.cmd == "stop")
+    {
+        const std::string* sensor = request.find("sensor");
+        const bool tof = !sensor || *sensor == "all" || *sensor == "tof";
+        const bool depth = !sensor || *sensor == "all" || *sensor == "depth";
+        if (!tof && !depth)
+        {
+            return failed("\"sensor\" must be tof, depth or all");
+        }
+        DepthMode mode = DepthMode::Off;
+        if (request.cmd == "start")
+        {
+            const std::string* text = request.find("mode");
+            mode = DepthMode::On;
+            if (text && (!parse_depth_mode(*text, mode) || mode == DepthMode::Off))
+            {
+                return failed("\"mode\" must be on or auto");
+            }
+            if (tof)
+            {
+                start_tof();
+            }
+        }
+        else if (tof)
+        {
+            stop_tof();
+        }
+        if (depth)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                depth_mode_ = mode;
+            }
+            depth_wake_.notify_all();
+        }
+        return reply + ",\"ok\":true," + status_fields() + "}";
+    }
+    if (request.cmd == "reconfigure")
+    {
+        if (request.fields.empty())
+        {
+            return failed("nothing to reconfigure");
+        }
+        DaemonConfig config;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            config = config_;
+        }
+        const DaemonConfig before = config;
+        std::string error;
+        for (const auto& field : request.fields)
+        {
+            if (!apply_setting(config, field.first, field.second, error))
+            {
+                return failed(error);
+            }
+        }
+        const Restarts restarts = changed_parts(before, config);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            config_ = config;
+            depth_restart_ = depth_restart_ || restarts.depth;
+        }
+        depth_wake_.notify_all();
+        if (restarts.gate)
+        {
+            history_.set_gate(config.gate);
+        }
+        const bool restart_tof = restarts.tof && tof_thread_.joinable();
+        if (restart_tof)
+        {
+            stop_tof();
+            start_tof();
+        }
+        return reply + ",\"ok\":true,\"restarted\":{\"tof\":" + (restart_tof ? "true" : "false") +
+               ",\"depth\":" + (restarts.depth ? "true" : "false") + "}," + status_fields() + "}";
+    }
+    return failed("unknown cmd; expected start, stop, reconfigure or status");
+}
+
+// Prometheus text for --metrics, in the families and buckets of tof-reader and d435i-liveness.
+std::string format_metrics(const DaemonMetrics& metrics, const ControlSocket& socket)
+{
+    MetricsText text;
+    text.family("sensor_daemon_tof_samples_total", "counter", "ToF samples read, valid range or not.");
+    text.sample("sensor_daemon_tof_samples_total", metrics.tof_samples.load(std::memory_order_relaxed));
+    text.family("sensor_daemon_tof_events_total", "counter", "ToF samples broadcast after the event gate.");
+    text.sample("sensor_daemon_tof_events_total", metrics.tof_events.load(std::memory_order_relaxed));
+    text.family("sensor_daemon_tof_starts_total", "counter", "Successful ToF sensor initialisations.");
+    text.sample("sensor_daemon_tof_starts_total", metrics.tof_starts.load(std::memory_order_relaxed));
+    text.family("sensor_daemon_tof_i2c_errors_total", "counter", "Failed ToF I2C transfers.");
+    text.sample("sensor_daemon_tof_i2c_errors_total", metrics.i2c_errors.load(std::memory_order_relaxed));
+    text.family("sensor_daemon_depth_frames_total", "counter", "Depth frames evaluated and broadcast.");
+    text.sample("sensor_daemon_depth_frames_total", metrics.depth_frames.load(std::memory_order_relaxed));
+    text.family("sensor_daemon_depth_sessions_total", "counter", "Times the camera streams were started.");
+    text.sample("sensor_daemon_depth_sessions_total", metrics.depth_sessions.load(std::memory_order_relaxed));
+    text.family("sensor_daemon_dropped_total", "counter",
+                "Lost data: depth frames librealsense skipped (sensor), events a slow client missed (client).");
+    text.sample("sensor_daemon_dropped_total", metrics.sensor_gaps.load(std::memory_order_relaxed),
+                "where=\"sensor\"");
+    text.sample("sensor_daemon_dropped_total", socket.dropped(), "where=\"client\"");
+    text.family("sensor_daemon_clients", "gauge", "Connected control socket clients.");
+    text.sample("sensor_daemon_clients", static_cast<uint64_t>(socket.clients()));
+
+    text.family("sensor_daemon_stage_latency_seconds", "histogram",
+                "Per-stage latency: one ToF read (tof_read) and frame arrival to its fused event (depth).");
+    text.histogram("sensor_daemon_stage_latency_seconds", metrics.tof_read, "stage=\"tof_read\"");
+    text.histogram("sensor_daemon_stage_latency_seconds", metrics.depth_process, "stage=\"depth\"");
+
+    text.family("process_cpu_seconds_total", "counter", "User and system CPU time of the process.");
+    text.sample("process_cpu_seconds_total", process_cpu_seconds());
+    return text.str();
+}
+
+void usage(const char* prog)
+{
+    std::cerr << "Usage: " << prog << " [--socket PATH] [--depth on|off|auto] [--no-tof] [--shm NAME]\n"
+              << "       [--bus /dev/i2c-1] [--addr 0x29] [--xshut PATH] [--gpio1 PATH] [--hz 20] [--continuous]\n"
+              << "       [--sim] [--calibration-cache FILE] [--filter none|median|ema|kalman] [--adaptive]\n"
+              << "       [--threshold MM]... [--delta MM] [--heartbeat MS]\n"
+              << "       [--depth-res WxH] [--fps N] [--window S] [--stride N] [--decimate N] [--spatial] [--temporal]\n"
+              << "       [--hole-fill] [--settle-frames N] [--wake-mm N] [--idle-s S] [--max-skew-ms N]\n"
+              << "       [--sched-fifo TOF[,DEPTH]] [--cpu-tof LIST] [--cpu-depth LIST] [--mlock]\n"
+              << "       [--metrics FILE [--metrics-interval S]]\n"
+              << "The ToF reader (tof-reader's options), the depth liveness engine (d435i-liveness's) and their\n"
+              << "fusion (--fuse-shm) as threads of one process, controlled over one Unix socket.\n"
+              << "  --socket PATH    control socket (default /tmp/sensor-daemon.sock). One JSON object per line each\n"
+              << "                   way; every client gets a reply per request and every event:\n"
+              << "                     {\"cmd\":\"status\"}\n"
+              << "                     {\"cmd\":\"start\"|\"stop\", \"sensor\":\"tof\"|\"depth\"|\"all\", \"mode\":\"on\"|\"auto\"}\n"
+              << "                     {\"cmd\":\"reconfigure\", <setting>:<value>, ...}  applied all or nothing;\n"
+              << "                     only a part whose settings changed restarts:\n"
+              << "                       ToF (restarts its thread): hz, continuous, adaptive, filter, thresholds\n"
+              << "                       (\"300,600\"), delta_mm, hysteresis_mm, heartbeat_ms\n"
+              << "                       gate (next sample): wake_mm, idle_s\n"
+              << "                       depth (restarts a running session): window_s, min_range_m, min_stdev_m,\n"
+              << "                       min_samples, roi_ratio, stride, decimate, spatial, temporal, hole_fill,\n"
+              << "                       depth_res (\"848x480\"), fps, max_skew_ms\n"
+              << "                   Events: {\"event\":\"tof\",...} with tof-reader's JSON fields, {\"event\":\"depth\",...}\n"
+              << "                   with d435i-liveness --fuse-shm's, {\"event\":\"liveness\",\"live\":...} when the\n"
+              << "                   smoothed verdict flips, {\"event\":\"state\",\"sensor\":...,\"state\":...} and\n"
+              << "                   {\"event\":\"error\",...}. A client that stops reading misses events, not replies\n"
+              << "  --depth MODE     on: stream from the start; auto (default): stream while the ToF sees someone\n"
+              << "                   within --wake-mm (default 600) and until nobody was there for --idle-s (default 5);\n"
+              << "                   off: wait for a start command\n"
+              << "  --no-tof         leave the ToF stopped until a start command\n"
+              << "  --shm NAME       also publish ToF samples to the tof-reader shared-memory segment NAME\n"
+              << "  --threshold MM   ToF events only on crossings (repeatable), --delta moves and a --heartbeat\n"
+              << "                   (default 1000 ms) instead of one per sample\n"
+              << "  --sched-fifo TOF[,DEPTH]  SCHED_FIFO priority (1-99) for the ToF and depth threads\n"
+              << "  --cpu-tof LIST, --cpu-depth LIST  pin those threads to CPUs, e.g. 3 or 2-3\n"
+              << "  --mlock          lock current and future memory (mlockall) and pre-fault the thread stacks\n"
+              << "  --metrics FILE   rewrite FILE every --metrics-interval seconds (default 5) with Prometheus text\n"
+              << "Other options as in tof-reader --help and d435i-liveness --help.\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    DaemonConfig config;
+    DepthMode depth_mode = DepthMode::Auto;
+    bool start_tof = true;
+    std::string socket_path = "/tmp/sensor-daemon.sock";
+    std::string shm_name;
+    bool lock_memory = false;
+    std::string metrics_path;
+    uint64_t metrics_interval_ms = 5000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--socket") == 0 && has_value)
+        {
+            socket_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--depth") == 0 && has_value && parse_depth_mode(argv[i + 1], depth_mode))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--no-tof") == 0)
+        {
+            start_tof = false;
+        }
+        else if (std::strcmp(argv[i], "--shm") == 0 && has_value)
+        {
+            shm_name = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--bus") == 0 && has_value)
+        {
+            config.tof.i2c_bus = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--addr") == 0 && has_value)
+        {
+            config.tof.i2c_address = static_cast<uint8_t>(std::strtol(argv[++i], nullptr, 0));
+        }
+        else if (std::strcmp(argv[i], "--xshut") == 0 && has_value)
+        {
+            config.tof.xshut_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--gpio1") == 0 && has_value)
+        {
+            config.tof.gpio1_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--hz") == 0 && has_value)
+        {
+            config.tof.output_hz = std::clamp(std::atoi(argv[++i]), 1, 100);
+        }
+        else if (std::strcmp(argv[i], "--continuous") == 0)
+        {
+            config.tof.continuous = true;
+        }
+        else if (std::strcmp(argv[i], "--sim") == 0)
+        {
+            config.tof.simulate = true;
+        }
+        else if (std::strcmp(argv[i], "--calibration-cache") == 0 && has_value)
+        {
+            config.tof.calibration_cache = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && has_value &&
+                 parse_filter_kind(argv[i + 1], config.filter.kind))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--adaptive") == 0)
+        {
+            config.tof.adaptive_timing = true;
+        }
+        else if (std::strcmp(argv[i], "--threshold") == 0 && has_value)
+        {
+            config.events.thresholds_mm.push_back(static_cast<uint16_t>(std::clamp(std::atoi(argv[++i]), 1, 65535)));
+        }
+        else if (std::strcmp(argv[i], "--delta") == 0 && has_value)
+        {
+            config.events.delta_mm = static_cast<uint16_t>(std::clamp(std::atoi(argv[++i]), 0, 65535));
+        }
+        else if (std::strcmp(argv[i], "--heartbeat") == 0 && has_value)
+        {
+            config.events.heartbeat_ms = static_cast<uint64_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--depth-res") == 0 && has_value &&
+                 parse_resolution(argv[i + 1], config.depth_width, config.depth_height))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0 && has_value)
+        {
+            config.fps = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--window") == 0 && has_value)
+        {
+            config.liveness.window_s = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--stride") == 0 && has_value)
+        {
+            config.liveness.stride = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--decimate") == 0 && has_value)
+        {
+            config.liveness.filters.decimation = std::clamp(std::atoi(argv[++i]), 1, 8);
+        }
+        else if (std::strcmp(argv[i], "--spatial") == 0)
+        {
+            config.liveness.filters.spatial = true;
+        }
+        else if (std::strcmp(argv[i], "--temporal") == 0)
+        {
+            config.liveness.filters.temporal = true;
+        }
+        else if (std::strcmp(argv[i], "--hole-fill") == 0)
+        {
+            config.liveness.filters.hole_fill = true;
+        }
+        else if (std::strcmp(argv[i], "--settle-frames") == 0 && has_value)
+        {
+            config.settle.max_frames = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--wake-mm") == 0 && has_value)
+        {
+            config.gate.wake_mm = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--idle-s") == 0 && has_value)
+        {
+            config.gate.idle_s = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--max-skew-ms") == 0 && has_value)
+        {
+            config.max_skew_ms = std::max(0.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--sched-fifo") == 0 && has_value)
+        {
+            char* end = nullptr;
+            config.tof_rt.fifo_priority = static_cast<int>(std::clamp(std::strtol(argv[++i], &end, 0), 0L, 99L));
+            if (*end == ',')
+            {
+                config.depth_rt.fifo_priority = static_cast<int>(std::clamp(std::strtol(end + 1, nullptr, 0), 0L, 99L));
+            }
+        }
+        else if (std::strcmp(argv[i], "--cpu-tof") == 0 && has_value)
+        {
+            if (!parse_cpu_list(argv[++i], config.tof_rt.cpus))
+            {
+                std::cerr << "Invalid CPU list: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--cpu-depth") == 0 && has_value)
+        {
+            if (!parse_cpu_list(argv[++i], config.depth_rt.cpus))
+            {
+                std::cerr << "Invalid CPU list: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--mlock") == 0)
+        {
+            lock_memory = true;
+        }
+        else if (std::strcmp(argv[i], "--metrics") == 0 && has_value)
+        {
+            metrics_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--metrics-interval") == 0 && has_value)
+        {
+            metrics_interval_ms = static_cast<uint64_t>(std::max(0.1, std::atof(argv[++i])) * 1000.0);
+        }
+        else
+        {
+            usage(argv[0]);
+            return (std::strcmp(argv[i], "--help") == 0) ? 0 : 1;
+        }
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    ControlSocket socket;
+    if (!socket.open(socket_path))
+    {
+        return 1;
+    }
+    if (lock_memory)
+    {
+        lock_process_memory();
+        prefault_stack();
+        config.prefault = true;
+    }
+
+    DaemonMetrics metrics;
+    // Destroyed before `metrics`, after a final write
+    std::unique_ptr<MetricsFile> metrics_file;
+    if (!metrics_path.empty())
+    {
+        metrics_file = std::make_unique<MetricsFile>(metrics_path, metrics_interval_ms,
+                                                     [&metrics, &socket] { return format_metrics(metrics, socket); });
+        metrics_file->start();
+    }
+
+    SensorDaemon daemon(config, depth_mode, shm_name, socket, metrics);
+    daemon.start(start_tof);
+    std::cerr << "sensor-daemon: listening on " << socket_path << " (depth " << depth_mode_name(depth_mode)
+              << (start_tof ? "" : ", ToF stopped") << ")" << std::endl;
+    socket.run(g_should_exit, [&daemon](const ControlRequest& request) { return daemon.handle(request); });
+    daemon.shutdown();
+    if (metrics_file)
+    {
+        metrics_file->stop();
+    }
+    socket.close();
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "sensor_fusion.hpp"
+
+#include <cmath>
+
+ToFPairing pair_tof(const ToFSample* samples, size_t count, double frame_host_ms, double max_skew_ms)
+{
+    const ToFSample* before = nullptr;  // latest at or before the frame
+    const ToFSample* after = nullptr;   // earliest after it
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ToFSample& s = samples[i];
+        if (s.status != 0 || s.timestamp_ms == 0)
+        {
+            continue;
+        }
+        const double t = static_cast<double>(s.timestamp_ms);
+        if (t <= frame_host_ms)
+        {
+            if (!before || s.timestamp_ms > before->timestamp_ms)
+            {
+                before = &s;
+            }
+        }
+        else if (!after || s.timestamp_ms < after->timestamp_ms)
+        {
+            after = &s;
+        }
+    }
+
+    ToFPairing pairing;
+    const double before_skew = before ? static_cast<double>(before->timestamp_ms) - frame_host_ms : 0.0;
+    const double after_skew = after ? static_cast<double>(after->timestamp_ms) - frame_host_ms : 0.0;
+    const ToFSample* nearest = (!after || (before && -before_skew <= after_skew)) ? before : after;
+    if (!nearest)
+    {
+        return pairing;
+    }
+    pairing.skew_ms = (nearest == before) ? before_skew : after_skew;
+    if (std::fabs(pairing.skew_ms) > max_skew_ms)
+    {
+        return pairing;
+    }
+    pairing.found = true;
+    pairing.sequence = nearest->sequence;
+    pairing.distance_mm = nearest->distance_mm;
+    if (before && after && after_skew - before_skew <= 2.0 * max_skew_ms)
+    {
+        const double w = -before_skew / (after_skew - before_skew);
+        pairing.distance_mm = before->distance_mm + w * (static_cast<double>(after->distance_mm) - before->distance_mm);
+    }
+    return pairing;
+}
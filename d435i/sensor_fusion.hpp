@@ -0,0 +1,52 @@
+#pragma once
+
+// Joins depth frames and ToF samples on one timeline. ToF samples are stamped on the host steady clock
+// (CLOCK_MONOTONIC ms, tof-reader's monotonic_millis()); depth frames carry the camera's hardware,
+// global or system timestamp. ClockMapper estimates the offset from a frame's timestamp to its host
+// arrival, and pair_tof() finds the ToF readings around the mapped frame time.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sliding_window.hpp"
+
+// Host-clock view of one ToF sample, as published in the tof-reader shared-memory history.
+struct ToFSample
+{
+    uint64_t timestamp_ms = 0;  // CLOCK_MONOTONIC
+    uint32_t sequence = 0;
+    uint16_t distance_mm = 0;
+    uint16_t status = 0;  // 0 = valid range
+};
+
+// Maps timestamps of another clock onto the host clock from (timestamp, host arrival) pairs.
+// Arrival only ever lags the timestamp, so the smallest host - timestamp gap over the window is the
+// estimate with the least transport latency in it; the window lets the estimate follow clock drift.
+class ClockMapper
+{
+  public:
+    static constexpr size_t kCapacity = 512;  // > 8 s at 60 fps
+
+    explicit ClockMapper(double window_s = 5.0) : offsets_(window_s) {}
+
+    void observe(double remote_ms, double host_ms) { offsets_.push(host_ms / 1000.0, host_ms - remote_ms); }
+    bool valid() const { return !offsets_.empty(); }
+    double offset_ms() const { return offsets_.min(); }
+    double to_host_ms(double remote_ms) const { return remote_ms + offset_ms(); }
+    void reset() { offsets_.clear(); }
+
+  private:
+    SlidingWindow<kCapacity> offsets_;
+};
+
+// ToF reading paired with one depth frame.
+struct ToFPairing
+{
+    bool found = false;      // false when no valid sample lies within max_skew_ms
+    double distance_mm = 0;  // interpolated between the samples either side of the frame when both exist
+    uint32_t sequence = 0;   // of the nearest sample
+    double skew_ms = 0;      // nearest sample time minus frame time
+};
+
+// `samples` in any order; only valid ones (status 0) are considered.
+ToFPairing pair_tof(const ToFSample* samples, size_t count, double frame_host_ms, double max_skew_ms);
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Time-windowed statistics over the last `window_s` seconds (and at most Capacity samples),
+// updated in amortized O(1) per sample without allocation.
+//
+// Min and max come from monotonic deques of sample sequence numbers; mean and variance from
+// running sums taken relative to the first sample after the window was last empty, which keeps
+// the sum-of-squares cancellation small for depth values far from zero.
+template <size_t Capacity>
+class SlidingWindow
+{
+  public:
+    explicit SlidingWindow(double window_s) : window_s_(window_s) {}
+
+    void push(double t, double value)
+    {
+        evict(t);
+        if (size_ == Capacity)
+        {
+            pop_oldest();
+        }
+        if (size_ == 0)
+        {
+            origin_ = value;
+        }
+
+        const uint64_t seq = next_seq_++;
+        Sample& s = samples_[seq % Capacity];
+        s.t = t;
+        s.value = value;
+        ++size_;
+
+        const double d = value - origin_;
+        sum_ += d;
+        sum_sq_ += d * d;
+
+        while (min_q_.size != 0 && value_of(min_q_.back()) >= value)
+        {
+            min_q_.pop_back();
+        }
+        min_q_.push_back(seq);
+        while (max_q_.size != 0 && value_of(max_q_.back()) <= value)
+        {
+            max_q_.pop_back();
+        }
+        max_q_.push_back(seq);
+    }
+
+    // Drops samples older than window_s relative to `now`.
+    void evict(double now)
+    {
+        while (size_ != 0 && now - samples_[oldest_seq() % Capacity].t > window_s_)
+        {
+            pop_oldest();
+        }
+    }
+
+    // Drops samples taken before `t`; lets a window of optional values follow a companion window's eviction.
+    void discard_before(double t)
+    {
+        while (size_ != 0 && samples_[oldest_seq() % Capacity].t < t)
+        {
+            pop_oldest();
+        }
+    }
+
+    void clear()
+    {
+        size_ = 0;
+        min_q_.size = 0;
+        max_q_.size = 0;
+        sum_ = 0.0;
+        sum_sq_ = 0.0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    double window_s() const { return window_s_; }
+    // Timestamp of the oldest retained sample; 0 when empty.
+    double oldest_t() const { return size_ ? samples_[oldest_seq() % Capacity].t : 0.0; }
+
+    double min() const { return size_ ? value_of(min_q_.front()) : 0.0; }
+    double max() const { return size_ ? value_of(max_q_.front()) : 0.0; }
+    double peak_to_peak() const { return size_ ? max() - min() : 0.0; }
+    double mean() const { return size_ ? origin_ + sum_ / static_cast<double>(size_) : 0.0; }
+
+    // Population variance, matching numpy.std() defaults.
+    double variance() const
+    {
+        if (size_ == 0)
+        {
+            return 0.0;
+        }
+        const double n = static_cast<double>(size_);
+        const double m = sum_ / n;
+        const double v = sum_sq_ / n - m * m;
+        return v > 0.0 ? v : 0.0;
+    }
+    double stdev() const { return std::sqrt(variance()); }
+
+  private:
+    struct Sample
+    {
+        double t = 0.0;
+        double value = 0.0;
+    };
+
+    // Fixed ring of sequence numbers used as a double-ended queue.
+    struct SeqDeque
+    {
+        uint64_t items[Capacity] = {};
+        size_t head = 0;
+        size_t size = 0;
+
+        uint64_t front() const { return items[head]; }
+        uint64_t back() const { return items[(head + size - 1) % Capacity]; }
+        void push_back(uint64_t seq)
+        {
+            items[(head + size) % Capacity] = seq;
+            ++size;
+        }
+        void pop_back() { --size; }
+        void pop_front()
+        {
+            head = (head + 1) % Capacity;
+            --size;
+        }
+    };
+
+    uint64_t oldest_seq() const { return next_seq_ - size_; }
+    double value_of(uint64_t seq) const { return samples_[seq % Capacity].value; }
+
+    void pop_oldest()
+    {
+        const uint64_t seq = oldest_seq();
+        const double d = value_of(seq) - origin_;
+        sum_ -= d;
+        sum_sq_ -= d * d;
+        --size_;
+        if (min_q_.size != 0 && min_q_.front() == seq)
+        {
+            min_q_.pop_front();
+        }
+        if (max_q_.size != 0 && max_q_.front() == seq)
+        {
+            max_q_.pop_front();
+        }
+        if (size_ == 0)
+        {
+            sum_ = 0.0;
+            sum_sq_ = 0.0;
+        }
+    }
+
+    double window_s_;
+    Sample samples_[Capacity];
+    uint64_t next_seq_ = 0;
+    size_t size_ = 0;
+    SeqDeque min_q_;
+    SeqDeque max_q_;
+    double origin_ = 0.0;
+    double sum_ = 0.0;
+    double sum_sq_ = 0.0;
+};
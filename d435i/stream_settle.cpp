@@ -0,0 +1,40 @@
+#include "stream_settle.hpp"
+
+#include <cmath>
+
+StreamSettle::StreamSettle(const StreamSettleConfig& config) : config_(config)
+{
+    settled_ = config_.max_frames == 0;
+}
+
+void StreamSettle::reset()
+{
+    *this = StreamSettle(config_);
+}
+
+bool StreamSettle::update(double exposure, double fill_fraction)
+{
+    if (settled_)
+    {
+        return true;
+    }
+    ++frames_;
+    const bool exposure_stable =
+        exposure < 0.0 || (last_exposure_ > 0.0 &&
+                           std::fabs(exposure - last_exposure_) <= config_.exposure_tolerance * last_exposure_);
+    const bool fill_stable = last_fill_ >= 0.0 && std::fabs(fill_fraction - last_fill_) <= config_.fill_tolerance;
+    last_exposure_ = exposure;
+    last_fill_ = fill_fraction;
+    stable_ = (exposure_stable && fill_stable) ? stable_ + 1 : 0;
+
+    if (frames_ >= config_.min_frames && stable_ >= config_.stable_frames)
+    {
+        settled_ = true;
+    }
+    else if (frames_ >= config_.max_frames)
+    {
+        settled_ = true;
+        timed_out_ = true;
+    }
+    return settled_;
+}
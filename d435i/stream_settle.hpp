@@ -0,0 +1,41 @@
+#pragma once
+
+// Decides when a freshly started RealSense stream is usable, replacing a fixed number of warm-up frames.
+// Auto-exposure is settled once the color exposure stops moving, depth once the fraction of valid pixels
+// in the ROI stops moving; both have to hold for a few consecutive frames.
+
+#include <cstddef>
+
+struct StreamSettleConfig
+{
+    size_t min_frames = 3;            // never settle earlier; the first frames after start are often stale
+    size_t max_frames = 30;           // settle anyway after this many (the old fixed warm-up); 0 = settle at once
+    size_t stable_frames = 3;         // consecutive frames within tolerance
+    double exposure_tolerance = 0.03; // relative frame-to-frame change in actual exposure
+    double fill_tolerance = 0.02;     // absolute frame-to-frame change in the ROI's valid-pixel fraction
+};
+
+class StreamSettle
+{
+  public:
+    explicit StreamSettle(const StreamSettleConfig& config = StreamSettleConfig{});
+
+    // One frame; exposure < 0 when the camera does not report it (only depth is checked then).
+    // Returns true from the frame the stream counts as settled on.
+    bool update(double exposure, double fill_fraction);
+    void reset();
+
+    bool settled() const { return settled_; }
+    size_t frames() const { return frames_; }
+    // True if max_frames ran out before the stream was stable.
+    bool timed_out() const { return timed_out_; }
+
+  private:
+    StreamSettleConfig config_;
+    size_t frames_ = 0;
+    size_t stable_ = 0;
+    double last_exposure_ = -1.0;
+    double last_fill_ = -1.0;
+    bool settled_ = false;
+    bool timed_out_ = false;
+};
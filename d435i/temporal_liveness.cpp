@@ -0,0 +1,51 @@
+#include "temporal_liveness.hpp"
+
+TemporalLiveness::TemporalLiveness(const TemporalLivenessConfig& config)
+    : config_(config), range_(config.window_s), stdev_(config.window_s), depth_(config.window_s)
+{
+}
+
+void TemporalLiveness::reset()
+{
+    range_.clear();
+    stdev_.clear();
+    depth_.clear();
+    state_ = TemporalLivenessState{};
+}
+
+const TemporalLivenessState& TemporalLiveness::update(double t, bool valid, double range_m, double stdev_m,
+                                                      double depth_mean_m)
+{
+    range_.push(t, valid ? range_m : 0.0);
+    stdev_.push(t, valid ? stdev_m : 0.0);
+    depth_.evict(t);
+    if (valid)
+    {
+        depth_.push(t, depth_mean_m);
+    }
+
+    state_.frames = range_.size();
+    state_.valid_frames = depth_.size();
+    state_.range_mean_m = range_.mean();
+    state_.range_min_m = range_.min();
+    state_.stdev_mean_m = stdev_.mean();
+    state_.depth_mean_m = depth_.mean();
+    state_.depth_jitter_m = depth_.stdev();
+    state_.depth_peak_to_peak_m = depth_.peak_to_peak();
+
+    if (state_.frames < config_.min_frames)
+    {
+        state_.live = false;
+    }
+    else if (state_.live)
+    {
+        const double keep = 1.0 - config_.hysteresis;
+        state_.live = state_.range_mean_m >= config_.min_range_m * keep &&
+                      state_.stdev_mean_m >= config_.min_stdev_m * keep;
+    }
+    else
+    {
+        state_.live = state_.range_mean_m >= config_.min_range_m && state_.stdev_mean_m >= config_.min_stdev_m;
+    }
+    return state_;
+}
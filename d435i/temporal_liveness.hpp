@@ -0,0 +1,53 @@
+#pragma once
+
+// Smoothed LIVE/FLAT decision for d435i-liveness. Per-frame ROI statistics go into sliding windows,
+// so each frame costs O(1) and a single noisy frame can no longer flip the output.
+
+#include <cstddef>
+
+#include "sliding_window.hpp"
+
+struct TemporalLivenessConfig
+{
+    double window_s = 1.0;      // history the decision is made over
+    size_t min_frames = 5;      // frames needed in the window before LIVE is possible
+    double min_range_m = 0.04;  // windowed mean of the per-frame trimmed range
+    double min_stdev_m = 0.01;  // windowed mean of the per-frame standard deviation
+    double hysteresis = 0.25;   // LIVE holds until a mean falls this fraction below its threshold
+};
+
+// Windowed view after the latest update().
+struct TemporalLivenessState
+{
+    size_t frames = 0;             // frames in the window, including ones with too few samples
+    size_t valid_frames = 0;
+    double range_mean_m = 0.0;
+    double range_min_m = 0.0;
+    double stdev_mean_m = 0.0;
+    double depth_mean_m = 0.0;     // mean ROI depth across valid frames
+    double depth_jitter_m = 0.0;   // its standard deviation over the window
+    double depth_peak_to_peak_m = 0.0;
+    bool live = false;
+};
+
+class TemporalLiveness
+{
+  public:
+    static constexpr size_t kCapacity = 256;  // > 4 s at 60 fps
+
+    explicit TemporalLiveness(const TemporalLivenessConfig& config = TemporalLivenessConfig{});
+
+    // `valid` is false when the ROI had too few samples; such frames count as flat.
+    const TemporalLivenessState& update(double t, bool valid, double range_m, double stdev_m, double depth_mean_m);
+    void reset();
+
+    const TemporalLivenessState& state() const { return state_; }
+    const TemporalLivenessConfig& config() const { return config_; }
+
+  private:
+    TemporalLivenessConfig config_;
+    SlidingWindow<kCapacity> range_;
+    SlidingWindow<kCapacity> stdev_;
+    SlidingWindow<kCapacity> depth_;  // valid frames only
+    TemporalLivenessState state_;
+};
@@ -0,0 +1,183 @@
+#include "tof_proximity.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr int kMaxRetries = 8;
+} // namespace
+
+void PresenceDetector::update(const ToFSample* latest, uint64_t now_ms)
+{
+    const bool fresh = latest && latest->status == 0 && latest->timestamp_ms <= now_ms &&
+                       now_ms - latest->timestamp_ms <= static_cast<uint64_t>(config_.stale_s * 1000.0);
+    distance_mm_ = fresh ? static_cast<int>(latest->distance_mm) : -1;
+    // Hysteresis: entering needs wake_mm, staying only wake_mm + hysteresis_mm
+    const int limit = present_ ? config_.wake_mm + config_.hysteresis_mm : config_.wake_mm;
+    if (fresh && distance_mm_ < limit)
+    {
+        present_ = true;
+        last_near_ms_ = now_ms;
+    }
+    else if (present_ && now_ms - last_near_ms_ > static_cast<uint64_t>(config_.idle_s * 1000.0))
+    {
+        present_ = false;
+    }
+}
+
+ToFProximity::ToFProximity(const ProximityConfig& config) : presence_(config) {}
+
+ToFProximity::~ToFProximity()
+{
+    unmap();
+}
+
+void ToFProximity::unmap()
+{
+    if (data_)
+    {
+        munmap(const_cast<uint8_t*>(data_), length_);
+        data_ = nullptr;
+        length_ = 0;
+    }
+}
+
+bool ToFProximity::open(const std::string& name)
+{
+    name_ = name;
+    return map_segment();
+}
+
+bool ToFProximity::map_segment()
+{
+    if (data_)
+    {
+        return true;
+    }
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ShmLayout)))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return false;
+    }
+    const auto* header = static_cast<const ShmLayout*>(addr);
+    if (std::memcmp(header->magic, kShmMagic, sizeof(kShmMagic)) != 0 || header->version != kShmVersion ||
+        header->history_length != kShmHistoryLength)
+    {
+        munmap(addr, static_cast<size_t>(st.st_size));
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(addr);
+    length_ = static_cast<size_t>(st.st_size);
+    inode_ = static_cast<uint64_t>(st.st_ino);
+    return true;
+}
+
+// A restarted tof-reader unlinks its segment and creates a new one under the same name, which the mapping
+// would never show. Once the newest sample is older than stale_s, checks (at most once per stale_s) whether
+// the name still leads to the mapped segment and unmaps it if not; the next read maps the new one.
+void ToFProximity::unmap_if_replaced(const ShmSample* newest, uint64_t now_ms)
+{
+    const uint64_t stale_ms = static_cast<uint64_t>(presence_.config().stale_s * 1000.0);
+    if (!data_ || (newest && newest->timestamp_ms + stale_ms >= now_ms) || now_ms - checked_ms_ < stale_ms)
+    {
+        return;
+    }
+    checked_ms_ = now_ms;
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    struct stat st{};
+    const bool replaced = fd < 0 || fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_ino) != inode_;
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    if (replaced)
+    {
+        unmap();
+    }
+}
+
+size_t ToFProximity::read_history(ToFSample* out)
+{
+    if (!map_segment())
+    {
+        return 0;
+    }
+    const auto* header = reinterpret_cast<const ShmLayout*>(data_);
+    ShmSample copy[kHistoryLength];
+    for (int i = 0; i < kMaxRetries; ++i)
+    {
+        const uint32_t before = header->seq.load(std::memory_order_acquire);
+        if (before & 1u)
+        {
+            continue;
+        }
+        const uint64_t count = header->write_count;
+        std::memcpy(copy, header->history, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->seq.load(std::memory_order_relaxed) != before)
+        {
+            continue;
+        }
+        const size_t n = count < kHistoryLength ? static_cast<size_t>(count) : kHistoryLength;
+        unmap_if_replaced(n ? &copy[(count - 1) % kHistoryLength] : nullptr, monotonic_millis());
+        for (size_t k = 0; k < n; ++k)
+        {
+            const ShmSample& s = copy[(count - n + k) % kHistoryLength];
+            out[k] = ToFSample{s.timestamp_ms, s.sequence, s.distance_mm, s.status};
+        }
+        return n;
+    }
+    return 0;
+}
+
+void ToFProximity::poll()
+{
+    const uint64_t now = monotonic_millis();
+    bool have_sample = false;
+    ShmSample sample{};
+    if (map_segment())
+    {
+        const auto* header = reinterpret_cast<const ShmLayout*>(data_);
+        for (int i = 0; i < kMaxRetries && !have_sample; ++i)
+        {
+            const uint32_t before = header->seq.load(std::memory_order_acquire);
+            if (before & 1u)
+            {
+                continue;
+            }
+            const uint64_t count = header->write_count;
+            std::memcpy(&sample, &header->latest, sizeof(sample));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->seq.load(std::memory_order_relaxed) == before)
+            {
+                have_sample = count != 0;
+                if (!have_sample)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    unmap_if_replaced(have_sample ? &sample : nullptr, now);
+
+    const ToFSample latest{sample.timestamp_ms, sample.sequence, sample.distance_mm, sample.status};
+    presence_.update(have_sample ? &latest : nullptr, now);
+}
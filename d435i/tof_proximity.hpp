@@ -0,0 +1,78 @@
+#pragma once
+
+// Presence and recent samples from the ToF sensor, read from the tof-reader --shm segment, for
+// d435i-liveness --wake-shm and --fuse-shm. sensor-daemon feeds PresenceDetector from its own ToF thread.
+// The layout is ShmLayout from controller/tof/include/shm_channel.hpp.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sensor_fusion.hpp"
+#include "shm_channel.hpp"
+
+struct ProximityConfig
+{
+    int wake_mm = 600;        // someone closer than this starts the cameras
+    int hysteresis_mm = 100;  // and counts as gone beyond wake_mm + hysteresis_mm
+    double idle_s = 5.0;      // how long they have to be gone (or the ToF silent) before streaming stops
+    double stale_s = 0.5;     // samples older than this count as no reading
+};
+
+// Someone-is-there decision with hysteresis and an idle timeout, from the latest sample however it arrives.
+class PresenceDetector
+{
+  public:
+    explicit PresenceDetector(const ProximityConfig& config = ProximityConfig{}) : config_(config) {}
+
+    // `latest` is null while there is no sample; now_ms is CLOCK_MONOTONIC, the clock of ToFSample::timestamp_ms.
+    void update(const ToFSample* latest, uint64_t now_ms);
+    bool present() const { return present_; }
+    // Latest fresh valid distance, or -1.
+    int distance_mm() const { return distance_mm_; }
+    const ProximityConfig& config() const { return config_; }
+
+  private:
+    ProximityConfig config_;
+    bool present_ = false;
+    int distance_mm_ = -1;
+    uint64_t last_near_ms_ = 0;
+};
+
+class ToFProximity
+{
+  public:
+    explicit ToFProximity(const ProximityConfig& config = ProximityConfig{});
+    ~ToFProximity();
+
+    ToFProximity(const ToFProximity&) = delete;
+    ToFProximity& operator=(const ToFProximity&) = delete;
+
+    // Maps the segment read-only; retried by poll() until tof-reader has created it.
+    bool open(const std::string& name);
+
+    // Reads the latest sample and updates the presence state. Cheap: no syscalls once mapped, bar a look at
+    // the name every stale_s while the samples are stale (a restarted tof-reader has a new segment).
+    void poll();
+    // Someone is (still) there; turns false only after idle_s without a near reading.
+    bool present() const { return presence_.present(); }
+    // Latest valid distance, or -1.
+    int distance_mm() const { return presence_.distance_mm(); }
+
+    // Copies the published history (up to kHistoryLength most recent samples, oldest first) for
+    // pair_tof(); 0 if the segment is missing, empty or stayed busy.
+    static constexpr size_t kHistoryLength = kShmHistoryLength;
+    size_t read_history(ToFSample* out);
+
+  private:
+    bool map_segment();
+    void unmap();
+    void unmap_if_replaced(const ShmSample* newest, uint64_t now_ms);
+
+    PresenceDetector presence_;
+    std::string name_;
+    const uint8_t* data_ = nullptr;
+    size_t length_ = 0;
+    uint64_t inode_ = 0;       // of the mapped segment
+    uint64_t checked_ms_ = 0;  // last unmap_if_replaced() look at the name
+};